@@ -0,0 +1,161 @@
+#include "block_layout.h"
+
+BlockLayout::BlockLayout(std::shared_ptr<CompilerStats> stats, bool thread_jumps, bool rotate_loops)
+    : stats_(stats), thread_jumps_(thread_jumps), rotate_loops_(rotate_loops) {
+}
+
+std::vector<std::string> BlockLayout::run(std::vector<std::string> lines) {
+  std::vector<Instruction> code;
+  for(auto & line : lines) {
+    Instruction instr;
+    if(!parseInstruction(line, instr)) {
+      return lines;
+    }
+    code.push_back(instr);
+  }
+  if(thread_jumps_) {
+    threadJumps(code);
+    removeUnreachableCode(code);
+  }
+  if(rotate_loops_) {
+    rotateLoops(code);
+  }
+  std::vector<std::string> result;
+  for(auto & instr : code) {
+    result.push_back(instructionToString(instr));
+  }
+  return result;
+}
+
+/**
+ * Redirects every jump, that targets unconditional jump, to the target of the last jump of the chain.
+ * Unconditional jump to HALT is replaced by HALT.
+ */
+void BlockLayout::threadJumps(std::vector<Instruction> &code) {
+  for(auto & instr : code) {
+    if(!isJumpInstruction(instr.code)) {
+      continue;
+    }
+    long long int target = instr.target;
+    // chain of jumps can be a cycle, it is never longer than the code
+    for(long long int hops = 0; hops < code.size() && target >= 0 && target < code.size() &&
+        code.at(target).code == instruction_code::JUMP && code.at(target).target != target; hops++) {
+      target = code.at(target).target;
+    }
+    if(target != instr.target) {
+      instr.target = target;
+      stats_->addCounter("jumps_threaded", 1);
+    }
+    if(instr.code == instruction_code::JUMP && target >= 0 && target < code.size() &&
+        code.at(target).code == instruction_code::HALT) {
+      instr = code.at(target);
+      stats_->addCounter("jumps_threaded", 1);
+    }
+  }
+}
+
+/**
+ * Removes instructions, that can not be reached from the beginning of program. Procedure called by JUMP
+ * following STRK returns to the second instruction after STRK.
+ */
+void BlockLayout::removeUnreachableCode(std::vector<Instruction> &code) {
+  std::vector<bool> reachable(code.size(), false);
+  std::vector<long long int> lines_to_visit{0};
+  while(!lines_to_visit.empty()) {
+    long long int line = lines_to_visit.back();
+    lines_to_visit.pop_back();
+    if(line < 0 || line >= code.size() || reachable.at(line)) {
+      continue;
+    }
+    reachable.at(line) = true;
+    Instruction &instr = code.at(line);
+    if(isJumpInstruction(instr.code)) {
+      lines_to_visit.push_back(instr.target);
+    }
+    if(instr.code == instruction_code::STRK) {
+      lines_to_visit.push_back(line + 2);
+    }
+    if(instr.code != instruction_code::JUMP && instr.code != instruction_code::JUMPR &&
+        instr.code != instruction_code::HALT) {
+      lines_to_visit.push_back(line + 1);
+    }
+  }
+  std::vector<std::vector<Instruction>> replacements(code.size());
+  long long int removed = 0;
+  for(long long int i = 0; i < code.size(); i++) {
+    if(reachable.at(i)) {
+      replacements.at(i).push_back(code.at(i));
+    } else {
+      removed++;
+    }
+  }
+  if(removed > 0) {
+    stats_->addCounter("unreachable_instructions_removed", removed);
+    code = replaceInstructions(code, replacements);
+  }
+}
+
+/**
+ * Replaces every JUMP back to loop condition by copy of the condition. All rotations are found in the original
+ * code, so copies use its line numbers and are moved together with all other jumps.
+ */
+void BlockLayout::rotateLoops(std::vector<Instruction> &code) {
+  std::vector<std::vector<Instruction>> replacements(code.size());
+  bool changed = false;
+  for(long long int i = 0; i < code.size(); i++) {
+    std::vector<Instruction> condition;
+    if(copyCondition(code, i, condition)) {
+      replacements.at(i) = condition;
+      stats_->addCounter("loops_rotated", 1);
+      changed = true;
+    } else {
+      replacements.at(i).push_back(code.at(i));
+    }
+  }
+  if(changed) {
+    code = replaceInstructions(code, replacements);
+  }
+}
+
+/**
+ * Copies condition of loop ending with JUMP at given line. Condition starts at target of the backward JUMP
+ * and consists of straight-line instructions up to the first conditional jump leaving the loop, to the line
+ * after the JUMP. That jump is inverted in the copy, so it jumps to the rest of loop when loop continues,
+ * and leaves the loop by falling through. Accumulator is never negative, so JPOS and JZERO are complementary.
+ * JUMP following STRK is a procedure call and is never replaced.
+ *
+ * @return whether condition was copied
+ */
+bool BlockLayout::copyCondition(const std::vector<Instruction> &code, long long int jump_line,
+                                std::vector<Instruction> &condition) {
+  const Instruction &jump = code.at(jump_line);
+  if(jump.code != instruction_code::JUMP || jump.target < 0 || jump.target >= jump_line ||
+      (jump_line > 0 && code.at(jump_line - 1).code == instruction_code::STRK)) {
+    return false;
+  }
+  long long int exit_line = jump_line + 1;
+  for(long long int line = jump.target; line < jump_line && line - jump.target < k_max_rotated_condition_length;
+      line++) {
+    Instruction instr = code.at(line);
+    switch(instr.code) {
+      case instruction_code::JUMP:
+      case instruction_code::JUMPR:
+      case instruction_code::STRK:
+      case instruction_code::HALT:
+        return false;
+      case instruction_code::JPOS:
+      case instruction_code::JZERO:
+        if(instr.target == exit_line) {
+          instr.code = instr.code == instruction_code::JPOS ? instruction_code::JZERO : instruction_code::JPOS;
+          instr.target = line + 1;
+          condition.push_back(instr);
+          return true;
+        }
+        break;
+      default:
+        break;
+    }
+    condition.push_back(instr);
+  }
+  return false;
+}
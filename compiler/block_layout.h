@@ -0,0 +1,37 @@
+#ifndef CUSTOMCOMPILER_COMPILER_BLOCK_LAYOUT_H_
+#define CUSTOMCOMPILER_COMPILER_BLOCK_LAYOUT_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "compiler_stats.h"
+#include "instruction.h"
+
+// longest loop condition, that is copied to the end of loop body
+const long long int k_max_rotated_condition_length = 16;
+
+/**
+ * Changes layout of final code of whole program, before peephole optimizer. Jumps to unconditional jumps are
+ * redirected to their final targets and unreachable instructions are removed. Loop ending with JUMP back to its
+ * condition is rotated, copy of the condition with inverted last jump replaces the JUMP, so every iteration
+ * continues in loop body without executing unconditional jump.
+ */
+class BlockLayout {
+ public:
+  BlockLayout(std::shared_ptr<CompilerStats> stats, bool thread_jumps, bool rotate_loops);
+  // returns changed code, code that can not be parsed is returned unchanged
+  std::vector<std::string> run(std::vector<std::string> lines);
+
+ private:
+  std::shared_ptr<CompilerStats> stats_;
+  bool thread_jumps_;
+  bool rotate_loops_;
+
+  void threadJumps(std::vector<Instruction> &code);
+  void removeUnreachableCode(std::vector<Instruction> &code);
+  void rotateLoops(std::vector<Instruction> &code);
+  bool copyCondition(const std::vector<Instruction> &code, long long int jump_line,
+                     std::vector<Instruction> &condition);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_BLOCK_LAYOUT_H_
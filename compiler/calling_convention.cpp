@@ -0,0 +1,65 @@
+#include "calling_convention.h"
+#include "flow_analysis.h"
+
+CallingConvention::CallingConvention(std::shared_ptr<CompilerStats> stats) : stats_(stats) {
+}
+
+void CallingConvention::run(FlowGraphs &graphs) {
+  // main program is the last graph and has no arguments
+  for(int i = graphs.size() - 2; i >= 0; i--) {
+    auto graph = graphs.at(i);
+    std::set<std::shared_ptr<Symbol>> arguments;
+    for(auto sym : graph->symbol_table->getSymbols()) {
+      if(sym->type == symbol_type::PROC_ARGUMENT) {
+        arguments.insert(sym);
+      }
+    }
+    for(int j = i + 1; j < graphs.size(); j++) {
+      excludeAliasedArguments(graphs.at(j), graph->proc_name, arguments);
+    }
+    for(auto sym : arguments) {
+      sym->type = symbol_type::VAR;
+      sym->value_argument = true;
+      stats_->addProcedureCounter(graph->proc_name, "value_arguments", 1);
+    }
+  }
+}
+
+/**
+ * Removes arguments of procedure, which can reference the same variable as other argument in some call
+ * of the procedure by given caller.
+ */
+void CallingConvention::excludeAliasedArguments(std::shared_ptr<GraphNode> caller,
+                                                std::string procedure_name,
+                                                std::set<std::shared_ptr<Symbol>> &arguments) {
+  auto symbols = caller->symbol_table;
+  forEachGraphNode(caller, [&](std::shared_ptr<GraphNode> node) {
+    for(auto comm : node->commands) {
+      if(comm->type != command_type::PROC_CALL) {
+        continue;
+      }
+      auto & call = static_cast<ProcedureCallCommand*>(comm)->proc_call_;
+      if(call.name != procedure_name) {
+        continue;
+      }
+      int passed_references = 0;
+      for(auto & arg : call.args) {
+        if(symbols->findSymbol(arg.name)->type == symbol_type::PROC_ARGUMENT) {
+          passed_references++;
+        }
+      }
+      for(auto & arg : call.args) {
+        int passed_times = 0;
+        for(auto & other_arg : call.args) {
+          if(other_arg.name == arg.name) {
+            passed_times++;
+          }
+        }
+        bool reference = symbols->findSymbol(arg.name)->type == symbol_type::PROC_ARGUMENT;
+        if(passed_times > 1 || (reference && passed_references > 1)) {
+          arguments.erase(arg.target_variable_symbol);
+        }
+      }
+    }
+  });
+}
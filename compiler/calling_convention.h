@@ -0,0 +1,33 @@
+#ifndef CUSTOMCOMPILER_COMPILER_CALLING_CONVENTION_H_
+#define CUSTOMCOMPILER_COMPILER_CALLING_CONVENTION_H_
+
+#include <memory>
+#include "code_generator.h"
+#include "compiler_stats.h"
+
+/**
+ * Chooses scalar arguments of procedures, which are passed by value instead of by address. Caller copies value
+ * of passed variable in before the call and copies value of argument out after it, so argument becomes local
+ * variable of procedure - it is accessed with single LOAD/STORE, tracked by constant propagation and liveness
+ * and can be kept in register by register allocation. Argument kept in register is passed in that register.
+ *
+ * Copying keeps semantics of passing by reference only if argument can not reference the same variable as other
+ * argument of procedure. Argument is passed by value if in every call it gets variable, which is not passed in
+ * other argument of the call, and if the variable is argument of caller passed by reference, no other argument of
+ * caller passed by reference is passed in the call. Procedures can call only procedures declared before them, so
+ * procedures are visited backwards and arguments of every caller are already chosen.
+ */
+class CallingConvention {
+ public:
+  explicit CallingConvention(std::shared_ptr<CompilerStats> stats);
+  void run(FlowGraphs &graphs);
+
+ private:
+  std::shared_ptr<CompilerStats> stats_;
+
+  void excludeAliasedArguments(std::shared_ptr<GraphNode> caller,
+                               std::string procedure_name,
+                               std::set<std::shared_ptr<Symbol>> &arguments);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_CALLING_CONVENTION_H_
@@ -0,0 +1,341 @@
+#include <algorithm>
+#include "cloning.h"
+#include "code_generator.h"
+#include "command_copy.h"
+#include "flow_analysis.h"
+
+namespace {
+// clones can add at least this many commands, even to small programs
+const long long int k_min_size_budget = 100;
+// percent of size of program, which clones can add to large programs
+const long long int k_size_budget_percent = 50;
+
+void addValueNames(VariableContainer* var, std::set<std::string> &names) {
+  if(var->type != variable_type::R_VAL) {
+    names.insert(var->getVariableName());
+  }
+  if(var->type == variable_type::VARIABLE_INDEXED_ARR) {
+    names.insert(var->getIndexVariableName());
+  }
+}
+
+Command* constantAssignment(std::string variable_name, size_t value) {
+  Variable* var = new Variable;
+  var->type = variable_type::VAR;
+  var->var_name = variable_name;
+  RValue* r_value = new RValue;
+  r_value->type = variable_type::R_VAL;
+  r_value->value = value;
+  DefaultExpression* expression = new DefaultExpression;
+  expression->var_ = r_value;
+  AssignmentCommand* command = new AssignmentCommand;
+  command->left_var_ = var;
+  command->expression_ = expression;
+  command->type = command_type::ASSIGNMENT;
+  return command;
+}
+}  // namespace
+
+ProcedureCloning::ProcedureCloning(std::shared_ptr<CompilerStats> stats) : stats_(stats) {
+}
+
+void ProcedureCloning::run(std::vector<Procedure> &procedures, Procedure &main) {
+  procedures_ = &procedures;
+  long long int program_size = commandsSize(main.commands);
+  for(auto & proc : procedures) {
+    program_size += commandsSize(proc.commands);
+    std::set<std::string> used;
+    std::set<std::string> written;
+    findUsedNames(proc.commands, used, written);
+    used_names_[proc.head.name] = used;
+    for(auto & arg : proc.head.arguments) {
+      if(written.count(arg.name) > 0) {
+        written_arguments_[proc.head.name].insert(arg.name);
+      }
+    }
+  }
+  size_budget_ = std::max(k_min_size_budget, program_size * k_size_budget_percent / 100);
+  std::vector<std::string> names;
+  for(auto & proc : procedures) {
+    names.push_back(proc.head.name);
+  }
+  specializeCalls(main.commands, main.symbol_table, k_main_procedure_name);
+  // clones are inserted into procedures, so procedures are found by name
+  for(int i = names.size() - 1; i >= 0; i--) {
+    Procedure &proc = procedures.at(findProcedure(names.at(i)));
+    specializeCalls(proc.commands, proc.symbol_table, proc.head.name);
+  }
+  removeUnusedProcedures(main);
+}
+
+/**
+ * Redirects calls to clones of called procedures, tracking local variables, which get constants in straight-line
+ * code before calls. Commands are copied, because creating clones moves procedures.
+ */
+void ProcedureCloning::specializeCalls(std::vector<Command*> commands,
+                                       std::shared_ptr<SymbolTable> symbols,
+                                       std::string caller_name) {
+  std::map<std::string, size_t> constants;
+  for(auto comm : commands) {
+    if(comm->type == command_type::IF_ELSE) {
+      IfElseCommand* if_else_command = static_cast<IfElseCommand*>(comm);
+      specializeCalls(if_else_command->then_commands_, symbols, caller_name);
+      specializeCalls(if_else_command->else_commands_, symbols, caller_name);
+      constants.clear();
+    } else if(comm->type == command_type::WHILE) {
+      specializeCalls(static_cast<WhileCommand*>(comm)->commands_, symbols, caller_name);
+      constants.clear();
+    } else if(comm->type == command_type::REPEAT) {
+      specializeCalls(static_cast<RepeatUntilCommand*>(comm)->commands_, symbols, caller_name);
+      constants.clear();
+    } else if(comm->type == command_type::PROC_CALL) {
+      ProcedureCallCommand* procedure_call_command = static_cast<ProcedureCallCommand*>(comm);
+      specializeCall(procedure_call_command, symbols, constants, caller_name);
+      auto & written_arguments = written_arguments_[procedure_call_command->proc_call_.name];
+      for(auto & arg : procedure_call_command->proc_call_.args) {
+        if(written_arguments.count(arg.target_variable_symbol->symbol_name) > 0) {
+          constants.erase(arg.name);
+        }
+      }
+    } else {
+      for(auto & name : commandWrittenVariables(comm)) {
+        constants.erase(name);
+      }
+      if(comm->type != command_type::ASSIGNMENT) {
+        continue;
+      }
+      // arguments of caller can reference variables changed by other arguments, so only locals are tracked
+      AssignmentCommand* assignment_command = static_cast<AssignmentCommand*>(comm);
+      VariableContainer* left_var = assignment_command->left_var_;
+      DefaultExpression* expression = assignment_command->expression_;
+      if(left_var->type == variable_type::VAR &&
+          symbols->findSymbol(left_var->getVariableName())->type == symbol_type::VAR &&
+          !expressionRightOperand(expression) && expression->var_->type == variable_type::R_VAL) {
+        constants[left_var->getVariableName()] = expression->var_->getValue();
+      }
+    }
+  }
+}
+
+/**
+ * Binds arguments of call passed only once in the call and used by called procedure: arrays of caller and
+ * constants not changed by procedure. Call with bound arguments is redirected to clone, constants are not
+ * passed anymore.
+ */
+void ProcedureCloning::specializeCall(ProcedureCallCommand* command,
+                                      std::shared_ptr<SymbolTable> symbols,
+                                      std::map<std::string, size_t> &constants,
+                                      std::string caller_name) {
+  auto & call = command->proc_call_;
+  Procedure callee = procedures_->at(findProcedure(call.name));
+  auto & used_names = used_names_[call.name];
+  auto & written_arguments = written_arguments_[call.name];
+  std::map<std::string, std::shared_ptr<Symbol>> arrays;
+  std::map<std::string, size_t> bound_constants;
+  for(auto & arg : call.args) {
+    auto target_sym = arg.target_variable_symbol;
+    if(used_names.count(target_sym->symbol_name) == 0) {
+      continue;
+    }
+    auto sym = symbols->findSymbol(arg.name);
+    long long int passed_times = std::count_if(call.args.begin(), call.args.end(),
+                                               [&arg](ProcedureCallArgument &other_arg) {
+      return other_arg.name == arg.name;
+    });
+    // variable passed twice can be changed through other argument
+    if(passed_times > 1) {
+      continue;
+    }
+    if(target_sym->type == symbol_type::PROC_ARRAY_ARGUMENT && sym->type == symbol_type::ARR) {
+      arrays[target_sym->symbol_name] = sym->memory_owner ? sym->memory_owner : sym;
+    } else if(target_sym->type == symbol_type::PROC_ARGUMENT && constants.count(arg.name) > 0 &&
+        written_arguments.count(target_sym->symbol_name) == 0) {
+      bound_constants[target_sym->symbol_name] = constants.at(arg.name);
+    }
+  }
+  if(arrays.empty() && bound_constants.empty()) {
+    return;
+  }
+  // arrays are bound by their addresses, which are unique before memory layout
+  std::string key = call.name;
+  for(auto & array : arrays) {
+    key += " " + array.first + "@" + std::to_string(array.second->mem_start);
+  }
+  for(auto & constant : bound_constants) {
+    key += " " + constant.first + "=" + std::to_string(constant.second);
+  }
+  auto found_clone = clones_.find(key);
+  std::string clone_name;
+  if(found_clone != clones_.end()) {
+    clone_name = found_clone->second;
+  } else {
+    long long int size = commandsSize(callee.commands);
+    if(size > size_budget_) {
+      return;
+    }
+    size_budget_ -= size;
+    clone_name = cloneProcedure(callee, arrays, bound_constants);
+    clones_[key] = clone_name;
+  }
+  auto clone_symbols = procedures_->at(findProcedure(clone_name)).symbol_table;
+  std::vector<ProcedureCallArgument> args;
+  for(auto arg : call.args) {
+    std::string argument_name = arg.target_variable_symbol->symbol_name;
+    if(bound_constants.count(argument_name) == 0) {
+      arg.target_variable_symbol = clone_symbols->findSymbol(argument_name);
+      args.push_back(arg);
+    }
+  }
+  call.name = clone_name;
+  call.args = args;
+  stats_->addProcedureCounter(caller_name, "calls_specialized", 1);
+}
+
+/**
+ * Creates clone of procedure with bound arguments and specializes its calls. Clone is placed right after cloned
+ * procedure, so it is declared before all its callers.
+ */
+std::string ProcedureCloning::cloneProcedure(Procedure callee,
+                                             std::map<std::string, std::shared_ptr<Symbol>> &arrays,
+                                             std::map<std::string, size_t> &constants) {
+  Procedure clone;
+  // names of source procedures can not contain digits, so generated name is unique
+  clone.head.name = callee.head.name + "_" + std::to_string(clones_count_++);
+  clone.symbol_table = std::make_shared<SymbolTable>();
+  std::vector<Command*> start_commands;
+  for(auto sym : callee.symbol_table->getSymbols()) {
+    Symbol symbol = *sym;
+    symbol.memory_owner = sym->memory_owner ? sym->memory_owner : sym;
+    if(arrays.count(sym->symbol_name) > 0) {
+      symbol.memory_owner = arrays.at(sym->symbol_name);
+      symbol.type = symbol_type::ARR;
+      symbol.length = symbol.memory_owner->length;
+      symbol.bound_array_argument = true;
+    } else if(constants.count(sym->symbol_name) > 0) {
+      // memory of argument is not used by cloned procedure during execution of clone, so it can hold the value
+      symbol.type = symbol_type::VAR;
+      symbol.initialized = true;
+      start_commands.push_back(constantAssignment(sym->symbol_name, constants.at(sym->symbol_name)));
+    } else if(sym->type == symbol_type::VAR && !sym->proc_jump_back_mem) {
+      symbol.memory_shared = true;
+      symbol.memory_owner->memory_shared = true;
+    }
+    symbol.mem_start = symbol.memory_owner->mem_start;
+    if(sym->proc_jump_back_mem) {
+      clone.symbol_table->addProcJumpBackMemoryAddress(symbol);
+    } else {
+      clone.symbol_table->addSymbol(symbol, 0);
+    }
+  }
+  for(auto & arg : callee.head.arguments) {
+    if(constants.count(arg.name) == 0) {
+      clone.head.arguments.push_back(arg);
+    }
+  }
+  CommandCopy copy;
+  clone.commands = copy.copyCommands(callee.commands);
+  clone.commands.insert(clone.commands.begin(), start_commands.begin(), start_commands.end());
+  used_names_[clone.head.name] = used_names_[callee.head.name];
+  written_arguments_[clone.head.name] = written_arguments_[callee.head.name];
+  stats_->addCounter("procedures_cloned", 1);
+  specializeCalls(clone.commands, clone.symbol_table, clone.head.name);
+  procedures_->insert(procedures_->begin() + findProcedure(callee.head.name) + 1, clone);
+  return clone.head.name;
+}
+
+/**
+ * Collects names of variables and arrays used by commands and variables, which commands can change - assigned,
+ * read or passed to procedures changing their arguments.
+ */
+void ProcedureCloning::findUsedNames(std::vector<Command*> &commands,
+                                     std::set<std::string> &used,
+                                     std::set<std::string> &written) {
+  for(auto comm : commands) {
+    if(comm->type == command_type::IF_ELSE) {
+      IfElseCommand* if_else_command = static_cast<IfElseCommand*>(comm);
+      addValueNames(if_else_command->cond_.left_var_, used);
+      addValueNames(if_else_command->cond_.right_var_, used);
+      findUsedNames(if_else_command->then_commands_, used, written);
+      findUsedNames(if_else_command->else_commands_, used, written);
+    } else if(comm->type == command_type::WHILE) {
+      WhileCommand* while_command = static_cast<WhileCommand*>(comm);
+      addValueNames(while_command->cond_.left_var_, used);
+      addValueNames(while_command->cond_.right_var_, used);
+      findUsedNames(while_command->commands_, used, written);
+    } else if(comm->type == command_type::REPEAT) {
+      RepeatUntilCommand* repeat_command = static_cast<RepeatUntilCommand*>(comm);
+      addValueNames(repeat_command->cond_.left_var_, used);
+      addValueNames(repeat_command->cond_.right_var_, used);
+      findUsedNames(repeat_command->commands_, used, written);
+    } else if(comm->type == command_type::PROC_CALL) {
+      ProcedureCallCommand* procedure_call_command = static_cast<ProcedureCallCommand*>(comm);
+      auto & written_arguments = written_arguments_[procedure_call_command->proc_call_.name];
+      for(auto & arg : procedure_call_command->proc_call_.args) {
+        used.insert(arg.name);
+        if(written_arguments.count(arg.target_variable_symbol->symbol_name) > 0) {
+          written.insert(arg.name);
+        }
+      }
+    } else {
+      for(auto var : commandAccessedValues(comm)) {
+        addValueNames(var, used);
+      }
+      auto command_written = commandWrittenVariables(comm);
+      written.insert(command_written.begin(), command_written.end());
+    }
+  }
+}
+
+int ProcedureCloning::findProcedure(std::string name) {
+  for(int i = 0; i < procedures_->size(); i++) {
+    if(procedures_->at(i).head.name == name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+long long int ProcedureCloning::commandsSize(std::vector<Command*> &commands) {
+  long long int size = 0;
+  for(auto comm : commands) {
+    size++;
+    if(comm->type == command_type::IF_ELSE) {
+      size += commandsSize(static_cast<IfElseCommand*>(comm)->then_commands_);
+      size += commandsSize(static_cast<IfElseCommand*>(comm)->else_commands_);
+    } else if(comm->type == command_type::WHILE) {
+      size += commandsSize(static_cast<WhileCommand*>(comm)->commands_);
+    } else if(comm->type == command_type::REPEAT) {
+      size += commandsSize(static_cast<RepeatUntilCommand*>(comm)->commands_);
+    }
+  }
+  return size;
+}
+
+void ProcedureCloning::countCalls(std::vector<Command*> &commands, std::map<std::string, long long int> &calls) {
+  for(auto comm : commands) {
+    if(comm->type == command_type::IF_ELSE) {
+      countCalls(static_cast<IfElseCommand*>(comm)->then_commands_, calls);
+      countCalls(static_cast<IfElseCommand*>(comm)->else_commands_, calls);
+    } else if(comm->type == command_type::WHILE) {
+      countCalls(static_cast<WhileCommand*>(comm)->commands_, calls);
+    } else if(comm->type == command_type::REPEAT) {
+      countCalls(static_cast<RepeatUntilCommand*>(comm)->commands_, calls);
+    } else if(comm->type == command_type::PROC_CALL) {
+      calls[static_cast<ProcedureCallCommand*>(comm)->proc_call_.name]++;
+    }
+  }
+}
+
+// procedures are removed from the last one, as they can be called only by procedures declared later
+void ProcedureCloning::removeUnusedProcedures(Procedure &main) {
+  std::map<std::string, long long int> calls;
+  countCalls(main.commands, calls);
+  for(int i = procedures_->size() - 1; i >= 0; i--) {
+    if(calls[procedures_->at(i).head.name] > 0) {
+      countCalls(procedures_->at(i).commands, calls);
+    } else {
+      stats_->addCounter("procedures_removed", 1);
+      procedures_->erase(procedures_->begin() + i);
+    }
+  }
+}
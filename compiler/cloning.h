@@ -0,0 +1,59 @@
+#ifndef CUSTOMCOMPILER_COMPILER_CLONING_H_
+#define CUSTOMCOMPILER_COMPILER_CLONING_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "compiler_stats.h"
+#include "data.h"
+
+/**
+ * Cloning of procedures specialized for arguments bound by callers, performed on commands of procedures after
+ * inlining. Array of caller (not its argument) passed in call is bound to array argument of clone, which accesses
+ * it directly at its address instead of loading address passed by the caller. Scalar argument, which is not
+ * written by procedure and gets variable assigned a constant just before the call, is replaced in clone by local
+ * variable set to the constant at its start, so constant propagation works inside the clone.
+ *
+ * Calls with the same bindings share one clone. Clone uses memory of cloned procedure for its other symbols, so
+ * local variables keep their values between calls of procedure and its clones - procedures can not be recursive,
+ * so they are never active at the same time. Procedures can call only procedures declared before them, so
+ * callers are processed before called procedures, starting from main program, and calls of every clone are
+ * specialized when it is created. Clones are created while total size of their commands fits in budget growing
+ * with size of program, procedures not called anymore are removed.
+ */
+class ProcedureCloning {
+ public:
+  explicit ProcedureCloning(std::shared_ptr<CompilerStats> stats);
+  void run(std::vector<Procedure> &procedures, Procedure &main);
+
+ private:
+  std::shared_ptr<CompilerStats> stats_;
+  std::vector<Procedure> *procedures_ = nullptr;
+  long long int size_budget_ = 0;
+  int clones_count_ = 0;
+  // names of clones, by name of cloned procedure and bindings of its arguments
+  std::map<std::string, std::string> clones_;
+  // names used by commands of procedure and arguments, which procedure can change, by procedure name
+  std::map<std::string, std::set<std::string>> used_names_;
+  std::map<std::string, std::set<std::string>> written_arguments_;
+
+  void specializeCalls(std::vector<Command*> commands,
+                       std::shared_ptr<SymbolTable> symbols,
+                       std::string caller_name);
+  void specializeCall(ProcedureCallCommand* command,
+                      std::shared_ptr<SymbolTable> symbols,
+                      std::map<std::string, size_t> &constants,
+                      std::string caller_name);
+  std::string cloneProcedure(Procedure callee,
+                             std::map<std::string, std::shared_ptr<Symbol>> &arrays,
+                             std::map<std::string, size_t> &constants);
+  void findUsedNames(std::vector<Command*> &commands, std::set<std::string> &used, std::set<std::string> &written);
+  int findProcedure(std::string name);
+  long long int commandsSize(std::vector<Command*> &commands);
+  void countCalls(std::vector<Command*> &commands, std::map<std::string, long long int> &calls);
+  void removeUnusedProcedures(Procedure &main);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_CLONING_H_
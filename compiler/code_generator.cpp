@@ -1,16 +1,29 @@
 #include <math.h>
+#include <map>
 #include <sstream>
+#include <stdexcept>
 #include "code_generator.h"
+#include "flow_analysis.h"
+#include "instruction.h"
+#include "procedure_cache.h"
+
+// has to be changed every time generated code changes for the same input
+const std::string k_code_generator_version = "15";
 
 CodeGenerator::CodeGenerator() {
-  std::vector<std::string> register_names{"b", "c", "d", "e", "f", "g", "h"};
   accumulator_ = std::make_shared<Register>();
   accumulator_->register_name_ = "a";
-  for(auto name : register_names) {
-    std::shared_ptr<Register> new_reg = std::make_shared<Register>();
-    new_reg->register_name_ = name;
-    registers_.push_back(new_reg);
-  }
+  setAllocatedRegisters(std::make_shared<GraphNode>());
+  stats_ = std::make_shared<CompilerStats>();
+}
+
+void CodeGenerator::setStats(std::shared_ptr<CompilerStats> stats) {
+  stats_ = stats;
+}
+
+void CodeGenerator::setProcedureCache(std::shared_ptr<ProcedureCache> cache, std::string options_fingerprint) {
+  procedure_cache_ = cache;
+  options_fingerprint_ = options_fingerprint;
 }
 
 void CodeGenerator::generateFlowGraph(Procedure main, std::vector<Procedure> procedures) {
@@ -27,29 +40,343 @@ void CodeGenerator::generateCode() {
   bool first_proc = true;
   for(int i = 0; i < procedures_start_nodes_.size(); i++) {
     current_symbol_table_ = symbol_tables_.at(i);
+    current_procedure_name_ = procedures_names_.at(i);
     auto proc_start = procedures_start_nodes_.at(i);
     if(first_proc) {
       current_start_line_ = 1;
       generate_jump_to_main_ = true;
       first_proc = false;
     }
+    std::string cache_key;
+    if(procedure_cache_) {
+      cache_key = ProcedureCache::computeKey(describeProcedure(i));
+      std::vector<std::string> fragment;
+      std::vector<std::string> lines;
+      if(procedure_cache_->loadFragment(cache_key, fragment) && linkProcedureCode(fragment, lines)) {
+        // whole procedure is replaced by single node holding already generated code
+        auto cached_node = std::make_shared<GraphNode>();
+        cached_node->proc_name = proc_start->proc_name;
+        cached_node->code_list_ = lines;
+        cached_node->start_line_ = current_start_line_;
+        procedures_start_nodes_.at(i) = cached_node;
+        current_start_line_ += lines.size();
+        stats_->addProcedureCounter(current_procedure_name_, "cache_hits", 1);
+        summarizeProcedure(proc_start, lines);
+        continue;
+      }
+    }
+    long long int proc_start_line = current_start_line_;
+    setAllocatedRegisters(proc_start);
     generateProcedureStart(proc_start);
+    long long int code_length_before_loading = proc_start->code_list_.size();
+    // arguments passed by value in registers are already in their registers
+    loadAllocatedVariables(proc_start, withoutRegisterArguments(proc_start->live_in_));
+    current_start_line_ += proc_start->code_list_.size() - code_length_before_loading;
     generateCodePreorder(proc_start);
     generateProcedureEnd(proc_start);
+    std::vector<std::string> lines;
+    flattenGraph(proc_start, lines);
+    summarizeProcedure(proc_start, lines);
+    if(procedure_cache_) {
+      stats_->addProcedureCounter(current_procedure_name_, "cache_misses", 1);
+      std::vector<std::string> fragment;
+      if(relocateProcedureCode(proc_start_line, lines, fragment)) {
+        procedure_cache_->storeFragment(cache_key, fragment);
+      }
+    }
   }
   current_symbol_table_ = symbol_tables_.at(symbol_tables_.size() - 1);
+  current_procedure_name_ = k_main_procedure_name;
+  setAllocatedRegisters(start_node);
+  start_node->start_line_ = current_start_line_;
+  loadAllocatedVariables(start_node, start_node->live_in_);
+  current_start_line_ += start_node->code_list_.size();
   generateCodePreorder(start_node);
 }
 
+/**
+ * Computes summary of procedure from its flow graph and generated code. Procedures can call only procedures
+ * declared earlier, so summaries of all called procedures are already known.
+ */
+void CodeGenerator::summarizeProcedure(std::shared_ptr<GraphNode> graph, std::vector<std::string> lines) {
+  ProcedureCallSummary summary;
+  std::set<std::string> read;
+  std::set<std::string> written;
+  auto addReadValue = [&read](VariableContainer* var) {
+    if(var->type != variable_type::R_VAL) {
+      read.insert(var->getVariableName());
+    }
+    if(var->type == variable_type::VARIABLE_INDEXED_ARR) {
+      read.insert(var->getIndexVariableName());
+    }
+  };
+  auto addWrittenValue = [&read, &written](VariableContainer* var) {
+    written.insert(var->getVariableName());
+    if(var->type == variable_type::VARIABLE_INDEXED_ARR) {
+      read.insert(var->getIndexVariableName());
+    }
+  };
+  forEachGraphNode(graph, [&](std::shared_ptr<GraphNode> node) {
+    for(auto comm : node->commands) {
+      if(comm->type == command_type::ASSIGNMENT) {
+        AssignmentCommand* assignment_command = static_cast<AssignmentCommand*>(comm);
+        addWrittenValue(assignment_command->left_var_);
+        addReadValue(assignment_command->expression_->var_);
+        VariableContainer** right_operand = expressionRightOperand(assignment_command->expression_);
+        if(right_operand) {
+          addReadValue(*right_operand);
+        }
+      } else if(comm->type == command_type::READ) {
+        addWrittenValue(static_cast<ReadCommand*>(comm)->var_);
+      } else if(comm->type == command_type::WRITE) {
+        addReadValue(static_cast<WriteCommand*>(comm)->written_value_);
+      } else if(comm->type == command_type::PROC_CALL) {
+        ProcedureCallCommand* procedure_call_command = static_cast<ProcedureCallCommand*>(comm);
+        auto & called_summary = procedures_summaries_.at(procedure_call_command->proc_call_.name);
+        for(auto & arg : procedure_call_command->proc_call_.args) {
+          if(called_summary.read_arguments.count(arg.target_variable_symbol->symbol_name) > 0) {
+            read.insert(arg.name);
+          }
+          if(called_summary.written_arguments.count(arg.target_variable_symbol->symbol_name) > 0) {
+            written.insert(arg.name);
+          }
+        }
+        summary.clobbered_registers.insert(called_summary.clobbered_registers.begin(),
+                                           called_summary.clobbered_registers.end());
+      }
+    }
+    if(node->cond) {
+      addReadValue(node->cond->left_var_);
+      addReadValue(node->cond->right_var_);
+    }
+  });
+  for(auto sym : current_symbol_table_->getSymbols()) {
+    if(sym->type != symbol_type::PROC_ARGUMENT && sym->type != symbol_type::PROC_ARRAY_ARGUMENT &&
+        !sym->value_argument && !sym->bound_array_argument) {
+      continue;
+    }
+    if(read.count(sym->symbol_name) > 0) {
+      summary.read_arguments.insert(sym->symbol_name);
+    }
+    if(written.count(sym->symbol_name) > 0) {
+      summary.written_arguments.insert(sym->symbol_name);
+    }
+    if(sym->value_argument) {
+      // caller writes registers of arguments, even if procedure only reads them
+      auto allocation = graph->allocated_registers.find(sym->symbol_name);
+      std::string register_name = allocation != graph->allocated_registers.end() ? allocation->second : "";
+      summary.value_arguments[sym->symbol_name] = register_name;
+      if(!register_name.empty()) {
+        summary.clobbered_registers.insert(register_name);
+      }
+    }
+  }
+  for(auto & line : lines) {
+    Instruction instr;
+    if(!parseInstruction(line, instr)) {
+      summary.clobbered_registers = {"a", "b", "c", "d", "e", "f", "g", "h"};
+      break;
+    }
+    std::string reg = writtenRegister(instr);
+    if(!reg.empty()) {
+      summary.clobbered_registers.insert(reg);
+    }
+  }
+  procedures_summaries_[current_procedure_name_] = summary;
+}
+
 std::vector<std::shared_ptr<GraphNode>> CodeGenerator::getGraphs() {
   std::vector<std::shared_ptr<GraphNode>> nodes(procedures_start_nodes_);
   nodes.push_back(start_node);
   return nodes;
 }
 
+std::vector<std::string> CodeGenerator::getGraphsNames() {
+  std::vector<std::string> names(procedures_names_);
+  names.push_back(k_main_procedure_name);
+  return names;
+}
+
+void CodeGenerator::flattenGraph(std::shared_ptr<GraphNode> node, std::vector<std::string> &lines) {
+  for(auto & line : node->code_list_) {
+    lines.push_back(line);
+  }
+  if(node->left_node)
+    flattenGraph(node->left_node, lines);
+  if(node->right_node)
+    flattenGraph(node->right_node, lines);
+  if(node->jump_line_target) {
+    lines.push_back("JUMP " + std::to_string(node->jump_line_target->start_line_));
+  } else if(node->jump_condition_target) {
+    lines.push_back("JUMP " + std::to_string(node->jump_condition_target->condition_start_line_));
+  }
+}
+
+/**
+ * Builds text that identifies generated code of procedure - everything that code generation of
+ * single procedure depends on: generator version, code generation options, memory layout of symbols
+ * and flow graph with commands.
+ */
+std::string CodeGenerator::describeProcedure(int proc_index) {
+  std::stringstream description;
+  description << "version " << k_code_generator_version << "\n";
+  description << "options " << options_fingerprint_ << "\n";
+  description << "procedure " << procedures_names_.at(proc_index) << "\n";
+  description << "return " << procedures_start_nodes_.at(proc_index)->return_address_register << "\n";
+  for(auto sym : symbol_tables_.at(proc_index)->getSymbols()) {
+    description << "symbol " << sym->symbol_name << " " << sym->type << " " << sym->mem_start << " "
+                << sym->length << " " << sym->proc_jump_back_mem << "\n";
+  }
+  // number nodes in preorder first, so jumps to nodes visited later can be described
+  std::vector<std::shared_ptr<GraphNode>> nodes;
+  std::map<GraphNode*, int> node_ids;
+  std::vector<std::shared_ptr<GraphNode>> nodes_to_visit{procedures_start_nodes_.at(proc_index)};
+  while(!nodes_to_visit.empty()) {
+    auto node = nodes_to_visit.back();
+    nodes_to_visit.pop_back();
+    node_ids[node.get()] = nodes.size();
+    nodes.push_back(node);
+    if(node->right_node)
+      nodes_to_visit.push_back(node->right_node);
+    if(node->left_node)
+      nodes_to_visit.push_back(node->left_node);
+  }
+  auto nodeId = [&node_ids](std::shared_ptr<GraphNode> node) {
+    return node ? node_ids.at(node.get()) : -1;
+  };
+  for(auto node : nodes) {
+    description << "node " << nodeId(node) << " left " << nodeId(node->left_node)
+                << " right " << nodeId(node->right_node)
+                << " jump " << nodeId(node->jump_line_target)
+                << " jump_cond " << nodeId(node->jump_condition_target)
+                << " save " << node->should_save_registers_after_code << "\n";
+    for(auto comm : node->commands) {
+      description << "  " << describeCommand(comm) << "\n";
+    }
+    if(node->cond) {
+      description << "  cond " << node->cond->stringify() << "\n";
+    }
+  }
+  return description.str();
+}
+
+std::string CodeGenerator::describeCommand(Command *comm) {
+  if(comm->type == command_type::ASSIGNMENT) {
+    AssignmentCommand* assignment_command = static_cast<AssignmentCommand*>(comm);
+    return assignment_command->left_var_->stringify() + " := " + assignment_command->expression_->stringify();
+  } else if(comm->type == command_type::READ) {
+    return "READ " + static_cast<ReadCommand*>(comm)->var_->stringify();
+  } else if(comm->type == command_type::WRITE) {
+    return "WRITE " + static_cast<WriteCommand*>(comm)->written_value_->stringify();
+  } else if(comm->type == command_type::PROC_CALL) {
+    ProcedureCallCommand* procedure_call_command = static_cast<ProcedureCallCommand*>(comm);
+    std::string result = "CALL " + procedure_call_command->proc_call_.name;
+    for(auto & arg : procedure_call_command->proc_call_.args) {
+      result += " " + arg.name + "->" + std::to_string(arg.target_variable_symbol->mem_start);
+    }
+    // code of call depends on summary of called procedure
+    auto & summary = procedures_summaries_.at(procedure_call_command->proc_call_.name);
+    for(auto & argument : summary.read_arguments) {
+      result += " read " + argument;
+    }
+    for(auto & argument : summary.written_arguments) {
+      result += " written " + argument;
+    }
+    for(auto & reg : summary.clobbered_registers) {
+      result += " clobbered " + reg;
+    }
+    for(auto & argument : summary.value_arguments) {
+      result += " value " + argument.first + " " + argument.second;
+    }
+    return result;
+  }
+  return "";
+}
+
+/**
+ * Converts code of procedure starting at given line into relocatable fragment.
+ * Returns false if code contains jump, that can not be expressed relatively to procedure start
+ * or as call of other procedure.
+ */
+bool CodeGenerator::relocateProcedureCode(long long int proc_start_line,
+                                          std::vector<std::string> lines,
+                                          std::vector<std::string> &fragment) {
+  long long int proc_end_line = proc_start_line + lines.size();
+  fragment.clear();
+  for(auto & line : lines) {
+    Instruction instr;
+    if(!parseInstruction(line, instr)) {
+      return false;
+    }
+    if(!isJumpInstruction(instr.code)) {
+      fragment.push_back(line);
+      continue;
+    }
+    std::string target;
+    if(instr.target >= proc_start_line && instr.target < proc_end_line) {
+      target = "@" + std::to_string(instr.target - proc_start_line);
+    } else {
+      for(int i = 0; i < procedures_start_nodes_.size(); i++) {
+        if(procedures_start_nodes_.at(i)->start_line_ == instr.target) {
+          target = "$" + procedures_names_.at(i);
+          break;
+        }
+      }
+      if(target.empty()) {
+        return false;
+      }
+    }
+    fragment.push_back(instructionMnemonic(instr.code) + " " + target +
+                       (instr.comment.empty() ? "" : " # " + instr.comment));
+  }
+  return true;
+}
+
+/**
+ * Resolves relocatable fragment into code placed at current start line.
+ * Returns false if fragment is malformed or calls procedure that does not exist.
+ */
+bool CodeGenerator::linkProcedureCode(std::vector<std::string> fragment, std::vector<std::string> &lines) {
+  lines.clear();
+  for(auto & line : fragment) {
+    std::stringstream line_stream(line);
+    std::string mnemonic;
+    std::string target;
+    line_stream >> mnemonic >> target;
+    if(target.empty() || (target.at(0) != '@' && target.at(0) != '$')) {
+      lines.push_back(line);
+      continue;
+    }
+    long long int target_line = -1;
+    if(target.at(0) == '@') {
+      try {
+        target_line = current_start_line_ + std::stoll(target.substr(1));
+      } catch(std::exception & e) {
+        return false;
+      }
+    } else {
+      std::string proc_name = target.substr(1);
+      for(int i = 0; i < procedures_names_.size(); i++) {
+        if(procedures_names_.at(i) == proc_name) {
+          target_line = procedures_start_nodes_.at(i)->start_line_;
+          break;
+        }
+      }
+    }
+    if(target_line < 0) {
+      return false;
+    }
+    size_t comment_start = line.find('#');
+    lines.push_back(mnemonic + " " + std::to_string(target_line) +
+                    (comment_start == std::string::npos ? "" : " " + line.substr(comment_start)));
+  }
+  return fragment.size() == lines.size();
+}
+
 std::shared_ptr<GraphNode> CodeGenerator::generateSingleFlowGraph(Procedure proc) {
   std::shared_ptr<GraphNode> curr_node = std::make_shared<GraphNode>();
   curr_node->proc_name = proc.head.name;
+  curr_node->symbol_table = proc.symbol_table;
   process_commands(proc.commands, curr_node);
   return curr_node;
 }
@@ -132,8 +459,18 @@ void CodeGenerator::generateCodePreorder(std::shared_ptr<GraphNode> node) {
   // generate code for current node
   if(code_length_before_generation == 0)
     node->start_line_ = current_start_line_;
-  for(auto comm : node->commands) {
+  for(int i = 0; i < node->commands.size(); i++) {
+    auto comm = node->commands.at(i);
     long long int code_length_before_command = node->code_list_.size();
+    if(node->liveness_computed_) {
+      // values read by command can be spilled during its generation, so they are live too
+      std::set<std::string> live_variables = node->live_after_commands_.at(i);
+      auto & live_before = i == 0 ? node->live_in_ : node->live_after_commands_.at(i - 1);
+      live_variables.insert(live_before.begin(), live_before.end());
+      setLiveVariables(node, live_variables);
+    } else {
+      setLiveVariables(node, {});
+    }
     if(comm->type == command_type::ASSIGNMENT) {
       AssignmentCommand* assignment_command = static_cast<AssignmentCommand*>(comm);
       handleAssignmentCommand(assignment_command, node);
@@ -150,11 +487,18 @@ void CodeGenerator::generateCodePreorder(std::shared_ptr<GraphNode> node) {
     }
     current_start_line_ += node->code_list_.size() - code_length_before_command;
   }
-  std::vector<std::shared_ptr<Register>> saved_regs;
+  std::vector<std::shared_ptr<Register>> registers_after_condition;
+  std::vector<std::shared_ptr<Register>> registers_outside_loop;
   if(node->cond) {
-    // save all registers and prepare condition
+    // save all registers and prepare condition; loop condition is reached also by jump from end of loop body,
+    // so values of registers can not be used in it
     long long int code_length_before_saving_regs = node->code_list_.size();
-    saveRegistersValues(node);
+    setLiveVariables(node, node->live_before_condition_);
+    saveRegistersValues(node, !isLoopConditionNode(node));
+    if(!node->loop_allocated_registers.empty() || !node->loop_array_registers.empty()) {
+      registers_outside_loop = registers_;
+      allocateLoopRegisters(node);
+    }
     long long int code_length_after_saving_regs = node->code_list_.size();
     current_start_line_ += code_length_after_saving_regs - code_length_before_saving_regs;
     node->condition_start_line_ = current_start_line_;
@@ -162,9 +506,7 @@ void CodeGenerator::generateCodePreorder(std::shared_ptr<GraphNode> node) {
     long long int code_length_after_condition_preparation = node->code_list_.size();
     current_start_line_ += node->cond->getConditionCodeSize() +
         (code_length_after_condition_preparation - code_length_after_saving_regs);
-  }
-  if(node->jump_line_target) {  // save registers state after condition
-    saved_regs = saveRegistersState();
+    registers_after_condition = saveRegistersState();
   }
 
   // generate left node code
@@ -176,21 +518,38 @@ void CodeGenerator::generateCodePreorder(std::shared_ptr<GraphNode> node) {
       tmp_node = tmp_node->right_node;
     }
     long long int code_length_bef_saving_variables = tmp_node->code_list_.size();
-    saveRegistersValues(tmp_node);
+    setLiveVariables(tmp_node, tmp_node->live_out_);
+    saveRegistersValues(tmp_node, true);
+    condition_node_kind kind = conditionNodeKind(node);
+    if(kind == condition_node_kind::IF) {
+      // code after condition is reached from end of left branch and by jump from condition
+      mergeRegistersState(tmp_node, registers_after_condition);
+    } else if(kind == condition_node_kind::IF_ELSE) {
+      // state is merged at the end of right branch, just before next node
+      ifElseNextNode(node)->registers_at_jump_ = saveRegistersState();
+      loadRegistersState(registers_after_condition);
+    } else {
+      loadRegistersState(registers_after_condition);
+    }
     current_start_line_ += tmp_node->code_list_.size() - code_length_bef_saving_variables;
   }
   if(node->cond) {
     generateCondition(node);
   }
-  if(node->jump_line_target) {
-    loadRegistersState(saved_regs);
+  if(!node->loop_allocated_registers.empty() || !node->loop_array_registers.empty()) {
+    releaseLoopRegisters(node, registers_outside_loop);
   }
   if(node->should_save_registers_after_code) {
+    setLiveVariables(node, node->live_out_);
     std::shared_ptr<GraphNode> tmp_node;
     if(node->right_node) {
       tmp_node = node->right_node;
       long long int code_length_before_save = tmp_node->code_list_.size();
-      saveRegistersValues(tmp_node);
+      saveRegistersValues(tmp_node, true);
+      if(!tmp_node->registers_at_jump_.empty()) {
+        mergeRegistersState(tmp_node, tmp_node->registers_at_jump_);
+        tmp_node->registers_at_jump_.clear();
+      }
       current_start_line_ += tmp_node->code_list_.size() - code_length_before_save;
       tmp_node->start_line_ = current_start_line_;
     } else {
@@ -208,10 +567,14 @@ void CodeGenerator::generateCodePreorder(std::shared_ptr<GraphNode> node) {
   }
 }
 
-// TODO(Jakub Drzewiecki): If possible, pass addresses of variables in registers and use addresses in procedures instead of double loading/storing
 void CodeGenerator::generateProcedureStart(std::shared_ptr<GraphNode> node) {
   node->start_line_ = current_start_line_;
-  // store register h to proper memory address
+  if(!node->return_address_register.empty()) {
+    node->code_list_.push_back("PUT " + node->return_address_register + " # return address");
+    current_start_line_ += node->code_list_.size();
+    return;
+  }
+  // store return address from accumulator to proper memory address
   auto sym = current_symbol_table_->getProcedureJumpBackMemoryAddressSymbol();
   auto reg = registers_.at(0);
   getValueIntoRegister(sym->mem_start, reg, node);
@@ -220,31 +583,37 @@ void CodeGenerator::generateProcedureStart(std::shared_ptr<GraphNode> node) {
 }
 
 void CodeGenerator::generateProcedureEnd(std::shared_ptr<GraphNode> node) {
+  std::string return_address_register = node->return_address_register;
   // travel to last node
   while(node->right_node) {
     node = node->right_node;
   }
   long long int code_size_before_generation = node->code_list_.size();
-  // save all procedure arguments
+  setLiveVariables(node, node->live_out_);
+  // save procedure arguments and locals live at the end, locals keep their values between calls
   moveAccumulatorToFreeRegister(node);
   auto free_reg = findFreeRegister(node);
   free_reg->currently_used_ = true;
   for(auto reg : registers_) {
     if(reg->curr_variable && reg->register_name_ != free_reg->register_name_ &&
     (reg->curr_variable->type == variable_type::VAR || reg->curr_variable->type == variable_type::ARR)) {
-      auto sym = current_symbol_table_->findSymbol(reg->curr_variable->getVariableName());
-      if(sym->type == symbol_type::PROC_ARGUMENT || sym->type == symbol_type::PROC_ARRAY_ARGUMENT) {
-        saveVariableFromRegister(reg, free_reg, node, false);
-      }
+      saveVariableFromRegister(reg, free_reg, node, false);
     }
   }
+  // values of locals are kept between calls of procedure, arguments passed by value in registers are copied
+  // out of them by caller
+  storeAllocatedVariables(node, free_reg, withoutRegisterArguments(node->live_out_));
   free_reg->currently_used_ = false;
 
   // load jump back address and jump
-  auto sym = current_symbol_table_->getProcedureJumpBackMemoryAddressSymbol();
-  auto reg = findFreeRegister(node);
-  getValueIntoRegister(sym->mem_start, reg, node);
-  node->code_list_.push_back("LOAD " + reg->register_name_);
+  if(!return_address_register.empty()) {
+    node->code_list_.push_back("GET " + return_address_register + " # return address");
+  } else {
+    auto sym = current_symbol_table_->getProcedureJumpBackMemoryAddressSymbol();
+    auto reg = findFreeRegister(node);
+    getValueIntoRegister(sym->mem_start, reg, node);
+    node->code_list_.push_back("LOAD " + reg->register_name_);
+  }
   node->code_list_.push_back("INC a");
   node->code_list_.push_back("INC a");
   node->code_list_.push_back("JUMPR a");
@@ -286,11 +655,47 @@ void CodeGenerator::saveVariableFromRegister(std::shared_ptr<Register> reg,
   }
   auto sym =
       current_symbol_table_->findSymbol(reg->curr_variable->getVariableName());
+  if(!isVariableLive(var)) {
+    // value is overwritten before being read again, so it does not need to be stored
+    for(auto other_reg : registers_) {
+      if(other_reg->curr_variable && other_reg->register_name_ != reg->register_name_ &&
+      other_reg->curr_variable->stringify() == var->stringify()) {
+        other_reg->variable_saved_ = true;
+        other_reg->curr_variable = nullptr;
+      }
+    }
+    reg->curr_variable = nullptr;
+    reg->currently_used_ = false;
+    reg->variable_saved_ = true;
+    stats_->addProcedureCounter(current_procedure_name_, "stores_eliminated", 1);
+    return;
+  }
+  auto allocated_register = allocated_registers_.find(var->getVariableName());
+  if(var->type == variable_type::VAR && allocated_register != allocated_registers_.end()) {
+    // variable kept in register for whole procedure is saved by moving it to its register
+    if(reg->register_name_ != "a") {
+      node->code_list_.push_back("GET " + reg->register_name_);
+    }
+    node->code_list_.push_back("PUT " + allocated_register->second + " # " + var->stringify());
+    for(auto other_reg : registers_) {
+      if(other_reg->curr_variable && other_reg->register_name_ != reg->register_name_ &&
+      other_reg->curr_variable->stringify() == var->stringify()) {
+        other_reg->variable_saved_ = true;
+        other_reg->curr_variable = nullptr;
+      }
+    }
+    accumulator_->curr_variable = var;
+    accumulator_->variable_saved_ = true;
+    accumulator_->currently_used_ = false;
+    if(!keep_variable) {
+      reg->curr_variable = nullptr;
+    }
+    reg->variable_saved_ = true;
+    return;
+  }
   if(var->type == variable_type::ARR && sym->type == symbol_type::PROC_ARRAY_ARGUMENT) {
-    getValueIntoRegister(sym->mem_start, other_free_reg, node);
-    node->code_list_.push_back("LOAD " + other_free_reg->register_name_);
-    node->code_list_.push_back("PUT " + other_free_reg->register_name_);
-    getValueIntoRegister(var->getValue(), accumulator_, node);
+    getValueIntoRegister(var->getValue(), other_free_reg, node);
+    generateArrayAddress(var->getVariableName(), node);
     node->code_list_.push_back("ADD " + other_free_reg->register_name_);
     node->code_list_.push_back("PUT " + other_free_reg->register_name_);
     node->code_list_.push_back("GET " + reg->register_name_);
@@ -324,6 +729,7 @@ void CodeGenerator::saveVariableFromRegister(std::shared_ptr<Register> reg,
     accumulator_->variable_saved_ = true;
     accumulator_->currently_used_ = false;
   }
+  stats_->addProcedureCounter(current_procedure_name_, "registers_spilled", 1);
   for(auto other_reg : registers_) {
     if(other_reg->curr_variable && reg->curr_variable && other_reg->register_name_ != reg->register_name_ &&
     other_reg->curr_variable->stringify() == reg->curr_variable->stringify()) {
@@ -341,6 +747,224 @@ void CodeGenerator::saveVariableFromRegister(std::shared_ptr<Register> reg,
   reg->variable_saved_ = true;
 }
 
+void CodeGenerator::setAllocatedRegisters(std::shared_ptr<GraphNode> graph) {
+  std::vector<std::string> register_names{"b", "c", "d", "e", "f", "g", "h"};
+  allocated_registers_ = graph->allocated_registers;
+  registers_.clear();
+  for(auto name : register_names) {
+    bool allocated = name == graph->return_address_register;
+    for(auto & allocation : allocated_registers_) {
+      allocated = allocated || allocation.second == name;
+    }
+    if(allocated) {
+      continue;
+    }
+    std::shared_ptr<Register> new_reg = std::make_shared<Register>();
+    new_reg->register_name_ = name;
+    registers_.push_back(new_reg);
+  }
+  accumulator_->curr_variable = nullptr;
+  accumulator_->variable_saved_ = true;
+  accumulator_->currently_used_ = false;
+}
+
+std::set<std::string> CodeGenerator::withoutRegisterArguments(std::set<std::string> variables) {
+  std::set<std::string> result;
+  for(auto & name : variables) {
+    auto sym = current_symbol_table_->findSymbol(name);
+    if(!sym || !sym->value_argument || allocated_registers_.count(name) == 0) {
+      result.insert(name);
+    }
+  }
+  return result;
+}
+
+void CodeGenerator::loadAllocatedVariables(std::shared_ptr<GraphNode> node, std::set<std::string> live_variables) {
+  for(auto & allocation : allocated_registers_) {
+    if(live_variables.count(allocation.first) > 0) {
+      loadAllocatedVariable(node, allocation.first, allocation.second);
+    }
+  }
+}
+
+void CodeGenerator::storeAllocatedVariables(std::shared_ptr<GraphNode> node,
+                                            std::shared_ptr<Register> free_reg,
+                                            std::set<std::string> live_variables) {
+  for(auto & allocation : allocated_registers_) {
+    if(live_variables.count(allocation.first) > 0) {
+      storeAllocatedVariable(node, free_reg, allocation.first, allocation.second);
+    }
+  }
+}
+
+void CodeGenerator::loadAllocatedVariable(std::shared_ptr<GraphNode> node,
+                                          std::string variable_name,
+                                          std::string register_name) {
+  auto sym = current_symbol_table_->findSymbol(variable_name);
+  getValueIntoRegister(sym->mem_start, accumulator_, node);
+  node->code_list_.push_back("LOAD " + accumulator_->register_name_);
+  if(sym->type == symbol_type::PROC_ARGUMENT) {  // load again, because variable address is stored in memory
+    node->code_list_.push_back("LOAD " + accumulator_->register_name_);
+  }
+  node->code_list_.push_back("PUT " + register_name + " # " + variable_name);
+  accumulator_->curr_variable = nullptr;
+  accumulator_->variable_saved_ = true;
+}
+
+void CodeGenerator::storeAllocatedVariable(std::shared_ptr<GraphNode> node,
+                                           std::shared_ptr<Register> free_reg,
+                                           std::string variable_name,
+                                           std::string register_name) {
+  auto sym = current_symbol_table_->findSymbol(variable_name);
+  getValueIntoRegister(sym->mem_start, free_reg, node);
+  if(sym->type == symbol_type::PROC_ARGUMENT) {
+    node->code_list_.push_back("LOAD " + free_reg->register_name_);
+    node->code_list_.push_back("PUT " + free_reg->register_name_);
+  }
+  node->code_list_.push_back("GET " + register_name + " # " + variable_name);
+  node->code_list_.push_back("STORE " + free_reg->register_name_);
+  accumulator_->curr_variable = nullptr;
+  accumulator_->variable_saved_ = true;
+  free_reg->curr_variable = nullptr;
+  free_reg->variable_saved_ = true;
+}
+
+// leaves address of first element of array in accumulator
+void CodeGenerator::generateArrayAddress(std::string array_name, std::shared_ptr<GraphNode> node) {
+  auto kept_address = array_address_registers_.find(array_name);
+  if(kept_address != array_address_registers_.end()) {
+    node->code_list_.push_back("GET " + kept_address->second);
+    return;
+  }
+  auto sym = current_symbol_table_->findSymbol(array_name);
+  getValueIntoRegister(sym->mem_start, accumulator_, node);
+  if(sym->type == symbol_type::PROC_ARRAY_ARGUMENT) {  // array argument holds address of passed array
+    node->code_list_.push_back("LOAD " + accumulator_->register_name_);
+  }
+}
+
+std::string CodeGenerator::inductionAddressRegister(VariableContainer *var) {
+  auto induction = array_induction_variables_.find(var->getVariableName());
+  if(var->type != variable_type::VARIABLE_INDEXED_ARR || induction == array_induction_variables_.end() ||
+      induction->second != var->getIndexVariableName()) {
+    return "";
+  }
+  return array_address_registers_.at(var->getVariableName());
+}
+
+/**
+ * Takes registers of variables kept in registers during loop out of registers pool and loads values of these
+ * variables, as well as addresses of arrays kept in registers. Registers have to be saved before, loading code is placed before loop condition, so it is executed
+ * once, on entering the loop.
+ *
+ * @param node loop condition node
+ */
+void CodeGenerator::allocateLoopRegisters(std::shared_ptr<GraphNode> node) {
+  for(auto & allocation : node->loop_allocated_registers) {
+    allocated_registers_[allocation.first] = allocation.second;
+    for(auto it = registers_.begin(); it != registers_.end(); it++) {
+      if((*it)->register_name_ == allocation.second) {
+        registers_.erase(it);
+        break;
+      }
+    }
+    auto sym = current_symbol_table_->findSymbol(allocation.first);
+    if(sym->type == symbol_type::PROC_ARGUMENT || !node->liveness_computed_ ||
+    node->live_before_condition_.count(allocation.first) > 0) {
+      loadAllocatedVariable(node, allocation.first, allocation.second);
+    }
+  }
+  for(auto & allocation : node->loop_array_registers) {
+    for(auto it = registers_.begin(); it != registers_.end(); it++) {
+      if((*it)->register_name_ == allocation.second) {
+        registers_.erase(it);
+        break;
+      }
+    }
+    auto induction = node->loop_array_induction_variables.find(allocation.first);
+    if(induction == node->loop_array_induction_variables.end()) {
+      generateArrayAddress(allocation.first, node);
+      node->code_list_.push_back("PUT " + allocation.second + " # " + allocation.first);
+    } else {
+      // register holds address of element indexed by induction variable, updated together with the variable
+      Variable* index_var = new Variable;
+      index_var->type = variable_type::VAR;
+      index_var->var_name = induction->second;
+      std::string index_register;
+      if(allocated_registers_.count(induction->second) > 0) {
+        index_register = allocated_registers_.at(induction->second);
+      } else {
+        index_register = loadVariable(index_var, nullptr, node, false)->register_name_;
+      }
+      generateArrayAddress(allocation.first, node);
+      node->code_list_.push_back("ADD " + index_register);
+      node->code_list_.push_back("PUT " + allocation.second + " # " + allocation.first + "[" + induction->second + "]");
+      array_induction_variables_[allocation.first] = induction->second;
+    }
+    array_address_registers_[allocation.first] = allocation.second;
+  }
+  // loop condition is reached also by jump from end of loop body, so values loaded here can not be used in it
+  for(auto reg : registers_) {
+    reg->curr_variable = nullptr;
+    reg->variable_saved_ = true;
+    reg->currently_used_ = false;
+  }
+  accumulator_->curr_variable = nullptr;
+  accumulator_->variable_saved_ = true;
+}
+
+/**
+ * Stores variables kept in registers during loop, that were changed in loop and are used after it, and gives
+ * registers back to registers pool. Storing code is placed at start of node following the loop, where loop
+ * condition jumps on exit.
+ *
+ * @param node loop condition node
+ * @param registers registers pool from before the loop
+ */
+void CodeGenerator::releaseLoopRegisters(std::shared_ptr<GraphNode> node,
+                                         std::vector<std::shared_ptr<Register>> registers) {
+  // registers are saved at the end of loop body, so none of them holds unsaved value
+  registers_ = registers;
+  for(auto reg : registers_) {
+    reg->curr_variable = nullptr;
+    reg->variable_saved_ = true;
+    reg->currently_used_ = false;
+  }
+  auto next_node = node->right_node;
+  next_node->start_line_ = current_start_line_;
+  long long int code_length_before_storing = next_node->code_list_.size();
+  std::set<std::string> written_variables = subgraphWrittenVariables(node->left_node);
+  for(auto & allocation : node->loop_array_registers) {
+    array_address_registers_.erase(allocation.first);
+    array_induction_variables_.erase(allocation.first);
+  }
+  for(auto & allocation : node->loop_allocated_registers) {
+    allocated_registers_.erase(allocation.first);
+    auto sym = current_symbol_table_->findSymbol(allocation.first);
+    if(written_variables.count(allocation.first) > 0 && (sym->type == symbol_type::PROC_ARGUMENT ||
+    !node->liveness_computed_ || node->live_out_.count(allocation.first) > 0)) {
+      storeAllocatedVariable(next_node, registers_.at(0), allocation.first, allocation.second);
+    }
+  }
+  accumulator_->curr_variable = nullptr;
+  accumulator_->variable_saved_ = true;
+  accumulator_->currently_used_ = false;
+  current_start_line_ += next_node->code_list_.size() - code_length_before_storing;
+}
+
+void CodeGenerator::setLiveVariables(std::shared_ptr<GraphNode> node, std::set<std::string> live_variables) {
+  live_variables_known_ = node->liveness_computed_;
+  live_variables_ = live_variables;
+}
+
+bool CodeGenerator::isVariableLive(VariableContainer *var) {
+  if(!live_variables_known_ || var->type != variable_type::VAR) {
+    return true;
+  }
+  auto sym = current_symbol_table_->findSymbol(var->getVariableName());
+  return sym->type != symbol_type::VAR || live_variables_.count(var->getVariableName()) > 0;
+}
+
 /**
  * This method moves variable from accumulator if the variable in accumulator is not saved.
  * In case there is only one register with saved/without value value left, one value from registers will be saved.
@@ -375,11 +999,21 @@ void CodeGenerator::moveAccumulatorToFreeRegister(std::shared_ptr<GraphNode> nod
       second_chosen_reg = reg;
     }
   }
+  if(!chosen_reg) {
+    // every register is used or holds unsaved value, so value of accumulator is saved and loaded again when needed
+    if(!accumulator_->variable_saved_) {
+      saveAccumulator(node);
+    }
+    accumulator_->curr_variable = nullptr;
+    accumulator_->currently_used_ = false;
+    accumulator_->variable_saved_ = true;
+    return;
+  }
   chosen_reg->curr_variable = accumulator_->curr_variable;
   chosen_reg->variable_saved_ = accumulator_->variable_saved_;
   chosen_reg->currently_used_ = false;
   node->code_list_.push_back("PUT " + chosen_reg->register_name_ + " # " + chosen_reg->curr_variable->stringify());
-  if(7 - regs_with_unsaved_vals == 2 && !chosen_reg->variable_saved_) {  // leaving one reg for use
+  if(registers_.size() - regs_with_unsaved_vals == 2 && !chosen_reg->variable_saved_) {  // leaving one reg for use
     // choose reg with unsaved value that is not currently used
     std::shared_ptr<Register> reg_for_save = nullptr;
     for(auto reg : registers_) {
@@ -389,20 +1023,100 @@ void CodeGenerator::moveAccumulatorToFreeRegister(std::shared_ptr<GraphNode> nod
       }
     }
     saveVariableFromRegister(reg_for_save, second_chosen_reg, node, true);
+  } else if(registers_.size() - regs_with_unsaved_vals == 1 && !chosen_reg->variable_saved_) {
+    // no register is left for use and none can help saving, so variable stored by its own register is saved
+    for(auto reg : registers_) {
+      if(reg->variable_saved_ || reg->currently_used_) {
+        continue;
+      }
+      auto sym = current_symbol_table_->findSymbol(reg->curr_variable->getVariableName());
+      if(sym && sym->type != symbol_type::PROC_ARGUMENT && sym->type != symbol_type::PROC_ARRAY_ARGUMENT) {
+        saveVariableFromRegister(reg, nullptr, node, false);
+        break;
+      }
+    }
+  }
+}
+
+/**
+ * Saves unsaved value of accumulator, when no register can take it over. Variable kept in its own register or not
+ * live any more is saved without other registers. Otherwise value is saved through registers with saved values,
+ * even if they are used by current command, and values of these registers are loaded again.
+ *
+ * @param node Current flow graph node in which code might be generated.
+ */
+void CodeGenerator::saveAccumulator(std::shared_ptr<GraphNode> node) {
+  auto var = accumulator_->curr_variable;
+  bool allocated = var->type == variable_type::VAR && allocated_registers_.count(var->getVariableName()) > 0;
+  if(allocated || !isVariableLive(var) ||
+      (var->type != variable_type::VAR && var->type != variable_type::ARR)) {
+    saveVariableFromRegister(accumulator_, nullptr, node, false);
+    return;
   }
+  auto sym = current_symbol_table_->findSymbol(var->getVariableName());
+  bool argument = sym->type == symbol_type::PROC_ARGUMENT || sym->type == symbol_type::PROC_ARRAY_ARGUMENT;
+  // register taking over value of accumulator and register helping to save value of procedure argument
+  int needed_regs = argument ? 2 : 1;
+  std::vector<std::shared_ptr<Register>> borrowed_regs;
+  for(auto reg : registers_) {
+    bool reloadable = !reg->curr_variable || isValueReloadable(reg->curr_variable);
+    if(reg->variable_saved_ && reloadable && borrowed_regs.size() < needed_regs) {
+      borrowed_regs.push_back(reg);
+    }
+  }
+  if(borrowed_regs.size() < needed_regs) {
+    throw std::runtime_error("Error: no register left to save value of " + var->stringify() + ".");
+  }
+  std::vector<std::pair<VariableContainer*, bool>> borrowed_values;
+  for(auto reg : borrowed_regs) {
+    borrowed_values.push_back({reg->curr_variable, reg->currently_used_});
+  }
+  auto holding_reg = borrowed_regs.at(0);
+  auto helping_reg = borrowed_regs.size() > 1 ? borrowed_regs.at(1) : nullptr;
+  node->code_list_.push_back("PUT " + holding_reg->register_name_ + " # " + var->stringify());
+  holding_reg->curr_variable = var;
+  holding_reg->variable_saved_ = false;
+  saveVariableFromRegister(holding_reg, helping_reg, node, false);
+  for(int i = 0; i < borrowed_regs.size(); i++) {
+    auto reg = borrowed_regs.at(i);
+    reg->curr_variable = nullptr;
+    reg->variable_saved_ = true;
+    if(borrowed_values.at(i).first) {
+      loadVariable(borrowed_values.at(i).first, reg, node, true);
+    }
+    reg->currently_used_ = borrowed_values.at(i).second;
+  }
+}
+
+bool CodeGenerator::isValueReloadable(VariableContainer *value) {
+  // only values of constants and variables can be loaded again
+  return value->type == variable_type::R_VAL ||
+      ((value->type == variable_type::VAR || value->type == variable_type::ARR) &&
+      current_symbol_table_->findSymbol(value->getVariableName()));
+}
+
+bool CodeGenerator::needsHelpToSave(std::shared_ptr<Register> reg) {
+  auto var = reg->curr_variable;
+  if(!var || (var->type != variable_type::VAR && var->type != variable_type::ARR) ||
+      (var->type == variable_type::VAR && allocated_registers_.count(var->getVariableName()) > 0)) {
+    return false;
+  }
+  auto sym = current_symbol_table_->findSymbol(var->getVariableName());
+  return sym && (sym->type == symbol_type::PROC_ARGUMENT || sym->type == symbol_type::PROC_ARRAY_ARGUMENT);
 }
 
 /**
  * This method is meant to find a register that can be used later
  * in any computations or to read/write variable.
- * It cannot be used if any of the registers is currently used in computations -
- * all computations have to be finished before using this method.
+ * Registers currently used in computations are never chosen. If every register holds unsaved value, one of them
+ * is saved, which overwrites accumulator - value of accumulator is then loaded again, if it is still needed.
  *
  * @param node Current flow graph node in which code might be generated.
+ * @param keep_accumulator Value of accumulator is still needed after the search.
  * @return Register that can be used later in computations and is not already chosen for them.
  * @TODO(Jakub Drzewiecki): Target using registers that do not have procedures' arguments loaded
  */
-std::shared_ptr<Register> CodeGenerator::findFreeRegister(std::shared_ptr<GraphNode> node) {
+std::shared_ptr<Register> CodeGenerator::findFreeRegister(std::shared_ptr<GraphNode> node, bool keep_accumulator) {
   std::shared_ptr<Register> chosen_reg = nullptr;
   for(auto reg : registers_) {
     if(!reg->curr_variable && !reg->currently_used_) {
@@ -419,29 +1133,60 @@ std::shared_ptr<Register> CodeGenerator::findFreeRegister(std::shared_ptr<GraphN
     }
     // no free registers with saved values - save one of registers and choose it
     if(!chosen_reg) {
+      // variable, which is not procedure argument, is saved without help of other register
       for(auto reg : registers_) {
-        if(!reg->variable_saved_ && !reg->currently_used_) {
+        if(!reg->variable_saved_ && !reg->currently_used_ && (!chosen_reg || !needsHelpToSave(reg))) {
           chosen_reg = reg;
+        }
+        if(chosen_reg && !needsHelpToSave(chosen_reg)) {
           break;
         }
       }
-      // chosen_reg will be saved, reg_for_help is going to be used to help saving this register
-      // currently_used flag can be omitted, because registers cannot have any computations ongoing,
-      // and it will not be returned
+      if(!chosen_reg) {
+        throw std::runtime_error("Error: every register is used by current computation.");
+      }
+      // saving chosen_reg overwrites accumulator, so needed value of accumulator is saved first and loaded again
+      VariableContainer* accumulator_var = keep_accumulator ? accumulator_->curr_variable : nullptr;
+      if(accumulator_var && !isValueReloadable(accumulator_var)) {
+        throw std::runtime_error("Error: no register left to keep value of " + accumulator_var->stringify() + ".");
+      }
+      if(accumulator_var && !accumulator_->variable_saved_) {
+        saveAccumulator(node);
+      }
+      // reg_for_help is going to be used to help saving chosen_reg, its value is loaded again if it was used
       std::shared_ptr<Register> reg_for_help = nullptr;
-      for(auto reg : registers_) {
-        if(reg->variable_saved_) {
-          reg_for_help = reg;
-          break;
+      VariableContainer* helping_var = nullptr;
+      bool helping_reg_used = false;
+      if(needsHelpToSave(chosen_reg)) {
+        for(auto reg : registers_) {
+          if(reg->variable_saved_ && (!reg->curr_variable || isValueReloadable(reg->curr_variable))) {
+            reg_for_help = reg;
+            break;
+          }
+        }
+        if(!reg_for_help) {
+          throw std::runtime_error("Error: no register left to save value of " +
+              chosen_reg->curr_variable->stringify() + ".");
         }
+        helping_var = reg_for_help->curr_variable;
+        helping_reg_used = reg_for_help->currently_used_;
       }
       saveVariableFromRegister(chosen_reg, reg_for_help, node, false);
+      if(helping_var && helping_reg_used) {
+        loadVariable(helping_var, reg_for_help, node, true);
+        reg_for_help->currently_used_ = true;
+      }
+      if(accumulator_var && (!accumulator_->curr_variable ||
+          accumulator_->curr_variable->stringify() != accumulator_var->stringify())) {
+        loadVariable(accumulator_var, accumulator_, node, false);
+      }
     }
   }
   return chosen_reg;
 }
 
 void CodeGenerator::getValueIntoRegister(size_t value, std::shared_ptr<Register> reg, std::shared_ptr<GraphNode> node) {
+  stats_->addProcedureCounter(current_procedure_name_, "constants_materialized", 1);
   node->code_list_.push_back("RST " + reg->register_name_);
   if(value == 0)
     return;
@@ -534,7 +1279,7 @@ std::shared_ptr<Register> CodeGenerator::loadVariable(VariableContainer* var,
       }
     } else {
       if(reg_with_loaded_var->register_name_ == "a") {
-        target_reg = findFreeRegister(node);
+        target_reg = findFreeRegister(node, true);
         target_reg->variable_saved_ = reg_with_loaded_var->variable_saved_;
         target_reg->curr_variable = reg_with_loaded_var->curr_variable;
         node->code_list_.push_back("PUT " + target_reg->register_name_);
@@ -549,6 +1294,12 @@ std::shared_ptr<Register> CodeGenerator::loadVariable(VariableContainer* var,
     }
     if(var->type == variable_type::R_VAL) {
       getValueIntoRegister(var->getValue(), target_reg, node);
+    } else if(var->type == variable_type::VAR && allocated_registers_.count(var->getVariableName()) > 0) {
+      node->code_list_.push_back("GET " + allocated_registers_.at(var->getVariableName()) + " # " + var->stringify());
+      accumulator_->curr_variable = var;
+      accumulator_->variable_saved_ = true;
+      if(target_reg->register_name_ != "a")
+        node->code_list_.push_back("PUT " + target_reg->register_name_);
     } else if(var->type == variable_type::VAR) {
       auto sym = current_symbol_table_->findSymbol(var->getVariableName());
       getValueIntoRegister(sym->mem_start, target_reg, node);
@@ -574,85 +1325,96 @@ std::shared_ptr<Register> CodeGenerator::loadVariable(VariableContainer* var,
         if(target_reg->register_name_ != "a")
           node->code_list_.push_back("PUT " + target_reg->register_name_);
       } else {  // array is a procedure argument
-        std::shared_ptr<Register> free_reg;
+        std::shared_ptr<Register> free_reg = target_reg;
         if(target_reg->register_name_ == "a") {
           free_reg = findFreeRegister(node);
         }
-        getValueIntoRegister(sym->mem_start, target_reg, node);
-        node->code_list_.push_back("LOAD " + target_reg->register_name_);
-        if(target_reg->register_name_ == "a") {
-          getValueIntoRegister(var->getValue(), free_reg, node);
-          node->code_list_.push_back("ADD " + free_reg->register_name_);
-          node->code_list_.push_back("LOAD " + accumulator_->register_name_);
-          accumulator_->curr_variable = var;
-          accumulator_->variable_saved_ = true;
-        } else {
-          getValueIntoRegister(var->getValue(), target_reg, node);
-          node->code_list_.push_back("ADD " + target_reg->register_name_);
-          node->code_list_.push_back("LOAD " + accumulator_->register_name_);
-          accumulator_->curr_variable = var;
-          accumulator_->variable_saved_ = true;
-        }
-        if(target_reg->register_name_ != "a")
-          node->code_list_.push_back("PUT " + target_reg->register_name_);
-      }
-    } else if(var->type == variable_type::VARIABLE_INDEXED_ARR) {
-      auto sym = current_symbol_table_->findSymbol(var->getVariableName());
-      // firstly load index variable
-      Variable* index_var = new Variable;
-      index_var->type = variable_type::VAR;
-      index_var->var_name = var->getIndexVariableName();
-      std::shared_ptr<Register> index_reg;
-      index_reg = checkVariableAlreadyLoaded(index_var);
-      if(!index_reg) {
-        index_reg = findFreeRegister(node);
-        auto index_var_sym = current_symbol_table_->findSymbol(index_var->getVariableName());
-        getValueIntoRegister(index_var_sym->mem_start, index_reg, node);
-        node->code_list_.push_back("LOAD " + index_reg->register_name_);
-        if(index_var_sym->type == symbol_type::PROC_ARGUMENT) {
-          node->code_list_.push_back("LOAD " + accumulator_->register_name_);
-        }
-        node->code_list_.push_back("PUT " + index_reg->register_name_);
-      } else if(index_reg->register_name_ == "a") {
-        std::shared_ptr<Register> tmp_reg = findFreeRegister(node);
-        node->code_list_.push_back("PUT " + tmp_reg->register_name_);
-        tmp_reg->curr_variable = index_reg->curr_variable;
-        tmp_reg->variable_saved_ = index_reg->variable_saved_;
-        tmp_reg->currently_used_ = true;
-        index_reg->curr_variable = nullptr;
-        index_reg->variable_saved_ = true;
-        index_reg->currently_used_ = false;
-        index_reg = tmp_reg;
-      }
-      // then load target array variable
-      if(sym->type == symbol_type::ARR) {  // normal array
-        getValueIntoRegister(sym->mem_start, accumulator_, node);
-        node->code_list_.push_back("ADD " + index_reg->register_name_);
+        generateArrayAddress(var->getVariableName(), node);
+        getValueIntoRegister(var->getValue(), free_reg, node);
+        node->code_list_.push_back("ADD " + free_reg->register_name_);
         node->code_list_.push_back("LOAD " + accumulator_->register_name_);
         accumulator_->curr_variable = var;
         accumulator_->variable_saved_ = true;
         if(target_reg->register_name_ != "a")
           node->code_list_.push_back("PUT " + target_reg->register_name_);
-        target_reg->currently_used_ = false;
-      } else {  // procedure argument array
-        getValueIntoRegister(sym->mem_start, accumulator_, node);
-        node->code_list_.push_back("LOAD " + accumulator_->register_name_);
+      }
+    } else if(var->type == variable_type::VARIABLE_INDEXED_ARR) {
+      // loaded element can be one of elements with constant index
+      saveArrayElements(var->getVariableName(), node);
+      std::string element_address_register = inductionAddressRegister(var);
+      if(!element_address_register.empty()) {
+        node->code_list_.push_back("GET " + element_address_register + " # " + var->stringify());
+      } else {
+        // firstly load index variable
+        Variable* index_var = new Variable;
+        index_var->type = variable_type::VAR;
+        index_var->var_name = var->getIndexVariableName();
+        std::shared_ptr<Register> index_reg;
+        index_reg = checkVariableAlreadyLoaded(index_var);
+        if(!index_reg && allocated_registers_.count(index_var->getVariableName()) > 0) {
+          // index is only added to array address, so register of allocated variable is used directly
+          index_reg = std::make_shared<Register>();
+          index_reg->register_name_ = allocated_registers_.at(index_var->getVariableName());
+        } else if(!index_reg) {
+          index_reg = findFreeRegister(node);
+          auto index_var_sym = current_symbol_table_->findSymbol(index_var->getVariableName());
+          getValueIntoRegister(index_var_sym->mem_start, index_reg, node);
+          node->code_list_.push_back("LOAD " + index_reg->register_name_);
+          if(index_var_sym->type == symbol_type::PROC_ARGUMENT) {
+            node->code_list_.push_back("LOAD " + accumulator_->register_name_);
+          }
+          node->code_list_.push_back("PUT " + index_reg->register_name_);
+        } else if(index_reg->register_name_ == "a") {
+          std::shared_ptr<Register> tmp_reg = findFreeRegister(node, true);
+          node->code_list_.push_back("PUT " + tmp_reg->register_name_);
+          tmp_reg->curr_variable = index_reg->curr_variable;
+          tmp_reg->variable_saved_ = index_reg->variable_saved_;
+          tmp_reg->currently_used_ = true;
+          index_reg->curr_variable = nullptr;
+          index_reg->variable_saved_ = true;
+          index_reg->currently_used_ = false;
+          index_reg = tmp_reg;
+        }
+        // then load target array variable
+        generateArrayAddress(var->getVariableName(), node);
         node->code_list_.push_back("ADD " + index_reg->register_name_);
-        node->code_list_.push_back("LOAD " + accumulator_->register_name_);
-        accumulator_->curr_variable = var;
-        accumulator_->variable_saved_ = true;
-        if(target_reg->register_name_ != "a")
-          node->code_list_.push_back("PUT " + target_reg->register_name_);
-        target_reg->currently_used_ = false;
       }
+      node->code_list_.push_back("LOAD " + accumulator_->register_name_);
+      accumulator_->curr_variable = var;
+      accumulator_->variable_saved_ = true;
+      if(target_reg->register_name_ != "a")
+        node->code_list_.push_back("PUT " + target_reg->register_name_);
+      target_reg->currently_used_ = false;
     }
     target_reg->curr_variable = var;
     target_reg->currently_used_ = false;
     target_reg->variable_saved_ = true;
   }
-  if(target_reg->curr_variable && !target_reg->variable_saved_ && use_saved_variables) {
+  if(target_reg->curr_variable && !target_reg->variable_saved_ && use_saved_variables &&
+      target_reg->register_name_ == "a" && reg_with_loaded_var && reg_with_loaded_var->register_name_ != "a") {
+    // register, which value was copied from, is saved instead of accumulator; spilling other register while
+    // searching for free one overwrites accumulator, so value is copied again if it was not done by saving
+    bool source_used = reg_with_loaded_var->currently_used_;
+    reg_with_loaded_var->currently_used_ = true;
     target_reg->currently_used_ = true;
+    auto loaded_var = accumulator_->curr_variable;
+    long long int code_length_before_search = node->code_list_.size();
     std::shared_ptr<Register> free_one = findFreeRegister(node);
+    bool accumulator_overwritten = node->code_list_.size() != code_length_before_search;
+    free_one->currently_used_ = true;
+    long long int code_length_before_saving = node->code_list_.size();
+    saveVariableFromRegister(reg_with_loaded_var, free_one, node, true);
+    if(accumulator_overwritten && node->code_list_.size() == code_length_before_saving) {
+      node->code_list_.push_back("GET " + reg_with_loaded_var->register_name_);
+    }
+    accumulator_->curr_variable = loaded_var;
+    accumulator_->variable_saved_ = true;
+    reg_with_loaded_var->currently_used_ = source_used;
+    target_reg->currently_used_ = false;
+    free_one->currently_used_ = false;
+  } else if(target_reg->curr_variable && !target_reg->variable_saved_ && use_saved_variables) {
+    target_reg->currently_used_ = true;
+    std::shared_ptr<Register> free_one = findFreeRegister(node, target_reg->register_name_ == "a");
     free_one->currently_used_ = true;
     if(target_reg->register_name_ == "a") {
       node->code_list_.push_back("PUT " + free_one->register_name_);
@@ -688,25 +1450,185 @@ void CodeGenerator::loadRegistersState(std::vector<std::shared_ptr<Register>> sa
   }
 }
 
-void CodeGenerator::saveRegistersValues(std::shared_ptr<GraphNode> node) {
+void CodeGenerator::saveRegistersValues(std::shared_ptr<GraphNode> node, bool keep_saved_values) {
   moveAccumulatorToFreeRegister(node);
   accumulator_->curr_variable = nullptr;
   accumulator_->variable_saved_ = true;
   std::shared_ptr<Register> free_reg = findFreeRegister(node);
   free_reg->currently_used_ = true;
   for(auto reg : registers_) {
-    if(reg->register_name_ != free_reg->register_name_) {
-      saveVariableFromRegister(reg, free_reg, node, false);
-      reg->curr_variable = nullptr;
-      reg->variable_saved_ = true;
+    if(reg->register_name_ == free_reg->register_name_) {
+      continue;
+    }
+    // saving code overwrites only registers with unsaved values, other registers keep their values
+    if(keep_saved_values && reg->variable_saved_ && reg->curr_variable &&
+    reg->curr_variable->type != variable_type::VARIABLE_INDEXED_ARR) {
+      continue;
     }
+    saveVariableFromRegister(reg, free_reg, node, false);
+    reg->curr_variable = nullptr;
+    reg->variable_saved_ = true;
   }
   free_reg->currently_used_ = false;
+  free_reg->curr_variable = nullptr;
+  free_reg->variable_saved_ = true;
   accumulator_->curr_variable = nullptr;
   accumulator_->variable_saved_ = true;
   accumulator_->currently_used_ = false;
 }
 
+void CodeGenerator::saveArrayElements(std::string array_name, std::shared_ptr<GraphNode> node) {
+  auto is_unsaved_element = [&array_name](std::shared_ptr<Register> reg) {
+    return reg->curr_variable && !reg->variable_saved_ && reg->curr_variable->type == variable_type::ARR &&
+        reg->curr_variable->getVariableName() == array_name;
+  };
+  bool unsaved_elements = is_unsaved_element(accumulator_);
+  for(auto reg : registers_) {
+    unsaved_elements = unsaved_elements || is_unsaved_element(reg);
+  }
+  if(!unsaved_elements) {
+    return;
+  }
+  moveAccumulatorToFreeRegister(node);
+  accumulator_->curr_variable = nullptr;
+  accumulator_->variable_saved_ = true;
+  std::shared_ptr<Register> free_reg = findFreeRegister(node);
+  bool free_reg_used = free_reg->currently_used_;
+  free_reg->currently_used_ = true;
+  for(auto reg : registers_) {
+    if(is_unsaved_element(reg)) {
+      saveVariableFromRegister(reg, free_reg, node, true);
+    }
+  }
+  free_reg->currently_used_ = free_reg_used;
+  accumulator_->curr_variable = nullptr;
+  accumulator_->variable_saved_ = true;
+}
+
+void CodeGenerator::forgetArrayElements(std::string array_name,
+                                        std::shared_ptr<Register> kept_reg,
+                                        bool constant_indexes) {
+  std::vector<std::shared_ptr<Register>> all_registers(registers_);
+  all_registers.push_back(accumulator_);
+  for(auto reg : all_registers) {
+    if(reg == kept_reg || !reg->curr_variable || reg->curr_variable->getVariableName() != array_name) {
+      continue;
+    }
+    if(reg->curr_variable->type == variable_type::VARIABLE_INDEXED_ARR ||
+    (constant_indexes && reg->curr_variable->type == variable_type::ARR)) {
+      reg->curr_variable = nullptr;
+      reg->variable_saved_ = true;
+    }
+  }
+}
+
+void CodeGenerator::forgetArgumentAliases(VariableContainer *written_var, std::shared_ptr<Register> kept_reg) {
+  auto written_sym = current_symbol_table_->findSymbol(written_var->getVariableName());
+  if(!written_sym ||
+      (written_sym->type != symbol_type::PROC_ARGUMENT && written_sym->type != symbol_type::PROC_ARRAY_ARGUMENT)) {
+    return;
+  }
+  auto is_alias = [this, written_var, written_sym](std::string name) {
+    auto sym = current_symbol_table_->findSymbol(name);
+    return sym && sym->type == written_sym->type && name != written_var->getVariableName();
+  };
+  std::vector<std::shared_ptr<Register>> all_registers(registers_);
+  all_registers.push_back(accumulator_);
+  for(auto reg : all_registers) {
+    auto var = reg->curr_variable;
+    if(reg == kept_reg || !var || var->type == variable_type::R_VAL || !reg->variable_saved_) {
+      continue;
+    }
+    // element indexed by other argument changes with it as well
+    if(is_alias(var->getVariableName()) ||
+        (var->type == variable_type::VARIABLE_INDEXED_ARR && is_alias(var->getIndexVariableName()))) {
+      reg->curr_variable = nullptr;
+      reg->variable_saved_ = true;
+    }
+  }
+}
+
+/**
+ * Merges current registers state with state of other edge joining at the same point of code. Values that are
+ * in the same register in both states are kept, values kept in other register in current state are moved to
+ * register of target state, if they can be used later. Both states have to be saved with
+ * saveRegistersValues before, so none of the registers holds unsaved value.
+ *
+ * @param node node, which code is executed only on current edge
+ * @param target_state registers state of other edge
+ */
+void CodeGenerator::mergeRegistersState(std::shared_ptr<GraphNode> node,
+                                        std::vector<std::shared_ptr<Register>> target_state) {
+  std::vector<std::shared_ptr<Register>> current_state = saveRegistersState();
+  std::vector<std::shared_ptr<Register>> merged_state;
+  auto same_value = [](std::shared_ptr<Register> first, std::shared_ptr<Register> second) {
+    return first->curr_variable && second->curr_variable && first->variable_saved_ && second->variable_saved_ &&
+        first->curr_variable->type != variable_type::VARIABLE_INDEXED_ARR &&
+        first->curr_variable->stringify() == second->curr_variable->stringify();
+  };
+  // pairs of target and source register indexes
+  std::vector<std::pair<int, int>> moves;
+  for(int i = 0; i < target_state.size(); i++) {
+    auto reg = std::make_shared<Register>(*target_state.at(i));
+    reg->currently_used_ = false;
+    merged_state.push_back(reg);
+    if(target_state.size() != current_state.size() || !reg->curr_variable || !reg->variable_saved_) {
+      reg->curr_variable = nullptr;
+      reg->variable_saved_ = true;
+      continue;
+    }
+    if(same_value(reg, current_state.at(i))) {
+      continue;
+    }
+    int source = -1;
+    // accumulator is used for moves, constants are cheaper to generate again
+    if(i > 0 && reg->curr_variable->type != variable_type::R_VAL && isVariableLive(reg->curr_variable)) {
+      for(int j = 1; j < current_state.size(); j++) {
+        if(same_value(reg, current_state.at(j))) {
+          source = j;
+          break;
+        }
+      }
+    }
+    if(source == -1) {
+      reg->curr_variable = nullptr;
+      reg->variable_saved_ = true;
+    } else {
+      moves.push_back({i, source});
+    }
+  }
+  // register can be overwritten only after values of other moves are taken from it
+  bool accumulator_used = false;
+  while(!moves.empty()) {
+    int chosen_move = -1;
+    for(int i = 0; i < moves.size() && chosen_move == -1; i++) {
+      bool is_source = false;
+      for(int j = 0; j < moves.size(); j++) {
+        is_source = is_source || (i != j && moves.at(j).second == moves.at(i).first);
+      }
+      if(!is_source) {
+        chosen_move = i;
+      }
+    }
+    if(chosen_move == -1) {
+      // cycle of moves, value of one register is forgotten
+      merged_state.at(moves.back().first)->curr_variable = nullptr;
+      moves.pop_back();
+      continue;
+    }
+    auto target_reg = merged_state.at(moves.at(chosen_move).first);
+    node->code_list_.push_back("GET " + current_state.at(moves.at(chosen_move).second)->register_name_);
+    node->code_list_.push_back("PUT " + target_reg->register_name_ + " # " + target_reg->curr_variable->stringify());
+    accumulator_used = true;
+    moves.erase(moves.begin() + chosen_move);
+  }
+  if(accumulator_used) {
+    merged_state.at(0)->curr_variable = nullptr;
+    merged_state.at(0)->variable_saved_ = true;
+  }
+  loadRegistersState(merged_state);
+}
+
 /**
  * Pipeline:
  * - manage variable in accumulator
@@ -724,8 +1646,16 @@ void CodeGenerator::saveRegistersValues(std::shared_ptr<GraphNode> node) {
  */
 void CodeGenerator::handleAssignmentCommand(AssignmentCommand *command, std::shared_ptr<GraphNode> node) {
   long long int code_length_before_preparation = node->code_list_.size();
-  std::vector<std::pair<VariableContainer*, bool>> needed_variables = command->expression_->neededVariablesInRegisters();
-  VariableContainer * variable_needed_in_accumulator = command->expression_->variableNeededInAccumulator();
+  DefaultExpression *expression = command->expression_;
+  // result of division calculated by previous command is taken from register, if it was not overwritten
+  DefaultExpression kept_result_expression;
+  if(expression->kept_result_ && !expression->keeps_result_ && checkVariableAlreadyLoaded(expression->kept_result_)) {
+    kept_result_expression.var_ = expression->kept_result_;
+    expression = &kept_result_expression;
+    stats_->addProcedureCounter(current_procedure_name_, "division_results_reused", 1);
+  }
+  std::vector<std::pair<VariableContainer*, bool>> needed_variables = expression->neededVariablesInRegisters();
+  VariableContainer * variable_needed_in_accumulator = expression->variableNeededInAccumulator();
 
   std::vector<VariableContainer *> unloaded_variables;
   std::vector<std::shared_ptr<Register>> registers_to_be_saved;
@@ -734,13 +1664,17 @@ void CodeGenerator::handleAssignmentCommand(AssignmentCommand *command, std::sha
     auto reg_with_var = checkVariableAlreadyLoaded(var.first);
     if(reg_with_var) {
       reg_with_var->currently_used_ = true;
+      // saving value of variable overwrites accumulator
+      if(var.second && !reg_with_var->variable_saved_ && reg_with_var->register_name_ != "a") {
+        registers_to_be_saved.push_back(reg_with_var);
+      }
     } else {
       unloaded_variables.push_back(var.first);
     }
   }
 
   // always make sure that if there is variable in accumulator, it is kept anywhere
-  if(command->expression_->accumulatorNeededForExpression()) {
+  if(expression->accumulatorNeededForExpression()) {
     moveAccumulatorToFreeRegister(node);
   } else if(unloaded_variables.empty()) {
     if(!registers_to_be_saved.empty()) {
@@ -769,7 +1703,7 @@ void CodeGenerator::handleAssignmentCommand(AssignmentCommand *command, std::sha
   }
   // store accumulator variable last in vector
   std::vector<std::shared_ptr<Register>> prepared_free_regs;
-  for(int i = 0; i < command->expression_->neededEmptyRegs(); i++) {
+  for(int i = 0; i < expression->neededEmptyRegs(); i++) {
     std::shared_ptr<Register> free_reg = findFreeRegister(node);
     free_reg->currently_used_ = true;
     prepared_free_regs.push_back(free_reg);
@@ -783,15 +1717,29 @@ void CodeGenerator::handleAssignmentCommand(AssignmentCommand *command, std::sha
 
     prepared_registers.push_back(accumulator_);
   }
+  // result in accumulator is stored through other register, which is reserved now, because searching for it after
+  // calculation could save other register through accumulator
+  auto left_sym = current_symbol_table_->findSymbol(command->left_var_->getVariableName());
+  bool register_left = false;
+  for(auto reg : registers_) {
+    register_left = register_left || !reg->currently_used_;
+  }
+  bool accumulator_reloadable = !variable_needed_in_accumulator ||
+      (accumulator_->curr_variable && isValueReloadable(accumulator_->curr_variable));
+  if(register_left && accumulator_reloadable && (command->left_var_->type == variable_type::VARIABLE_INDEXED_ARR ||
+      (left_sym && (left_sym->type == symbol_type::PROC_ARGUMENT ||
+      left_sym->type == symbol_type::PROC_ARRAY_ARGUMENT)))) {
+    findFreeRegister(node, variable_needed_in_accumulator != nullptr)->currently_used_ = true;
+  }
   for(auto reg : prepared_free_regs) {
     prepared_registers.push_back(reg);
   }
   long long int code_length_after_preparation = node->code_list_.size();
   std::vector<std::string> generated_commands =
-      command->expression_->calculateExpression(prepared_registers,
+      expression->calculateExpression(prepared_registers,
                                                current_start_line_ +
                                                (code_length_after_preparation - code_length_before_preparation));
-  auto reg_with_result = command->expression_->updateRegistersState(prepared_registers);
+  auto reg_with_result = expression->updateRegistersState(prepared_registers);
   if(!reg_with_result)
     reg_with_result = accumulator_;
 
@@ -834,8 +1782,45 @@ void CodeGenerator::handleAssignmentCommand(AssignmentCommand *command, std::sha
     node->code_list_.push_back(generated_code);
   }
   reg_with_result->currently_used_ = true;
+  if(expression->keeps_result_) {
+    // kept result should not be overwritten by saving result of this command, if other registers are available
+    auto kept_result_reg = checkVariableAlreadyLoaded(expression->kept_result_);
+    int available_registers = 0;
+    for(auto reg : registers_) {
+      if(reg != kept_result_reg && reg->variable_saved_ && !reg->currently_used_) {
+        available_registers++;
+      }
+    }
+    if(kept_result_reg && available_registers >= 2) {
+      kept_result_reg->currently_used_ = true;
+    }
+  }
   // save variable from accumulator if needed
   saveRegisterAfterAssignmentIfNeeded(command, reg_with_result, node);
+  // computations of command are finished, so register with result can be chosen by following commands
+  reg_with_result->currently_used_ = false;
+  if(command->left_var_->type == variable_type::VAR) {
+    // registers with addresses of elements indexed by changed variable follow its value
+    for(auto & induction : array_induction_variables_) {
+      if(induction.second != command->left_var_->getVariableName()) {
+        continue;
+      }
+      for(size_t i = 0; i < inductionStep(command); i++) {
+        node->code_list_.push_back("INC " + array_address_registers_.at(induction.first));
+      }
+    }
+  }
+  if(command->expression_->kept_result_ && !command->expression_->keeps_result_) {
+    // kept result is not a variable, it can not stay in registers after being used
+    std::vector<std::shared_ptr<Register>> all_registers(registers_);
+    all_registers.push_back(accumulator_);
+    for(auto reg : all_registers) {
+      if(reg->curr_variable == command->expression_->kept_result_) {
+        reg->curr_variable = nullptr;
+        reg->variable_saved_ = true;
+      }
+    }
+  }
   // update variables in rest of registers
   // save variable indexed arrays since such value cannot be kept in registers, no chance of saving them later
 }
@@ -868,30 +1853,66 @@ void CodeGenerator::handleWriteCommand(WriteCommand *command, std::shared_ptr<Gr
       node->code_list_.push_back("GET " + reg->register_name_ + " # " + reg->curr_variable->stringify());
       accumulator_->curr_variable = reg->curr_variable;
     }
+    reg->currently_used_ = false;
   }
   node->code_list_.push_back("WRITE");
 }
 
-// TODO(Jakub Drzewiecki): For procedures with <= 3 arguments,
-//  variables can be passed in registers instead of memory addresses.
-//  Consider also passing memory addresses of arguments in registers instead of saving it,
-//  this can allow for up to 6 arguments being passed in registers.
+// TODO(Jakub Drzewiecki): Consider passing memory addresses of arguments in registers instead of saving it
 void CodeGenerator::handleProcedureCallCommand(ProcedureCallCommand *command,
                                                std::shared_ptr<GraphNode> node) {
-  // save all currently unsaved variables
+  auto & summary = procedures_summaries_.at(command->proc_call_.name);
+  // variables, that procedure can read or change through its arguments; values passed by value are read
+  // by copying them, also from registers
+  std::set<std::string> read_variables;
+  std::set<std::string> written_variables;
+  for(auto & arg : command->proc_call_.args) {
+    if(summary.read_arguments.count(arg.target_variable_symbol->symbol_name) > 0 &&
+        summary.value_arguments.count(arg.target_variable_symbol->symbol_name) == 0) {
+      read_variables.insert(arg.name);
+    }
+    if(summary.written_arguments.count(arg.target_variable_symbol->symbol_name) > 0) {
+      written_variables.insert(arg.name);
+    }
+  }
+  addArgumentAliases(read_variables);
+  addArgumentAliases(written_variables);
+  auto isAccessed = [](VariableContainer* var, std::set<std::string> &variables) {
+    if(!var || var->type == variable_type::R_VAL) {
+      return false;
+    }
+    return variables.count(var->getVariableName()) > 0 ||
+        (var->type == variable_type::VARIABLE_INDEXED_ARR && variables.count(var->getIndexVariableName()) > 0);
+  };
+  // save variables read by procedure and forget values changed by it, registers not used by procedure keep values
   moveAccumulatorToFreeRegister(node);
   std::shared_ptr<Register> free_reg = findFreeRegister(node);
+  long long int kept_registers = 0;
   for(auto reg : registers_) {
-    if(reg->register_name_ != free_reg->register_name_) {
+    if(reg->register_name_ == free_reg->register_name_) {
+      continue;
+    }
+    if(summary.clobbered_registers.count(reg->register_name_) > 0 || isAccessed(reg->curr_variable, written_variables)) {
       saveVariableFromRegister(reg, free_reg, node, false);
+    } else if(isAccessed(reg->curr_variable, read_variables) && !reg->variable_saved_) {
+      saveVariableFromRegister(reg, free_reg, node, true);
+    } else if(reg->curr_variable) {
+      kept_registers++;
     }
   }
   accumulator_->curr_variable = nullptr;
   accumulator_->variable_saved_ = true;
+  // free register can still hold saved value, which is overwritten by addresses of arguments
+  free_reg->curr_variable = nullptr;
+  free_reg->variable_saved_ = true;
   // pass variables memory addresses to procedures memory reserved for declared arguments
   for(auto arg : command->proc_call_.args) {
     auto sym = current_symbol_table_->findSymbol(arg.name);
     auto target_sym = arg.target_variable_symbol;
+    // array bound to clone of procedure is accessed directly, so its address is not passed
+    if(summary.value_arguments.count(target_sym->symbol_name) > 0 || target_sym->bound_array_argument) {
+      continue;
+    }
     getValueIntoRegister(sym->mem_start, free_reg, node);
     node->code_list_.push_back("GET " + free_reg->register_name_);
     if(sym->type == symbol_type::PROC_ARGUMENT || sym->type == symbol_type::PROC_ARRAY_ARGUMENT) {
@@ -901,7 +1922,36 @@ void CodeGenerator::handleProcedureCallCommand(ProcedureCallCommand *command,
     node->code_list_.push_back("STORE " + free_reg->register_name_);
   }
 
-  // pass current line number in register h
+  // allocated variables are stored, if procedure accesses them or uses their registers
+  std::set<std::string> live_variables = live_variables_;
+  if(!live_variables_known_) {
+    for(auto & allocation : allocated_registers_) {
+      live_variables.insert(allocation.first);
+    }
+  }
+  std::set<std::string> stored_variables;
+  std::set<std::string> loaded_variables;
+  for(auto & allocation : allocated_registers_) {
+    if(live_variables.count(allocation.first) == 0) {
+      continue;
+    }
+    bool changed = summary.clobbered_registers.count(allocation.second) > 0 ||
+        written_variables.count(allocation.first) > 0;
+    if(changed || read_variables.count(allocation.first) > 0) {
+      stored_variables.insert(allocation.first);
+    }
+    if(changed) {
+      loaded_variables.insert(allocation.first);
+    } else {
+      kept_registers++;
+    }
+  }
+  if(kept_registers > 0) {
+    stats_->addProcedureCounter(current_procedure_name_, "registers_kept_across_calls", kept_registers);
+  }
+  storeAllocatedVariables(node, free_reg, stored_variables);
+  copyValueArgumentsIn(command, free_reg, node);
+  // pass current line number in accumulator
   node->code_list_.push_back("STRK a");
   // add procedure call
   int i = 0;
@@ -912,6 +1962,117 @@ void CodeGenerator::handleProcedureCallCommand(ProcedureCallCommand *command,
   }
   auto proc_node_start = procedures_start_nodes_.at(i);
   node->code_list_.push_back("JUMP " + std::to_string(proc_node_start->start_line_));
+  copyValueArgumentsOut(command, node);
+  loadAllocatedVariables(node, loaded_variables);
+}
+
+/**
+ * Copies values of variables passed by value, which procedure accesses, into registers and memory of its
+ * arguments. Argument written by procedure has to be copied in too, because procedure does not have to write it.
+ * Free register can be register of argument, so arguments passed in memory are copied first.
+ */
+void CodeGenerator::copyValueArgumentsIn(ProcedureCallCommand *command,
+                                         std::shared_ptr<Register> free_reg,
+                                         std::shared_ptr<GraphNode> node) {
+  auto & summary = procedures_summaries_.at(command->proc_call_.name);
+  for(bool in_registers : {false, true}) {
+    for(auto & arg : command->proc_call_.args) {
+      std::string argument_name = arg.target_variable_symbol->symbol_name;
+      auto value_argument = summary.value_arguments.find(argument_name);
+      if(value_argument == summary.value_arguments.end() || value_argument->second.empty() == in_registers ||
+          (summary.read_arguments.count(argument_name) == 0 && summary.written_arguments.count(argument_name) == 0)) {
+        continue;
+      }
+      Variable* passed_var = new Variable;
+      passed_var->type = variable_type::VAR;
+      passed_var->var_name = arg.name;
+      loadVariable(passed_var, accumulator_, node, false);
+      if(in_registers) {
+        node->code_list_.push_back("PUT " + value_argument->second + " # " + argument_name);
+      } else {
+        getValueIntoRegister(arg.target_variable_symbol->mem_start, free_reg, node);
+        node->code_list_.push_back("STORE " + free_reg->register_name_);
+      }
+      stats_->addProcedureCounter(current_procedure_name_, "arguments_passed_by_value", 1);
+    }
+  }
+  accumulator_->curr_variable = nullptr;
+  accumulator_->variable_saved_ = true;
+  free_reg->curr_variable = nullptr;
+  free_reg->variable_saved_ = true;
+}
+
+/**
+ * Copies values of arguments passed by value, which procedure can change, back to passed variables. Registers
+ * of arguments, which are free registers of caller, just hold new values, so they are taken first - searching
+ * for free register can not overwrite them. Other values are moved to free registers. Arguments of caller passed
+ * by reference are stored at once, because other arguments can reference the same variable.
+ */
+void CodeGenerator::copyValueArgumentsOut(ProcedureCallCommand *command, std::shared_ptr<GraphNode> node) {
+  auto & summary = procedures_summaries_.at(command->proc_call_.name);
+  std::vector<std::shared_ptr<Register>> copied_registers;
+  for(bool in_free_registers : {true, false}) {
+    for(auto & arg : command->proc_call_.args) {
+      std::string argument_name = arg.target_variable_symbol->symbol_name;
+      auto value_argument = summary.value_arguments.find(argument_name);
+      if(value_argument == summary.value_arguments.end() || summary.written_arguments.count(argument_name) == 0) {
+        continue;
+      }
+      std::shared_ptr<Register> target_reg = nullptr;
+      for(auto reg : registers_) {
+        if(reg->register_name_ == value_argument->second) {
+          target_reg = reg;
+        }
+      }
+      if((target_reg != nullptr) != in_free_registers) {
+        continue;
+      }
+      Variable* passed_var = new Variable;
+      passed_var->type = variable_type::VAR;
+      passed_var->var_name = arg.name;
+      if(!target_reg) {
+        target_reg = findFreeRegister(node);
+        if(value_argument->second.empty()) {
+          getValueIntoRegister(arg.target_variable_symbol->mem_start, accumulator_, node);
+          node->code_list_.push_back("LOAD " + accumulator_->register_name_);
+        } else {
+          node->code_list_.push_back("GET " + value_argument->second + " # " + argument_name);
+        }
+        node->code_list_.push_back("PUT " + target_reg->register_name_ + " # " + arg.name);
+        accumulator_->curr_variable = nullptr;
+        accumulator_->variable_saved_ = true;
+      }
+      target_reg->curr_variable = passed_var;
+      target_reg->variable_saved_ = false;
+      target_reg->currently_used_ = false;
+      copied_registers.push_back(target_reg);
+    }
+  }
+  for(auto reg : copied_registers) {
+    if(reg->curr_variable && !reg->variable_saved_ &&
+        current_symbol_table_->findSymbol(reg->curr_variable->getVariableName())->type == symbol_type::PROC_ARGUMENT) {
+      reg->currently_used_ = true;
+      auto free_reg = findFreeRegister(node);
+      free_reg->currently_used_ = true;
+      saveVariableFromRegister(reg, free_reg, node, true);
+      free_reg->currently_used_ = false;
+      reg->currently_used_ = false;
+    }
+  }
+}
+
+void CodeGenerator::addArgumentAliases(std::set<std::string> &variables) {
+  std::vector<std::string> arguments;
+  bool argument_included = false;
+  for(auto sym : current_symbol_table_->getSymbols()) {
+    if(sym->type == symbol_type::PROC_ARGUMENT || sym->type == symbol_type::PROC_ARRAY_ARGUMENT) {
+      arguments.push_back(sym->symbol_name);
+      argument_included = argument_included || variables.count(sym->symbol_name) > 0;
+    }
+  }
+  if(argument_included) {
+    variables.insert(arguments.begin(), arguments.end());
+  }
 }
 
 void CodeGenerator::prepareCondition(std::shared_ptr<GraphNode> node) {
@@ -933,11 +2094,13 @@ void CodeGenerator::prepareCondition(std::shared_ptr<GraphNode> node) {
   bool use_saved_variables = true;
   for(int i = 0; i < needed_variables.size() - 1; i++) {
     prepared_registers.push_back(loadVariable(needed_variables.at(i), nullptr, node, use_saved_variables));
+    // loaded value can not be overwritten while searching for other registers
+    prepared_registers.back()->currently_used_ = true;
   }
   // store accumulator variable last in vector
   loadVariable(needed_variables.at(needed_variables.size() - 1), accumulator_, node, use_saved_variables);
   prepared_registers.push_back(accumulator_);
-  std::shared_ptr<Register> free_reg = findFreeRegister(node);
+  std::shared_ptr<Register> free_reg = findFreeRegister(node, true);
   prepared_registers.push_back(free_reg);
   // save registers prepared for condition
   for(auto prep_reg : prepared_registers) {
@@ -977,38 +2140,67 @@ void CodeGenerator::saveRegisterAfterAssignmentIfNeeded(AssignmentCommand *comma
   if(reg_with_result->register_name_ != "a") {
     moveAccumulatorToFreeRegister(node);
   }
+  if(command->left_var_->type == variable_type::ARR) {
+    forgetArrayElements(command->left_var_->getVariableName(), reg_with_result, false);
+  }
   if(command->left_var_->type == variable_type::VARIABLE_INDEXED_ARR) {
     std::shared_ptr<Register> acc_hold_reg;
     if(reg_with_result->register_name_ == "a") {
       acc_hold_reg = findFreeRegister(node);
       acc_hold_reg->currently_used_ = true;
+      acc_hold_reg->curr_variable = nullptr;
       acc_hold_reg->variable_saved_ = false;
       node->code_list_.push_back("PUT " + acc_hold_reg->register_name_);
     }
-    auto arr_sym = current_symbol_table_->findSymbol(command->left_var_->getVariableName());
-    auto var_ind_sym = current_symbol_table_->findSymbol(command->left_var_->getIndexVariableName());
-    Variable *ind_var = new Variable ;
-    ind_var->type = variable_type::VAR;
-    ind_var->var_name = command->left_var_->getIndexVariableName();
-    std::shared_ptr<Register> ind_reg = checkVariableAlreadyLoaded(ind_var);
-    if(!ind_reg) {
-      ind_reg = loadVariable(ind_var, ind_reg, node, true);
-    }
-    getValueIntoRegister(arr_sym->mem_start, accumulator_, node);
-    if(arr_sym->type == symbol_type::PROC_ARRAY_ARGUMENT) {
-      node->code_list_.push_back("LOAD " + accumulator_->register_name_);
-    }
-    node->code_list_.push_back("ADD " + ind_reg->register_name_);
-    node->code_list_.push_back("PUT " + ind_reg->register_name_);
-    if(reg_with_result->register_name_ == "a") {
-      node->code_list_.push_back("GET " + acc_hold_reg->register_name_);
+    // stored element can be one of elements with constant index
+    saveArrayElements(command->left_var_->getVariableName(), node);
+    std::string element_address_register = inductionAddressRegister(command->left_var_);
+    if(!element_address_register.empty()) {
+      if(reg_with_result->register_name_ == "a") {
+        node->code_list_.push_back("GET " + acc_hold_reg->register_name_);
+      } else {
+        node->code_list_.push_back("GET " + reg_with_result->register_name_);
+      }
+      node->code_list_.push_back("STORE " + element_address_register);
     } else {
-      node->code_list_.push_back("GET " + reg_with_result->register_name_);
+      Variable *ind_var = new Variable ;
+      ind_var->type = variable_type::VAR;
+      ind_var->var_name = command->left_var_->getIndexVariableName();
+      std::shared_ptr<Register> ind_reg = checkVariableAlreadyLoaded(ind_var);
+      if(ind_reg && ind_reg->register_name_ == "a") {
+        // accumulator is used for address calculation
+        std::shared_ptr<Register> tmp_reg = findFreeRegister(node, true);
+        node->code_list_.push_back("PUT " + tmp_reg->register_name_);
+        tmp_reg->curr_variable = accumulator_->curr_variable;
+        tmp_reg->variable_saved_ = accumulator_->variable_saved_;
+        accumulator_->curr_variable = nullptr;
+        accumulator_->variable_saved_ = true;
+        ind_reg = tmp_reg;
+      }
+      if(!ind_reg) {
+        ind_reg = loadVariable(ind_var, ind_reg, node, true);
+      }
+      // register with unsaved index value can not be overwritten by address
+      std::shared_ptr<Register> addr_reg = ind_reg;
+      if(!ind_reg->variable_saved_) {
+        ind_reg->currently_used_ = true;
+        addr_reg = findFreeRegister(node);
+        ind_reg->currently_used_ = false;
+      }
+      generateArrayAddress(command->left_var_->getVariableName(), node);
+      node->code_list_.push_back("ADD " + ind_reg->register_name_);
+      node->code_list_.push_back("PUT " + addr_reg->register_name_);
+      if(reg_with_result->register_name_ == "a") {
+        node->code_list_.push_back("GET " + acc_hold_reg->register_name_);
+      } else {
+        node->code_list_.push_back("GET " + reg_with_result->register_name_);
+      }
+      node->code_list_.push_back("STORE " + addr_reg->register_name_);
+      addr_reg->curr_variable = nullptr;
+      addr_reg->currently_used_ = false;
+      addr_reg->variable_saved_ = true;
     }
-    node->code_list_.push_back("STORE " + ind_reg->register_name_);
-    ind_reg->curr_variable = nullptr;
-    ind_reg->currently_used_ = false;
-    ind_reg->variable_saved_ = true;
+    forgetArrayElements(command->left_var_->getVariableName(), reg_with_result, true);
     if(reg_with_result->register_name_ == "a") { // rework registers state
       accumulator_->curr_variable = command->left_var_;
       acc_hold_reg->currently_used_ = false;
@@ -1064,6 +2256,7 @@ void CodeGenerator::saveRegisterAfterAssignmentIfNeeded(AssignmentCommand *comma
       free_reg->currently_used_ = false;
     }
   }
+  forgetArgumentAliases(command->left_var_, reg_with_result);
 }
 
 std::string CodeGenerator::stringifyRegistersState() {
@@ -1,8 +1,13 @@
 #ifndef CUSTOMCOMPILER_COMPILER_CODE_GENERATOR_H_
 #define CUSTOMCOMPILER_COMPILER_CODE_GENERATOR_H_
 
+#include <map>
+#include <set>
+#include "compiler_stats.h"
 #include "data.h"
 
+class ProcedureCache;
+
 class GraphNode {
  public:
   std::vector<Command*> commands;
@@ -25,17 +30,69 @@ class GraphNode {
   long long int node_length_ = 0;
 
   std::string proc_name;
+  // symbol table of procedure, set only in start node of flow graph
+  std::shared_ptr<SymbolTable> symbol_table = nullptr;
+  // variables kept in registers for whole procedure and names of their registers, set only in start node
+  std::map<std::string, std::string> allocated_registers;
+  // register holding return address of procedure, empty if it is stored in memory, set only in start node
+  std::string return_address_register;
+  // variables kept in registers only during loop and names of their registers, set only in loop condition nodes
+  std::map<std::string, std::string> loop_allocated_registers;
+  // arrays which addresses are kept in registers during loop and names of their registers, set only in loop condition nodes
+  std::map<std::string, std::string> loop_array_registers;
+  // arrays from loop_array_registers, which register holds address of element indexed by induction variable
+  // instead of address of array, and names of index variables
+  std::map<std::string, std::string> loop_array_induction_variables;
   bool should_save_registers_after_code = false;
 
   std::vector<std::shared_ptr<Register>> regs_prepared_for_condition;
+  // registers state at the end of then branch of if-else, merged with state at the end of else branch
+  std::vector<std::shared_ptr<Register>> registers_at_jump_;
+
+  // results of liveness analysis - names of local scalar variables read before being overwritten
+  bool liveness_computed_ = false;
+  std::set<std::string> live_in_;
+  std::vector<std::set<std::string>> live_after_commands_;
+  std::set<std::string> live_before_condition_;
+  // live after node and its branches, at start of following node
+  std::set<std::string> live_out_;
+
+  // name of block given before optimization passes, identifies node in profiles
+  std::string profile_block_name_;
+  // executions of commands and of condition counted by profile, -1 if not known
+  long long int profile_executions_ = -1;
+  long long int profile_condition_executions_ = -1;
 };
 
+typedef std::vector<std::shared_ptr<GraphNode>> FlowGraphs;
+
+/**
+ * Effects of procedure call visible to the caller, including effects of procedures called by the procedure:
+ * names of arguments, that can be read or changed by procedure, and registers changed by its code. Caller has
+ * to save only values accessed through arguments and values of registers changed by procedure. Arguments passed
+ * by value are copied by caller into registers of procedure, or into memory of argument if register is empty.
+ */
+typedef struct procedure_call_summary {
+  std::set<std::string> read_arguments;
+  std::set<std::string> written_arguments;
+  std::set<std::string> clobbered_registers;
+  std::map<std::string, std::string> value_arguments;
+} ProcedureCallSummary;
+
+// name of main program used in statistics and reports
+const std::string k_main_procedure_name = "PROGRAM";
+
 class CodeGenerator {
  public:
   CodeGenerator();
   void generateFlowGraph(Procedure main, std::vector<Procedure> procedures);
   void generateCode();
   std::vector<std::shared_ptr<GraphNode>> getGraphs();
+  std::vector<std::string> getGraphsNames();
+  void setStats(std::shared_ptr<CompilerStats> stats);
+  void setProcedureCache(std::shared_ptr<ProcedureCache> cache, std::string options_fingerprint);
+  // append code of whole graph in output order, including jumps closing loops and branches
+  static void flattenGraph(std::shared_ptr<GraphNode> node, std::vector<std::string> &lines);
 
  private:
   std::shared_ptr<GraphNode> generateSingleFlowGraph(Procedure proc);
@@ -45,23 +102,65 @@ class CodeGenerator {
   std::vector<std::shared_ptr<SymbolTable>> symbol_tables_;
   std::vector<std::shared_ptr<GraphNode>> procedures_start_nodes_;
   std::vector<std::string> procedures_names_;
+  // summaries of already generated procedures
+  std::map<std::string, ProcedureCallSummary> procedures_summaries_;
+  void summarizeProcedure(std::shared_ptr<GraphNode> graph, std::vector<std::string> lines);
 
   void generateCodePreorder(std::shared_ptr<GraphNode> node);
   std::shared_ptr<Register> accumulator_;
   std::vector<std::shared_ptr<Register>> registers_;
 
   long long int current_start_line_ = 0;
+  // name of procedure that code is currently generated for, used in statistics
+  std::string current_procedure_name_;
+  std::shared_ptr<CompilerStats> stats_;
+
+  // compilation cache
+  std::shared_ptr<ProcedureCache> procedure_cache_;
+  std::string options_fingerprint_;
+  std::string describeProcedure(int proc_index);
+  std::string describeCommand(Command* comm);
+  bool relocateProcedureCode(long long int proc_start_line,
+                             std::vector<std::string> lines,
+                             std::vector<std::string> &fragment);
+  bool linkProcedureCode(std::vector<std::string> fragment, std::vector<std::string> &lines);
   bool generate_jump_to_main_ = false;
   void generateProcedureStart(std::shared_ptr<GraphNode> node);
   void generateProcedureEnd(std::shared_ptr<GraphNode> node);
 
   // registers management
+  std::map<std::string, std::string> allocated_registers_;
+  void setAllocatedRegisters(std::shared_ptr<GraphNode> graph);
+  std::set<std::string> withoutRegisterArguments(std::set<std::string> variables);
+  void loadAllocatedVariables(std::shared_ptr<GraphNode> node, std::set<std::string> live_variables);
+  void storeAllocatedVariables(std::shared_ptr<GraphNode> node,
+                               std::shared_ptr<Register> free_reg,
+                               std::set<std::string> live_variables);
+  void loadAllocatedVariable(std::shared_ptr<GraphNode> node, std::string variable_name, std::string register_name);
+  void storeAllocatedVariable(std::shared_ptr<GraphNode> node,
+                              std::shared_ptr<Register> free_reg,
+                              std::string variable_name,
+                              std::string register_name);
+  // addresses of arrays kept in registers during currently generated loops
+  std::map<std::string, std::string> array_address_registers_;
+  // arrays which address register follows value of index variable and names of these variables
+  std::map<std::string, std::string> array_induction_variables_;
+  void generateArrayAddress(std::string array_name, std::shared_ptr<GraphNode> node);
+  // register holding address of element with variable index, empty if address has to be calculated
+  std::string inductionAddressRegister(VariableContainer* var);
+  void allocateLoopRegisters(std::shared_ptr<GraphNode> node);
+  void releaseLoopRegisters(std::shared_ptr<GraphNode> node, std::vector<std::shared_ptr<Register>> registers);
   void saveVariableFromRegister(std::shared_ptr<Register> reg,
                                 std::shared_ptr<Register> other_free_reg,
                                 std::shared_ptr<GraphNode> node,
                                 bool keep_variable);
   void moveAccumulatorToFreeRegister(std::shared_ptr<GraphNode> node);
-  std::shared_ptr<Register> findFreeRegister(std::shared_ptr<GraphNode> node);
+  void saveAccumulator(std::shared_ptr<GraphNode> node);
+  // checks, if value of register can be loaded again from memory or as constant
+  bool isValueReloadable(VariableContainer* value);
+  // checks, if saving value of register needs other register for address of procedure argument
+  bool needsHelpToSave(std::shared_ptr<Register> reg);
+  std::shared_ptr<Register> findFreeRegister(std::shared_ptr<GraphNode> node, bool keep_accumulator = false);
   void getValueIntoRegister(size_t value, std::shared_ptr<Register> reg, std::shared_ptr<GraphNode> node);
   std::shared_ptr<Register> checkVariableAlreadyLoaded(VariableContainer* var);
   std::shared_ptr<Register> loadVariable(VariableContainer* var,
@@ -72,13 +171,32 @@ class CodeGenerator {
   std::vector<std::shared_ptr<Register>> saveRegistersState();
   void loadRegistersState(std::vector<std::shared_ptr<Register>> saved_regs);
 
-  void saveRegistersValues(std::shared_ptr<GraphNode> node);
+  void saveRegistersValues(std::shared_ptr<GraphNode> node, bool keep_saved_values = false);
+  // stores unsaved elements of array with constant indexes, before element with variable index is used
+  void saveArrayElements(std::string array_name, std::shared_ptr<GraphNode> node);
+  // forgets elements of array, that could be changed by assignment to other element of array
+  void forgetArrayElements(std::string array_name, std::shared_ptr<Register> kept_reg, bool constant_indexes);
+  // forgets values of other procedure arguments, which can reference the same variable as written argument
+  void forgetArgumentAliases(VariableContainer* written_var, std::shared_ptr<Register> kept_reg);
+  void mergeRegistersState(std::shared_ptr<GraphNode> node, std::vector<std::shared_ptr<Register>> target_state);
+
+  // variables live at currently generated point of code, stores of other local variables are skipped
+  bool live_variables_known_ = false;
+  std::set<std::string> live_variables_;
+  void setLiveVariables(std::shared_ptr<GraphNode> node, std::set<std::string> live_variables);
+  bool isVariableLive(VariableContainer* var);
 
   // commands handling
   void handleAssignmentCommand(AssignmentCommand* command, std::shared_ptr<GraphNode> node);
   void handleReadCommand(ReadCommand* command, std::shared_ptr<GraphNode> node);
   void handleWriteCommand(WriteCommand* command, std::shared_ptr<GraphNode> node);
   void handleProcedureCallCommand(ProcedureCallCommand* command, std::shared_ptr<GraphNode> node);
+  // adds arguments of current procedure, if any of them is in variables, as arguments can refer to the same variable
+  void addArgumentAliases(std::set<std::string> &variables);
+  void copyValueArgumentsIn(ProcedureCallCommand *command,
+                            std::shared_ptr<Register> free_reg,
+                            std::shared_ptr<GraphNode> node);
+  void copyValueArgumentsOut(ProcedureCallCommand *command, std::shared_ptr<GraphNode> node);
 
   // conditions handling
   void prepareCondition(std::shared_ptr<GraphNode> node);
@@ -0,0 +1,126 @@
+#include "command_copy.h"
+#include "flow_analysis.h"
+
+CommandCopy::CommandCopy(std::map<std::string, std::string> renamed_variables)
+    : renamed_variables_(renamed_variables) {
+}
+
+std::vector<Command*> CommandCopy::copyCommands(std::vector<Command*> &commands) {
+  std::vector<Command*> copied;
+  for(auto comm : commands) {
+    copied.push_back(copyCommand(comm));
+  }
+  return copied;
+}
+
+Command* CommandCopy::copyCommand(Command* comm) {
+  if(comm->type == command_type::ASSIGNMENT) {
+    AssignmentCommand* assignment_command = static_cast<AssignmentCommand*>(comm);
+    AssignmentCommand* copy = new AssignmentCommand;
+    copy->left_var_ = copyValue(assignment_command->left_var_);
+    copy->expression_ = copyExpression(assignment_command->expression_);
+    copy->type = command_type::ASSIGNMENT;
+    return copy;
+  } else if(comm->type == command_type::IF_ELSE) {
+    IfElseCommand* if_else_command = static_cast<IfElseCommand*>(comm);
+    IfElseCommand* copy = new IfElseCommand;
+    copy->cond_ = copyCondition(if_else_command->cond_);
+    copy->then_commands_ = copyCommands(if_else_command->then_commands_);
+    copy->else_commands_ = copyCommands(if_else_command->else_commands_);
+    copy->type = command_type::IF_ELSE;
+    return copy;
+  } else if(comm->type == command_type::WHILE) {
+    WhileCommand* while_command = static_cast<WhileCommand*>(comm);
+    WhileCommand* copy = new WhileCommand;
+    copy->cond_ = copyCondition(while_command->cond_);
+    copy->commands_ = copyCommands(while_command->commands_);
+    copy->type = command_type::WHILE;
+    return copy;
+  } else if(comm->type == command_type::REPEAT) {
+    RepeatUntilCommand* repeat_command = static_cast<RepeatUntilCommand*>(comm);
+    RepeatUntilCommand* copy = new RepeatUntilCommand;
+    copy->cond_ = copyCondition(repeat_command->cond_);
+    copy->commands_ = copyCommands(repeat_command->commands_);
+    copy->type = command_type::REPEAT;
+    return copy;
+  } else if(comm->type == command_type::PROC_CALL) {
+    ProcedureCallCommand* procedure_call_command = static_cast<ProcedureCallCommand*>(comm);
+    ProcedureCallCommand* copy = new ProcedureCallCommand;
+    copy->proc_call_ = procedure_call_command->proc_call_;
+    for(auto & arg : copy->proc_call_.args) {
+      arg.name = renamedVariable(arg.name);
+    }
+    copy->type = command_type::PROC_CALL;
+    return copy;
+  } else if(comm->type == command_type::READ) {
+    ReadCommand* copy = new ReadCommand;
+    copy->var_ = copyValue(static_cast<ReadCommand*>(comm)->var_);
+    copy->type = command_type::READ;
+    return copy;
+  }
+  WriteCommand* copy = new WriteCommand;
+  copy->written_value_ = copyValue(static_cast<WriteCommand*>(comm)->written_value_);
+  copy->type = command_type::WRITE;
+  return copy;
+}
+
+DefaultExpression* CommandCopy::copyExpression(DefaultExpression* expression) {
+  DefaultExpression* copy;
+  if(dynamic_cast<PlusExpression*>(expression)) {
+    copy = new PlusExpression;
+  } else if(dynamic_cast<MinusExpression*>(expression)) {
+    copy = new MinusExpression;
+  } else if(dynamic_cast<MultiplyExpression*>(expression)) {
+    copy = new MultiplyExpression;
+  } else if(dynamic_cast<DivideExpression*>(expression)) {
+    copy = new DivideExpression;
+  } else if(dynamic_cast<ModuloExpression*>(expression)) {
+    copy = new ModuloExpression;
+  } else {
+    copy = new DefaultExpression;
+  }
+  copy->var_ = copyValue(expression->var_);
+  VariableContainer** right_operand = expressionRightOperand(expression);
+  if(right_operand) {
+    *expressionRightOperand(copy) = copyValue(*right_operand);
+  }
+  return copy;
+}
+
+Condition CommandCopy::copyCondition(Condition &cond) {
+  Condition copy;
+  copy.type_ = cond.type_;
+  copy.left_var_ = copyValue(cond.left_var_);
+  copy.right_var_ = copyValue(cond.right_var_);
+  return copy;
+}
+
+VariableContainer* CommandCopy::copyValue(VariableContainer* var) {
+  if(var->type == variable_type::R_VAL) {
+    RValue* copy = new RValue;
+    copy->type = variable_type::R_VAL;
+    copy->value = var->getValue();
+    return copy;
+  } else if(var->type == variable_type::VAR) {
+    Variable* copy = new Variable;
+    copy->type = variable_type::VAR;
+    copy->var_name = renamedVariable(var->getVariableName());
+    return copy;
+  } else if(var->type == variable_type::ARR) {
+    Array* copy = new Array;
+    copy->type = variable_type::ARR;
+    copy->var_name = renamedVariable(var->getVariableName());
+    copy->index = var->getValue();
+    return copy;
+  }
+  VariableIndexedArray* copy = new VariableIndexedArray;
+  copy->type = variable_type::VARIABLE_INDEXED_ARR;
+  copy->var_name = renamedVariable(var->getVariableName());
+  copy->index_var_name = renamedVariable(var->getIndexVariableName());
+  return copy;
+}
+
+std::string CommandCopy::renamedVariable(std::string name) {
+  auto renamed = renamed_variables_.find(name);
+  return renamed == renamed_variables_.end() ? name : renamed->second;
+}
@@ -0,0 +1,28 @@
+#ifndef CUSTOMCOMPILER_COMPILER_COMMAND_COPY_H_
+#define CUSTOMCOMPILER_COMPILER_COMMAND_COPY_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include "data.h"
+
+/**
+ * Deep copy of commands of procedure, used when bodies of procedures are duplicated by inlining and cloning.
+ * Names of variables found in renamed variables are replaced, other names are kept.
+ */
+class CommandCopy {
+ public:
+  explicit CommandCopy(std::map<std::string, std::string> renamed_variables = {});
+  std::vector<Command*> copyCommands(std::vector<Command*> &commands);
+
+ private:
+  std::map<std::string, std::string> renamed_variables_;
+
+  Command* copyCommand(Command* comm);
+  DefaultExpression* copyExpression(DefaultExpression* expression);
+  Condition copyCondition(Condition &cond);
+  VariableContainer* copyValue(VariableContainer* var);
+  std::string renamedVariable(std::string name);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_COMMAND_COPY_H_
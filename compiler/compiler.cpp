@@ -1,20 +1,143 @@
 #include <fstream>
+#include "block_layout.h"
+#include "cloning.h"
 #include "compiler.h"
+#include "inlining.h"
+#include "materialization.h"
+#include "optimization_passes.h"
+#include "peephole.h"
+#include "procedure_cache.h"
+#include "profile.h"
+#include "virtual_machine.h"
 
 Compiler::Compiler() {
   current_symbol_table_ = std::make_shared<SymbolTable>();
   code_generator_ = std::make_shared<CodeGenerator>();
+  stats_ = std::make_shared<CompilerStats>();
+  code_generator_->setStats(stats_);
+  pass_manager_ = std::make_shared<PassManager>();
+  registerOptimizationPasses(*pass_manager_);
+  cost_model_ = std::make_shared<CostModel>();
+  pass_manager_->setCostModel(cost_model_);
 }
 
 void Compiler::setOutputFileName(std::string f_name) {
   output_file_name_ = f_name;
 }
 
-void Compiler::compile() {
+void Compiler::setOptions(CompilerOptions options) {
+  options_ = options;
+  setOutputFileName(options.output_file_name);
+  pass_manager_->configure(options);
+  cost_model_ = std::make_shared<CostModel>(options.default_trip_count);
+  pass_manager_->setCostModel(cost_model_);
+  if(!options.profile_use_file_name.empty()) {
+    profile_ = std::make_shared<Profile>(Profile::read(options.profile_use_file_name));
+  }
+  // code generated with profile depends on counts, which are not part of cache keys
+  if(!options.cache_directory.empty() && options.profile_gen_file_name.empty() && !profile_) {
+    code_generator_->setProcedureCache(std::make_shared<ProcedureCache>(options.cache_directory),
+                                       compilerOptionsFingerprint(options));
+  }
+}
+
+std::shared_ptr<CompilerStats> Compiler::getStats() {
+  return stats_;
+}
+
+bool Compiler::compile() {
+  if(pass_manager_->isEnabled("inline-procedures")) {
+    stats_->startPhase("inlining");
+    ProcedureInlining inlining(stats_, options_.default_trip_count);
+    inlining.setMemoryEnd(curr_memory_offset_);
+    inlining.run(procedures_, main_);
+    stats_->endPhase("inlining");
+  }
+  if(pass_manager_->isEnabled("clone-procedures")) {
+    stats_->startPhase("cloning");
+    ProcedureCloning cloning(stats_);
+    cloning.run(procedures_, main_);
+    stats_->endPhase("cloning");
+  }
+  stats_->startPhase("flow-graph");
   code_generator_->generateFlowGraph(main_, procedures_);
+  stats_->endPhase("flow-graph");
+  std::vector<std::shared_ptr<GraphNode>> flow_graphs = code_generator_->getGraphs();
+  if(profile_ || !options_.profile_gen_file_name.empty()) {
+    Profile::nameBlocks(flow_graphs);
+  }
+  if(profile_) {
+    profile_->apply(flow_graphs);
+  }
+  pass_manager_->runPasses(flow_graphs, stats_);
+  stats_->startPhase("code-generation");
   code_generator_->generateCode();
+  stats_->endPhase("code-generation");
   std::vector<std::shared_ptr<GraphNode>> graphs_start_nodes = code_generator_->getGraphs();
-  outputCode(graphs_start_nodes);
+  std::vector<std::string> graphs_names = code_generator_->getGraphsNames();
+  if(options_.cost_report || options_.print_stats || !options_.stats_json_file_name.empty()) {
+    procedures_costs_ = cost_model_->estimateGeneratedCode(graphs_start_nodes);
+    // main program is the last one, its cost includes costs of called procedures
+    stats_->addCounter("estimated_cost", procedures_costs_.back().cost);
+  }
+  for(int i = 0; i < graphs_start_nodes.size(); i++) {
+    long long int nodes = 0;
+    long long int instructions = 0;
+    countGraphRecursively(graphs_start_nodes.at(i), nodes, instructions);
+    stats_->addProcedureCounter(graphs_names.at(i), "cfg_nodes", nodes);
+    stats_->addProcedureCounter(graphs_names.at(i), "instructions", instructions);
+  }
+  std::vector<std::string> lines = collectCode(graphs_start_nodes);
+  // profile counts executions of lines generated for flow graph nodes, so final code can not be changed
+  bool change_final_code = options_.profile_gen_file_name.empty();
+  bool thread_jumps = change_final_code && pass_manager_->isEnabled("jump-threading");
+  bool rotate_loops = change_final_code && pass_manager_->isEnabled("loop-rotation");
+  if(thread_jumps || rotate_loops) {
+    stats_->startPhase("block-layout");
+    BlockLayout layout(stats_, thread_jumps, rotate_loops);
+    lines = layout.run(lines);
+    stats_->endPhase("block-layout");
+  }
+  if(change_final_code && pass_manager_->isEnabled("derive-constants")) {
+    stats_->startPhase("constant-materialization");
+    ConstantMaterialization materialization(stats_);
+    lines = materialization.run(lines);
+    stats_->endPhase("constant-materialization");
+  }
+  std::set<std::string> peephole_patterns;
+  for(auto & pattern : peepholePatterns()) {
+    if(change_final_code && pass_manager_->isEnabled(k_peephole_pass_prefix + pattern.name)) {
+      peephole_patterns.insert(pattern.name);
+    }
+  }
+  if(!peephole_patterns.empty()) {
+    stats_->startPhase("peephole");
+    PeepholeOptimizer peephole(stats_, peephole_patterns);
+    lines = peephole.run(lines);
+    stats_->endPhase("peephole");
+  }
+  if(options_.run) {
+    return runCode(lines, graphs_start_nodes);
+  }
+  stats_->startPhase("output");
+  outputCode(lines);
+  stats_->endPhase("output");
+  return true;
+}
+
+void Compiler::reportStats() {
+  if(options_.time_passes || options_.print_stats) {
+    stats_->printReport(std::cerr, options_.print_stats);
+  }
+  if(options_.cost_report) {
+    cost_model_->printReport(std::cerr, procedures_costs_);
+  }
+  if(options_.pass_report) {
+    pass_manager_->printReport(std::cerr);
+  }
+  if(!options_.stats_json_file_name.empty()) {
+    stats_->writeJson(options_.stats_json_file_name);
+  }
 }
 
 void Compiler::declareProcedure(std::vector<Command*> commands) {
@@ -398,32 +521,74 @@ VariableContainer *Compiler::checkVariableInitialization(VariableContainer *var,
   return var;
 }
 
-void Compiler::outputCode(std::vector<std::shared_ptr<GraphNode>> start_nodes) {
-  std::fstream f;
-  f.open(output_file_name_, std::ios::out);
+std::vector<std::string> Compiler::collectCode(std::vector<std::shared_ptr<GraphNode>> start_nodes) {
+  std::vector<std::string> lines;
   if(start_nodes.size() > 1) {
-    f << "JUMP " << start_nodes.at(start_nodes.size() - 1)->start_line_ << std::endl;
+    lines.push_back("JUMP " + std::to_string(start_nodes.at(start_nodes.size() - 1)->start_line_));
   }
   for(auto start_node : start_nodes) {
-    outputGraphRecursively(start_node, f);
+    CodeGenerator::flattenGraph(start_node, lines);
+  }
+  lines.push_back("HALT");
+  return lines;
+}
+
+void Compiler::outputCode(std::vector<std::string> lines) {
+  std::fstream f;
+  f.open(output_file_name_, std::ios::out);
+  for(auto & line : lines) {
+    f << line << "\n";
   }
-  f << "HALT" << std::endl;
   f.close();
 }
 
-void Compiler::outputGraphRecursively(std::shared_ptr<GraphNode> curr_node, std::fstream &f_out) {
-  for(auto line : curr_node->code_list_) {
-    f_out << line << std::endl;
+bool Compiler::runCode(std::vector<std::string> lines, FlowGraphs &graphs) {
+  stats_->startPhase("run");
+  RunResult result;
+  try {
+    VirtualMachine machine(VirtualMachine::parseProgram(lines));
+    if(options_.run_inputs_file_name.empty()) {
+      result = machine.run(std::cin, std::cout, true);
+    } else {
+      std::ifstream inputs(options_.run_inputs_file_name);
+      if(!inputs.is_open()) {
+        throw std::runtime_error("Cannot open inputs file " + options_.run_inputs_file_name);
+      }
+      result = machine.run(inputs, std::cout, false);
+    }
+  } catch(std::runtime_error & e) {
+    stats_->endPhase("run");
+    std::cerr << "Error during execution: " << e.what() << std::endl;
+    return false;
   }
+  stats_->endPhase("run");
+  stats_->addCounter("vm_cost", result.cost + result.io_cost);
+  stats_->addCounter("vm_io_cost", result.io_cost);
+  stats_->addCounter("vm_executed_instructions", result.executed_instructions);
+  std::cout << "Program finished (cost: " << result.cost + result.io_cost
+            << "; io: " << result.io_cost << ")." << std::endl;
+  if(!options_.profile_gen_file_name.empty()) {
+    try {
+      Profile::collect(graphs, result.line_executions).write(options_.profile_gen_file_name);
+    } catch(std::runtime_error & e) {
+      std::cerr << e.what() << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+void Compiler::countGraphRecursively(std::shared_ptr<GraphNode> curr_node,
+                                     long long int &nodes,
+                                     long long int &instructions) {
+  nodes++;
+  instructions += curr_node->code_list_.size();
   if(curr_node->left_node)
-    outputGraphRecursively(curr_node->left_node, f_out);
+    countGraphRecursively(curr_node->left_node, nodes, instructions);
   if(curr_node->right_node)
-    outputGraphRecursively(curr_node->right_node, f_out);
-  if(curr_node->jump_line_target) {
-    f_out << "JUMP " << curr_node->jump_line_target->start_line_ << std::endl;
-  } else if(curr_node->jump_condition_target) {
-    f_out << "JUMP " << curr_node->jump_condition_target->condition_start_line_ << std::endl;
-  }
+    countGraphRecursively(curr_node->right_node, nodes, instructions);
+  if(curr_node->jump_line_target || curr_node->jump_condition_target)
+    instructions++;
 }
 
 Symbol Compiler::createSymbol(std::string symbol_name, enum symbol_type type) {
@@ -2,13 +2,22 @@
 #define CUSTOMCOMPILER_COMPILER_COMPILER_H_
 
 #include "code_generator.h"
+#include "compiler_options.h"
+#include "compiler_stats.h"
+#include "cost_model.h"
 #include "data.h"
+#include "pass_manager.h"
+#include "profile.h"
 
 class Compiler {
  public:
   Compiler();
   void setOutputFileName(std::string f_name);
-  void compile();
+  void setOptions(CompilerOptions options);
+  std::shared_ptr<CompilerStats> getStats();
+  // returns false if compiled program was run and its execution failed
+  bool compile();
+  void reportStats();
 
   // procedures declarations
   void declareProcedure(std::vector<Command*> commands);
@@ -66,8 +75,11 @@ class Compiler {
   VariableContainer* checkVariableInitialization(VariableContainer* var, int line_number);
 
  private:
-  void outputCode(std::vector<std::shared_ptr<GraphNode>> start_nodes);
-  void outputGraphRecursively(std::shared_ptr<GraphNode> curr_node, std::fstream &f_out);
+  std::vector<std::string> collectCode(std::vector<std::shared_ptr<GraphNode>> start_nodes);
+  void outputCode(std::vector<std::string> lines);
+  // profile of the run is written if requested by options
+  bool runCode(std::vector<std::string> lines, FlowGraphs &graphs);
+  void countGraphRecursively(std::shared_ptr<GraphNode> curr_node, long long int &nodes, long long int &instructions);
   // current symbol table used for local declarations, passed to functions objects
   std::shared_ptr<SymbolTable> current_symbol_table_;
 
@@ -94,6 +106,13 @@ class Compiler {
   Procedure main_;
 
   std::string output_file_name_;
+  CompilerOptions options_;
+  std::shared_ptr<CompilerStats> stats_;
+  std::shared_ptr<PassManager> pass_manager_;
+  std::shared_ptr<CostModel> cost_model_;
+  std::vector<ProcedureCost> procedures_costs_;
+  // block counts read from profile file, nullptr without --profile-use
+  std::shared_ptr<Profile> profile_;
 };
 
 #endif  // CUSTOMCOMPILER_COMPILER_COMPILER_H_
@@ -0,0 +1,123 @@
+#include <stdexcept>
+#include <vector>
+#include "compiler_options.h"
+
+CompilerOptions parseCompilerOptions(int argc, char* argv[]) {
+  CompilerOptions options;
+  std::vector<std::string> positional_arguments;
+  for(int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if(arg == "-O0" || arg == "-O1" || arg == "-O2") {
+      options.optimization_level = arg.at(2) - '0';
+      options.optimize_for_size = false;
+    } else if(arg == "-Os") {
+      options.optimization_level = 2;
+      options.optimize_for_size = true;
+    } else if(arg.size() < 2 || arg.substr(0, 2) != "--") {
+      positional_arguments.push_back(arg);
+    } else if(arg == "--time-passes") {
+      options.time_passes = true;
+    } else if(arg == "--stats") {
+      options.print_stats = true;
+    } else if(arg == "--stats-json") {
+      if(i + 1 >= argc) {
+        throw std::runtime_error("Missing file name after " + arg);
+      }
+      options.stats_json_file_name = std::string(argv[++i]);
+    } else if(arg == "--cache-dir") {
+      if(i + 1 >= argc) {
+        throw std::runtime_error("Missing directory name after " + arg);
+      }
+      options.cache_directory = std::string(argv[++i]);
+    } else if(arg == "--enable-pass" || arg == "--disable-pass") {
+      if(i + 1 >= argc) {
+        throw std::runtime_error("Missing pass name after " + arg);
+      }
+      if(arg == "--enable-pass") {
+        options.enabled_passes.push_back(std::string(argv[++i]));
+      } else {
+        options.disabled_passes.push_back(std::string(argv[++i]));
+      }
+    } else if(arg == "--pass-report") {
+      options.pass_report = true;
+    } else if(arg == "--cost-report") {
+      options.cost_report = true;
+    } else if(arg == "--trip-count") {
+      if(i + 1 >= argc) {
+        throw std::runtime_error("Missing number after " + arg);
+      }
+      try {
+        options.default_trip_count = std::stoll(std::string(argv[++i]));
+      } catch(std::exception & e) {
+        throw std::runtime_error("Bad number after " + arg);
+      }
+      if(options.default_trip_count < 0) {
+        throw std::runtime_error("Trip count can not be negative");
+      }
+    } else if(arg == "--profile-gen" || arg == "--profile-use") {
+      if(i + 1 >= argc) {
+        throw std::runtime_error("Missing file name after " + arg);
+      }
+      if(arg == "--profile-gen") {
+        options.profile_gen_file_name = std::string(argv[++i]);
+      } else {
+        options.profile_use_file_name = std::string(argv[++i]);
+      }
+    } else if(arg == "--run") {
+      options.run = true;
+    } else if(arg == "--inputs") {
+      if(i + 1 >= argc) {
+        throw std::runtime_error("Missing file name after " + arg);
+      }
+      options.run_inputs_file_name = std::string(argv[++i]);
+    } else {
+      throw std::runtime_error("Unknown option " + arg);
+    }
+  }
+  if(!options.run_inputs_file_name.empty() && !options.run) {
+    throw std::runtime_error("Option --inputs requires --run");
+  }
+  if(!options.profile_gen_file_name.empty() && !options.run) {
+    throw std::runtime_error("Option --profile-gen requires --run");
+  }
+  if(positional_arguments.size() != 2 && !(options.run && positional_arguments.size() == 1)) {
+    throw std::runtime_error("Bad number of program arguments");
+  }
+  options.input_file_name = positional_arguments.at(0);
+  if(positional_arguments.size() == 2) {
+    options.output_file_name = positional_arguments.at(1);
+  }
+  return options;
+}
+
+std::string compilerOptionsFingerprint(CompilerOptions options) {
+  std::string fingerprint = "O" + std::to_string(options.optimization_level) +
+      (options.optimize_for_size ? "s" : "");
+  for(auto & name : options.enabled_passes) {
+    fingerprint += " +" + name;
+  }
+  for(auto & name : options.disabled_passes) {
+    fingerprint += " -" + name;
+  }
+  return fingerprint;
+}
+
+std::string compilerUsage() {
+  return " Usage: compiler [options] <input_file_name> <output_file_name>\n"
+         "        compiler --run [--inputs <file>] [options] <input_file_name>\n"
+         " Options:\n"
+         "  -O0, -O1, -O2, -Os     optimization level (default -O2), -Os skips passes increasing code size\n"
+         "  --enable-pass <name>   enable optimization pass regardless of level\n"
+         "  --disable-pass <name>  disable optimization pass and passes depending on it\n"
+         "  --pass-report          print enabled passes with estimated cost before and after each of them\n"
+         "  --time-passes          print wall time, allocations and peak memory of every phase\n"
+         "  --stats                print phase times and code generation counters\n"
+         "  --stats-json <file>    write phase times and counters to file in JSON format\n"
+         "  --cache-dir <dir>      reuse code of procedures generated by previous compilations, stored in dir\n"
+         "  --cost-report          print static cost estimate of every procedure and block of generated code\n"
+         "  --trip-count <n>       number of iterations assumed for loops in cost estimates (default 10)\n"
+         "  --profile-gen <file>   write execution counts of blocks of program run by --run to file\n"
+         "  --profile-use <file>   use execution counts of blocks from file instead of static estimates\n"
+         "  --run                  run compiled program in built-in virtual machine instead of writing output\n"
+         "  --inputs <file>        read values for READ instructions of --run from file instead of stdin\n";
+}
@@ -0,0 +1,49 @@
+#ifndef CUSTOMCOMPILER_COMPILER_COMPILER_OPTIONS_H_
+#define CUSTOMCOMPILER_COMPILER_COMPILER_OPTIONS_H_
+
+#include <string>
+#include <vector>
+
+/**
+ * Options passed to the compiler from the command line.
+ * Positional arguments are input and output file names (output is not needed with --run),
+ * every other argument is a flag.
+ */
+typedef struct compiler_options {
+  std::string input_file_name;
+  std::string output_file_name;
+
+  // instrumentation
+  bool time_passes = false;
+  bool print_stats = false;
+  std::string stats_json_file_name;
+
+  // directory of persistent procedures code cache, cache is disabled if empty
+  std::string cache_directory;
+
+  // optimizations, level 0-2; -Os is level 2 without passes increasing code size
+  int optimization_level = 2;
+  bool optimize_for_size = false;
+  std::vector<std::string> enabled_passes;
+  std::vector<std::string> disabled_passes;
+  bool pass_report = false;
+
+  // static cost estimation, trip count is assumed for loops without profile data
+  bool cost_report = false;
+  long long int default_trip_count = 10;
+
+  // profile-guided optimization: block counts written after --run, and read before optimization passes
+  std::string profile_gen_file_name;
+  std::string profile_use_file_name;
+
+  // run compiled program in the compiler instead of writing output file
+  bool run = false;
+  std::string run_inputs_file_name;
+} CompilerOptions;
+
+CompilerOptions parseCompilerOptions(int argc, char* argv[]);
+// text describing options that change generated code, used as part of cache keys
+std::string compilerOptionsFingerprint(CompilerOptions options);
+std::string compilerUsage();
+
+#endif  // CUSTOMCOMPILER_COMPILER_COMPILER_OPTIONS_H_
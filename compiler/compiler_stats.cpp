@@ -0,0 +1,180 @@
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <new>
+#include <stdexcept>
+#include <sys/resource.h>
+#include "compiler_stats.h"
+
+namespace {
+std::atomic<unsigned long long> allocation_counter{0};
+std::atomic<unsigned long long> allocated_bytes_counter{0};
+
+std::string escapeJson(std::string text) {
+  std::string result;
+  for(char c : text) {
+    if(c == '"' || c == '\\') {
+      result.push_back('\\');
+    }
+    result.push_back(c);
+  }
+  return result;
+}
+}  // namespace
+
+// global allocation functions are replaced to count allocations done during every phase
+void* operator new(size_t size) {
+  allocation_counter.fetch_add(1, std::memory_order_relaxed);
+  allocated_bytes_counter.fetch_add(size, std::memory_order_relaxed);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if(!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t size) noexcept {
+  std::free(ptr);
+}
+
+void CompilerStats::startPhase(std::string phase_name) {
+  PhaseRecord record;
+  record.name = phase_name;
+  record.allocations_at_start = allocation_counter.load();
+  record.allocated_bytes_at_start = allocated_bytes_counter.load();
+  record.start_time = std::chrono::steady_clock::now();
+  phases_.push_back(record);
+}
+
+void CompilerStats::endPhase(std::string phase_name) {
+  auto end_time = std::chrono::steady_clock::now();
+  for(auto it = phases_.rbegin(); it != phases_.rend(); it++) {
+    if(it->name == phase_name && !it->finished) {
+      it->wall_time_ms = std::chrono::duration<double, std::milli>(end_time - it->start_time).count();
+      it->allocations = allocation_counter.load() - it->allocations_at_start;
+      it->allocated_bytes = allocated_bytes_counter.load() - it->allocated_bytes_at_start;
+      it->peak_rss_kb = peakResidentMemory();
+      it->finished = true;
+      return;
+    }
+  }
+}
+
+void CompilerStats::addCounter(std::string counter_name, long long int value) {
+  addToCounterList(counters_, counter_name, value);
+}
+
+void CompilerStats::addProcedureCounter(std::string procedure_name, std::string counter_name, long long int value) {
+  addCounter(counter_name, value);
+  for(auto & proc_counters : procedure_counters_) {
+    if(proc_counters.first == procedure_name) {
+      addToCounterList(proc_counters.second, counter_name, value);
+      return;
+    }
+  }
+  procedure_counters_.push_back({procedure_name, {{counter_name, value}}});
+}
+
+long long int CompilerStats::getCounter(std::string counter_name) {
+  for(auto & counter : counters_) {
+    if(counter.first == counter_name) {
+      return counter.second;
+    }
+  }
+  return 0;
+}
+
+void CompilerStats::printReport(std::ostream &out, bool print_counters) {
+  out << "===== Compilation phases =====" << std::endl;
+  out << std::left << std::setw(20) << "phase" << std::right
+      << std::setw(14) << "wall [ms]"
+      << std::setw(14) << "allocations"
+      << std::setw(16) << "allocated [B]"
+      << std::setw(16) << "peak RSS [kB]" << std::endl;
+  double total_time = 0;
+  unsigned long long total_allocations = 0;
+  for(auto & phase : phases_) {
+    out << std::left << std::setw(20) << phase.name << std::right
+        << std::setw(14) << std::fixed << std::setprecision(3) << phase.wall_time_ms
+        << std::setw(14) << phase.allocations
+        << std::setw(16) << phase.allocated_bytes
+        << std::setw(16) << phase.peak_rss_kb << std::endl;
+    total_time += phase.wall_time_ms;
+    total_allocations += phase.allocations;
+  }
+  out << std::left << std::setw(20) << "total" << std::right
+      << std::setw(14) << total_time
+      << std::setw(14) << total_allocations << std::endl;
+  if(!print_counters) {
+    return;
+  }
+  out << "===== Counters =====" << std::endl;
+  for(auto & counter : counters_) {
+    out << std::left << std::setw(34) << counter.first << std::right << std::setw(12) << counter.second << std::endl;
+  }
+  for(auto & proc_counters : procedure_counters_) {
+    out << "----- procedure " << proc_counters.first << " -----" << std::endl;
+    for(auto & counter : proc_counters.second) {
+      out << "  " << std::left << std::setw(32) << counter.first << std::right
+          << std::setw(12) << counter.second << std::endl;
+    }
+  }
+}
+
+void CompilerStats::writeJson(std::string file_name) {
+  std::fstream f;
+  f.open(file_name, std::ios::out);
+  if(!f.is_open()) {
+    throw std::runtime_error("Cannot open statistics file " + file_name);
+  }
+  f << "{\n  \"phases\": [";
+  for(int i = 0; i < phases_.size(); i++) {
+    auto & phase = phases_.at(i);
+    f << (i == 0 ? "\n" : ",\n")
+      << "    {\"name\": \"" << escapeJson(phase.name) << "\""
+      << ", \"wall_time_ms\": " << std::fixed << std::setprecision(3) << phase.wall_time_ms
+      << ", \"allocations\": " << phase.allocations
+      << ", \"allocated_bytes\": " << phase.allocated_bytes
+      << ", \"peak_rss_kb\": " << phase.peak_rss_kb << "}";
+  }
+  f << "\n  ],\n  \"counters\": {";
+  for(int i = 0; i < counters_.size(); i++) {
+    f << (i == 0 ? "\n" : ",\n")
+      << "    \"" << escapeJson(counters_.at(i).first) << "\": " << counters_.at(i).second;
+  }
+  f << "\n  },\n  \"procedures\": {";
+  for(int i = 0; i < procedure_counters_.size(); i++) {
+    auto & proc_counters = procedure_counters_.at(i);
+    f << (i == 0 ? "\n" : ",\n") << "    \"" << escapeJson(proc_counters.first) << "\": {";
+    for(int j = 0; j < proc_counters.second.size(); j++) {
+      f << (j == 0 ? "" : ", ")
+        << "\"" << escapeJson(proc_counters.second.at(j).first) << "\": " << proc_counters.second.at(j).second;
+    }
+    f << "}";
+  }
+  f << "\n  }\n}\n";
+  f.close();
+}
+
+void CompilerStats::addToCounterList(CounterList &counters, std::string counter_name, long long int value) {
+  for(auto & counter : counters) {
+    if(counter.first == counter_name) {
+      counter.second += value;
+      return;
+    }
+  }
+  counters.push_back({counter_name, value});
+}
+
+long CompilerStats::peakResidentMemory() {
+  struct rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return usage.ru_maxrss;
+}
@@ -0,0 +1,50 @@
+#ifndef CUSTOMCOMPILER_COMPILER_COMPILER_STATS_H_
+#define CUSTOMCOMPILER_COMPILER_COMPILER_STATS_H_
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Collects instrumentation data of a single compilation - wall time, allocation count
+ * and peak resident memory of every phase, and named counters reported by
+ * code generation (globally and per procedure).
+ */
+class CompilerStats {
+ public:
+  void startPhase(std::string phase_name);
+  void endPhase(std::string phase_name);
+
+  void addCounter(std::string counter_name, long long int value);
+  void addProcedureCounter(std::string procedure_name, std::string counter_name, long long int value);
+  long long int getCounter(std::string counter_name);
+
+  void printReport(std::ostream &out, bool print_counters);
+  void writeJson(std::string file_name);
+
+ private:
+  typedef struct phase_record {
+    std::string name;
+    std::chrono::steady_clock::time_point start_time;
+    double wall_time_ms = 0;
+    unsigned long long allocations_at_start = 0;
+    unsigned long long allocations = 0;
+    unsigned long long allocated_bytes_at_start = 0;
+    unsigned long long allocated_bytes = 0;
+    long peak_rss_kb = 0;
+    bool finished = false;
+  } PhaseRecord;
+
+  typedef std::vector<std::pair<std::string, long long int>> CounterList;
+
+  std::vector<PhaseRecord> phases_;
+  CounterList counters_;
+  std::vector<std::pair<std::string, CounterList>> procedure_counters_;
+
+  static void addToCounterList(CounterList &counters, std::string counter_name, long long int value);
+  static long peakResidentMemory();
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_COMPILER_STATS_H_
@@ -0,0 +1,151 @@
+#include "constant_arithmetic.h"
+#include <limits>
+#include <map>
+#include "instruction.h"
+
+namespace {
+long long int stepCost(multiplication_step step) {
+  switch(step) {
+    case multiplication_step::GET_VALUE:
+      return instructionCost(instruction_code::GET);
+    case multiplication_step::SHIFT:
+      return instructionCost(instruction_code::SHL);
+    case multiplication_step::ADD_VALUE:
+    case multiplication_step::ADD_SAVED:
+      return instructionCost(instruction_code::ADD);
+    case multiplication_step::SUB_VALUE:
+    case multiplication_step::SUB_SAVED:
+      return instructionCost(instruction_code::SUB);
+    case multiplication_step::SAVE_PRODUCT:
+      return instructionCost(instruction_code::PUT);
+  }
+  return 0;
+}
+
+MultiplicationChain extendedChain(const MultiplicationChain &chain, std::vector<multiplication_step> steps) {
+  MultiplicationChain result = chain;
+  for(auto step : steps) {
+    result.steps.push_back(step);
+    result.cost += stepCost(step);
+  }
+  return result;
+}
+
+void keepCheaper(MultiplicationChain &best, bool &found, MultiplicationChain candidate) {
+  // shorter chain is preferred between chains of equal cost
+  if(!found || candidate.cost < best.cost ||
+      (candidate.cost == best.cost && candidate.steps.size() < best.steps.size())) {
+    best = candidate;
+    found = true;
+  }
+}
+}  // namespace
+
+const MultiplicationChain &multiplicationChain(size_t multiplier, bool with_subtractions) {
+  static std::map<std::pair<size_t, bool>, MultiplicationChain> chains;
+  auto found_chain = chains.find({multiplier, with_subtractions});
+  if(found_chain != chains.end()) {
+    return found_chain->second;
+  }
+  MultiplicationChain best;
+  bool found = false;
+  if(multiplier <= 1) {
+    keepCheaper(best, found, extendedChain(MultiplicationChain(), {multiplication_step::GET_VALUE}));
+  } else if(multiplier % 2 == 0) {
+    keepCheaper(best, found, extendedChain(multiplicationChain(multiplier / 2, with_subtractions),
+                                           {multiplication_step::SHIFT}));
+  } else {
+    keepCheaper(best, found, extendedChain(multiplicationChain(multiplier - 1, with_subtractions),
+                                           {multiplication_step::ADD_VALUE}));
+    if(with_subtractions && multiplier != std::numeric_limits<size_t>::max()) {
+      keepCheaper(best, found, extendedChain(multiplicationChain(multiplier + 1, with_subtractions),
+                                             {multiplication_step::SUB_VALUE}));
+    }
+    for(int k = 1; k < std::numeric_limits<size_t>::digits - 1; k++) {
+      size_t power = size_t(1) << k;
+      std::vector<multiplication_step> shifts(k, multiplication_step::SHIFT);
+      std::vector<std::pair<size_t, multiplication_step>> factors{{power + 1, multiplication_step::ADD_SAVED}};
+      if(with_subtractions) {
+        factors.push_back({power - 1, multiplication_step::SUB_SAVED});
+      }
+      for(auto & factor : factors) {
+        if(factor.first <= 1 || factor.first >= multiplier || multiplier % factor.first != 0) {
+          continue;
+        }
+        std::vector<multiplication_step> steps{multiplication_step::SAVE_PRODUCT};
+        steps.insert(steps.end(), shifts.begin(), shifts.end());
+        steps.push_back(factor.second);
+        keepCheaper(best, found, extendedChain(multiplicationChain(multiplier / factor.first, with_subtractions),
+                                               steps));
+      }
+    }
+  }
+  return chains[{multiplier, with_subtractions}] = best;
+}
+
+bool chainUsesSavedRegister(const MultiplicationChain &chain) {
+  for(auto step : chain.steps) {
+    if(step == multiplication_step::SAVE_PRODUCT) {
+      return true;
+    }
+  }
+  return false;
+}
+
+const ReciprocalDivision &reciprocalDivision(size_t divisor) {
+  static std::map<size_t, ReciprocalDivision> divisions;
+  auto found_division = divisions.find(divisor);
+  if(found_division != divisions.end()) {
+    return found_division->second;
+  }
+  const int word_bits = std::numeric_limits<size_t>::digits;
+  ReciprocalDivision result;
+  while((divisor >> (result.shift + 1)) > 0) {
+    result.shift++;
+  }
+  // bits of fraction by long division, period ends when the first remainder comes back
+  unsigned __int128 first_remainder = (unsigned __int128) 1 << result.shift;
+  unsigned __int128 remainder = first_remainder;
+  int period = 0;
+  std::vector<int> fraction_bits;
+  while(period < word_bits && (period == 0 || remainder != first_remainder)) {
+    period++;
+    remainder <<= 1;
+    if(remainder >= divisor) {
+      remainder -= divisor;
+      fraction_bits.push_back(period);
+    }
+  }
+  result.term_shifts = fraction_bits;
+  if(remainder == first_remainder) {
+    for(int repeat = period; repeat < word_bits; repeat *= 2) {
+      result.repeat_shifts.push_back(repeat);
+    }
+  }
+
+  // GET x, shifts of terms and ADD of every next term, copied by PUT
+  long long int next_terms = result.term_shifts.size() - 1;
+  result.cost = instructionCost(instruction_code::GET) +
+      result.term_shifts.back() * instructionCost(instruction_code::SHR) +
+      next_terms * instructionCost(instruction_code::ADD) +
+      (next_terms > 0 ? instructionCost(instruction_code::PUT) : 0);
+  // all repeats done, sum is copied to temporary register before and after them
+  if(!result.repeat_shifts.empty()) {
+    result.cost += instructionCost(instruction_code::PUT) + instructionCost(instruction_code::GET);
+  }
+  for(int repeat : result.repeat_shifts) {
+    result.cost += repeat * instructionCost(instruction_code::SHR) + instructionCost(instruction_code::JZERO) +
+        instructionCost(instruction_code::ADD) + instructionCost(instruction_code::PUT);
+  }
+  // quotient estimate and remainder x - q * divisor
+  result.cost += result.shift * instructionCost(instruction_code::SHR) + instructionCost(instruction_code::PUT) +
+      multiplicationChain(divisor, false).cost + instructionCost(instruction_code::PUT) +
+      instructionCost(instruction_code::GET) + instructionCost(instruction_code::SUB);
+  // check of remainder done twice, single correction and final GET
+  long long int check_cost = instructionCost(instruction_code::PUT) + instructionCost(instruction_code::INC) +
+      instructionCost(instruction_code::SUB) + instructionCost(instruction_code::JZERO);
+  long long int correction_cost = instructionCost(instruction_code::GET) + instructionCost(instruction_code::SUB) +
+      instructionCost(instruction_code::INC) + instructionCost(instruction_code::JUMP);
+  result.cost += 2 * check_cost + correction_cost + instructionCost(instruction_code::GET);
+  return divisions[divisor] = result;
+}
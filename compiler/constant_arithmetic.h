@@ -0,0 +1,58 @@
+#ifndef CUSTOMCOMPILER_COMPILER_CONSTANT_ARITHMETIC_H_
+#define CUSTOMCOMPILER_COMPILER_CONSTANT_ARITHMETIC_H_
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Step of straight-line multiplication by constant. Multiplied value stays unchanged in its register, product
+ * is built in accumulator and single saved register keeps partial product for multiplying it by 2^k+1 or 2^k-1.
+ */
+enum class multiplication_step {
+  GET_VALUE,
+  SHIFT,
+  ADD_VALUE,
+  SUB_VALUE,
+  SAVE_PRODUCT,
+  ADD_SAVED,
+  SUB_SAVED
+};
+
+typedef struct multiplication_chain {
+  // cost of execution in virtual machine
+  long long int cost = 0;
+  std::vector<multiplication_step> steps;
+} MultiplicationChain;
+
+/**
+ * The cheapest found chain calculating multiplier * x, for multiplier > 0. Chains are searched by recursively
+ * reducing multiplier - halving even one, adding or subtracting x for odd one (which covers canonical signed-digit
+ * form) and dividing it by factors 2^k+1 and 2^k-1. Partial products are multiples of x, so saturating
+ * subtraction never goes below zero for products that do not overflow. Chain without subtractions has all partial
+ * products not greater than the product, so it can not overflow when the product does not.
+ */
+const MultiplicationChain &multiplicationChain(size_t multiplier, bool with_subtractions = true);
+bool chainUsesSavedRegister(const MultiplicationChain &chain);
+
+/**
+ * Division by constant, that is not a power of two, without division loop. Fraction 2^shift / divisor from
+ * range (1/2, 1) is periodic in binary, so x multiplied by it is sum of x shifted right by positions of set bits
+ * of single period, repeated by adding sum shifted right by length of period, then by doubled length etc.
+ * Repeating stops at the first zero shifted sum, so small dividends skip the longest shifts.
+ * Quotient estimate is that product shifted right by shift. Every step rounds down, so estimate is never
+ * greater than quotient, and it is corrected by loop adding 1 while remainder is not less than divisor. Remainder
+ * is dividend minus estimate multiplied by chain without subtractions, which can not overflow.
+ */
+typedef struct reciprocal_division {
+  int shift = 0;
+  // shifts of x added to the first period of product, increasing
+  std::vector<int> term_shifts;
+  // shifts of repeating the period, empty if period is too long and fraction is cut after 64 bits
+  std::vector<int> repeat_shifts;
+  // cost of execution in virtual machine with single correction, without loading operands
+  long long int cost = 0;
+} ReciprocalDivision;
+
+const ReciprocalDivision &reciprocalDivision(size_t divisor);
+
+#endif  // CUSTOMCOMPILER_COMPILER_CONSTANT_ARITHMETIC_H_
@@ -0,0 +1,230 @@
+#include "constant_propagation.h"
+#include "flow_analysis.h"
+
+namespace {
+// values are folded only if they surely fit in machine registers
+const size_t k_max_folded_value = 1ULL << 62;
+
+RValue* createConstant(size_t value) {
+  RValue* constant = new RValue;
+  constant->type = variable_type::R_VAL;
+  constant->value = value;
+  return constant;
+}
+}  // namespace
+
+ConstantPropagation::ConstantPropagation(std::shared_ptr<CompilerStats> stats) : stats_(stats) {
+}
+
+void ConstantPropagation::run(std::shared_ptr<GraphNode> graph) {
+  symbol_table_ = graph->symbol_table;
+  procedure_name_ = graph->proc_name.empty() ? k_main_procedure_name : graph->proc_name;
+  // values of variables are unknown at procedure start - locals keep values from previous calls
+  propagateChain(graph, {}, nullptr);
+}
+
+ConstantPropagation::Constants ConstantPropagation::propagateChain(std::shared_ptr<GraphNode> node,
+                                                                  Constants constants,
+                                                                  std::shared_ptr<GraphNode> stop_node) {
+  while(node && node != stop_node) {
+    for(auto comm : node->commands) {
+      propagateCommand(comm, constants);
+    }
+    if(!node->cond) {
+      node = node->right_node;
+      continue;
+    }
+    condition_node_kind kind = conditionNodeKind(node);
+    Constants condition_constants = constants;
+    if(kind == condition_node_kind::LOOP) {
+      // condition is checked after every iteration, so variables changed in loop are unknown
+      for(auto & name : subgraphWrittenVariables(node->left_node)) {
+        condition_constants.erase(name);
+      }
+    }
+    node->cond->left_var_ = substituteVariable(node->cond->left_var_, condition_constants);
+    node->cond->right_var_ = substituteVariable(node->cond->right_var_, condition_constants);
+    bool condition_result;
+    if(foldCondition(node->cond.get(), condition_result) &&
+        (kind != condition_node_kind::LOOP || !condition_result)) {
+      removeConstantCondition(node, condition_result);
+      stats_->addProcedureCounter(procedure_name_, "branches_folded", 1);
+      node = node->right_node;
+      continue;
+    }
+    if(kind == condition_node_kind::LOOP) {
+      propagateChain(node->left_node, condition_constants, nullptr);
+      constants = condition_constants;
+      node = node->right_node;
+    } else if(kind == condition_node_kind::IF_ELSE) {
+      auto next_node = ifElseNextNode(node);
+      Constants then_constants = propagateChain(node->left_node, constants, nullptr);
+      Constants else_constants = propagateChain(node->right_node, constants, next_node);
+      constants = meet(then_constants, else_constants);
+      node = next_node;
+    } else {
+      Constants then_constants = propagateChain(node->left_node, constants, nullptr);
+      constants = meet(then_constants, constants);
+      node = node->right_node;
+    }
+  }
+  return constants;
+}
+
+void ConstantPropagation::propagateCommand(Command *comm, Constants &constants) {
+  if(comm->type == command_type::ASSIGNMENT) {
+    AssignmentCommand* assignment_command = static_cast<AssignmentCommand*>(comm);
+    DefaultExpression* expression = assignment_command->expression_;
+    expression->var_ = substituteVariable(expression->var_, constants);
+    VariableContainer** right_operand = expressionRightOperand(expression);
+    if(right_operand) {
+      *right_operand = substituteVariable(*right_operand, constants);
+    }
+    size_t result;
+    bool folded = foldExpression(expression, result);
+    if(folded && right_operand) {
+      DefaultExpression* folded_expression = new DefaultExpression;
+      folded_expression->var_ = createConstant(result);
+      assignment_command->expression_ = folded_expression;
+      stats_->addProcedureCounter(procedure_name_, "expressions_folded", 1);
+    }
+    VariableContainer* left_var = assignment_command->left_var_;
+    if(left_var->type == variable_type::VAR && isTrackedVariable(left_var->getVariableName())) {
+      if(folded) {
+        constants[left_var->getVariableName()] = result;
+      } else {
+        constants.erase(left_var->getVariableName());
+      }
+    }
+  } else if(comm->type == command_type::WRITE) {
+    WriteCommand* write_command = static_cast<WriteCommand*>(comm);
+    write_command->written_value_ = substituteVariable(write_command->written_value_, constants);
+  } else {
+    for(auto & name : commandWrittenVariables(comm)) {
+      constants.erase(name);
+    }
+  }
+}
+
+VariableContainer* ConstantPropagation::substituteVariable(VariableContainer *var, Constants &constants) {
+  if(var->type != variable_type::VAR) {
+    return var;
+  }
+  auto constant = constants.find(var->getVariableName());
+  if(constant == constants.end()) {
+    return var;
+  }
+  stats_->addProcedureCounter(procedure_name_, "constants_propagated", 1);
+  return createConstant(constant->second);
+}
+
+bool ConstantPropagation::isTrackedVariable(std::string variable_name) {
+  auto sym = symbol_table_->findSymbol(variable_name);
+  return sym && sym->type == symbol_type::VAR;
+}
+
+bool ConstantPropagation::foldExpression(DefaultExpression *expression, size_t &result) {
+  VariableContainer** right_operand = expressionRightOperand(expression);
+  if(expression->var_->type != variable_type::R_VAL ||
+      (right_operand && (*right_operand)->type != variable_type::R_VAL)) {
+    return false;
+  }
+  size_t left = expression->var_->getValue();
+  if(left >= k_max_folded_value) {
+    return false;
+  }
+  if(!right_operand) {
+    result = left;
+    return true;
+  }
+  size_t right = (*right_operand)->getValue();
+  if(right >= k_max_folded_value) {
+    return false;
+  }
+  if(dynamic_cast<PlusExpression*>(expression)) {
+    result = left + right;
+  } else if(dynamic_cast<MinusExpression*>(expression)) {
+    result = left > right ? left - right : 0;
+  } else if(dynamic_cast<MultiplyExpression*>(expression)) {
+    if(right != 0 && left > k_max_folded_value / right) {
+      return false;
+    }
+    result = left * right;
+  } else if(dynamic_cast<DivideExpression*>(expression)) {
+    if(right == 0) {
+      return false;
+    }
+    result = left / right;
+  } else if(dynamic_cast<ModuloExpression*>(expression)) {
+    if(right == 0) {
+      return false;
+    }
+    result = left % right;
+  } else {
+    return false;
+  }
+  return result < k_max_folded_value;
+}
+
+bool ConstantPropagation::foldCondition(Condition *cond, bool &result) {
+  if(cond->left_var_->type != variable_type::R_VAL || cond->right_var_->type != variable_type::R_VAL) {
+    return false;
+  }
+  size_t left = cond->left_var_->getValue();
+  size_t right = cond->right_var_->getValue();
+  switch(cond->type_) {
+    case condition_type::EQ:
+      result = left == right;
+      break;
+    case condition_type::NEQ:
+      result = left != right;
+      break;
+    case condition_type::GT:
+      result = left > right;
+      break;
+    case condition_type::GE:
+      result = left >= right;
+      break;
+  }
+  return true;
+}
+
+// replaces condition node by plain node continuing with branch that is always taken
+void ConstantPropagation::removeConstantCondition(std::shared_ptr<GraphNode> node, bool condition_result) {
+  condition_node_kind kind = conditionNodeKind(node);
+  auto then_node = node->left_node;
+  node->cond = nullptr;
+  node->left_node = nullptr;
+  if(kind == condition_node_kind::LOOP) {
+    // loop condition is false, body is never executed
+    return;
+  } else if(kind == condition_node_kind::IF_ELSE) {
+    auto next_node = then_node->jump_line_target;
+    if(condition_result) {
+      then_node->jump_line_target = nullptr;
+      chainTail(then_node)->right_node = next_node;
+      node->right_node = then_node;
+    } else {
+      // else branch already continues to next node, registers do not have to be saved before joining branches
+      auto else_tail = node->right_node;
+      while(else_tail->right_node != next_node) {
+        else_tail = else_tail->right_node;
+      }
+      else_tail->should_save_registers_after_code = false;
+    }
+  } else if(condition_result) {
+    chainTail(then_node)->right_node = node->right_node;
+    node->right_node = then_node;
+  }
+}
+
+ConstantPropagation::Constants ConstantPropagation::meet(Constants first, Constants second) {
+  Constants result;
+  for(auto & constant : first) {
+    auto other = second.find(constant.first);
+    if(other != second.end() && other->second == constant.second) {
+      result.insert(constant);
+    }
+  }
+  return result;
+}
@@ -0,0 +1,39 @@
+#ifndef CUSTOMCOMPILER_COMPILER_CONSTANT_PROPAGATION_H_
+#define CUSTOMCOMPILER_COMPILER_CONSTANT_PROPAGATION_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include "code_generator.h"
+#include "compiler_stats.h"
+
+/**
+ * Global constant propagation on structured flow graph of single procedure.
+ * Scalar variables with known values are replaced by constants, expressions with constant operands are
+ * folded and branches of conditions with constant result are removed before code generation.
+ * Procedure arguments are never tracked, because they are references to variables of caller, except arguments
+ * passed by value, which are local variables.
+ */
+class ConstantPropagation {
+ public:
+  explicit ConstantPropagation(std::shared_ptr<CompilerStats> stats);
+  void run(std::shared_ptr<GraphNode> graph);
+
+ private:
+  typedef std::map<std::string, size_t> Constants;
+
+  std::shared_ptr<SymbolTable> symbol_table_;
+  std::shared_ptr<CompilerStats> stats_;
+  std::string procedure_name_;
+
+  Constants propagateChain(std::shared_ptr<GraphNode> node, Constants constants, std::shared_ptr<GraphNode> stop_node);
+  void propagateCommand(Command* comm, Constants &constants);
+  VariableContainer* substituteVariable(VariableContainer* var, Constants &constants);
+  bool isTrackedVariable(std::string variable_name);
+  bool foldExpression(DefaultExpression* expression, size_t &result);
+  bool foldCondition(Condition* cond, bool &result);
+  void removeConstantCondition(std::shared_ptr<GraphNode> node, bool condition_result);
+  static Constants meet(Constants first, Constants second);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_CONSTANT_PROPAGATION_H_
@@ -0,0 +1,226 @@
+#include <iomanip>
+#include "cost_model.h"
+#include "instruction.h"
+#include "profile.h"
+
+namespace {
+std::string procedureName(std::shared_ptr<GraphNode> graph) {
+  return graph->proc_name.empty() ? k_main_procedure_name : graph->proc_name;
+}
+
+void numberNodes(std::shared_ptr<GraphNode> node, std::map<std::shared_ptr<GraphNode>, int> &node_ids) {
+  int id = node_ids.size();
+  node_ids[node] = id;
+  if(node->left_node)
+    numberNodes(node->left_node, node_ids);
+  if(node->right_node)
+    numberNodes(node->right_node, node_ids);
+}
+
+long long int estimateCommandCost(Command* comm, std::map<std::string, long long int> &procedures_costs) {
+  if(comm->type == command_type::ASSIGNMENT) {
+    AssignmentCommand* assignment_command = static_cast<AssignmentCommand*>(comm);
+    return assignment_command->expression_->estimatedCost() + k_estimated_load_cost;
+  } else if(comm->type == command_type::READ) {
+    return 100 + k_estimated_load_cost;
+  } else if(comm->type == command_type::WRITE) {
+    return 100 + estimatedOperandCost(static_cast<WriteCommand*>(comm)->written_value_);
+  } else if(comm->type == command_type::PROC_CALL) {
+    ProcedureCallCommand* procedure_call_command = static_cast<ProcedureCallCommand*>(comm);
+    return k_estimated_call_cost + 2 * k_estimated_load_cost * procedure_call_command->proc_call_.args.size() +
+        procedures_costs[procedure_call_command->proc_call_.name];
+  }
+  return 0;
+}
+}  // namespace
+
+std::string blockName(std::string procedure_name, int block_index) {
+  return procedure_name + ":" + std::to_string(block_index);
+}
+
+CostModel::CostModel(long long int default_trip_count) : default_trip_count_(default_trip_count) {
+}
+
+void CostModel::setTripCountHint(std::string block_name, long long int trip_count) {
+  trip_count_hints_[block_name] = trip_count;
+}
+
+long long int CostModel::tripCount(std::string block_name) {
+  auto hint = trip_count_hints_.find(block_name);
+  return hint == trip_count_hints_.end() ? default_trip_count_ : hint->second;
+}
+
+// loop counted by profile runs its average number of iterations, regardless of hints
+long long int CostModel::loopTripCount(std::shared_ptr<GraphNode> node, std::string block_name) {
+  long long int profiled_trip_count = profiledTripCount(node);
+  return profiled_trip_count >= 0 ? profiled_trip_count : tripCount(block_name);
+}
+
+long long int CostModel::estimateFlowGraphs(FlowGraphs &graphs) {
+  // procedures can only call procedures declared earlier, main program is the last graph
+  std::map<std::string, long long int> procedures_costs;
+  long long int cost = 0;
+  for(auto graph : graphs) {
+    std::map<std::shared_ptr<GraphNode>, int> node_ids;
+    numberNodes(graph, node_ids);
+    cost = estimateNodeCost(graph, procedureName(graph), node_ids, procedures_costs);
+    procedures_costs[graph->proc_name] = cost;
+  }
+  return cost;
+}
+
+long long int CostModel::estimateNodeCost(std::shared_ptr<GraphNode> node,
+                                          std::string procedure_name,
+                                          std::map<std::shared_ptr<GraphNode>, int> &node_ids,
+                                          std::map<std::string, long long int> &procedures_costs) {
+  long long int cost = 0;
+  for(auto comm : node->commands) {
+    cost += estimateCommandCost(comm, procedures_costs);
+  }
+  bool is_loop = isLoopConditionNode(node);
+  long long int trip_count = is_loop ? loopTripCount(node, blockName(procedure_name, node_ids.at(node))) : 1;
+  if(node->cond) {
+    cost += node->cond->estimatedCost() * (is_loop ? trip_count + 1 : 1);
+  }
+  if(node->left_node) {
+    cost += estimateNodeCost(node->left_node, procedure_name, node_ids, procedures_costs) * trip_count;
+  }
+  if(node->right_node) {
+    cost += estimateNodeCost(node->right_node, procedure_name, node_ids, procedures_costs);
+  }
+  return cost;
+}
+
+std::vector<ProcedureCost> CostModel::estimateGeneratedCode(FlowGraphs &graphs) {
+  std::vector<ProcedureCost> costs;
+  // called procedures are recognized by jumps to their first lines
+  std::map<long long int, long long int> procedures_costs;
+  // first line holds jump to main program if there are procedures
+  long long int line = graphs.size() > 1 ? 1 : 0;
+  for(auto graph : graphs) {
+    ProcedureCost procedure_cost;
+    procedure_cost.name = procedureName(graph);
+    long long int first_line = line;
+    std::map<std::shared_ptr<GraphNode>, int> node_ids;
+    numberNodes(graph, node_ids);
+    estimateNodeCode(graph, 1, line, node_ids, procedures_costs, procedure_cost);
+    procedure_cost.instructions = line - first_line;
+    procedures_costs[first_line] = procedure_cost.cost;
+    costs.push_back(procedure_cost);
+  }
+  return costs;
+}
+
+void CostModel::estimateNodeCode(std::shared_ptr<GraphNode> node,
+                                 long long int executions,
+                                 long long int &line,
+                                 std::map<std::shared_ptr<GraphNode>, int> &node_ids,
+                                 std::map<long long int, long long int> &procedures_costs,
+                                 ProcedureCost &procedure_cost) {
+  BlockCost block;
+  block.name = blockName(procedure_cost.name, node_ids.at(node));
+  block.first_line = line;
+  block.executions = executions;
+  bool is_loop = isLoopConditionNode(node);
+  long long int trip_count = is_loop ? loopTripCount(node, block.name) : 1;
+  // condition of loop is checked once more than the loop body runs
+  long long int condition_first_line = is_loop ? node->condition_start_line_ : -1;
+  std::vector<Instruction> code;
+  for(auto & code_line : node->code_list_) {
+    Instruction instr;
+    if(!parseInstruction(code_line, instr)) {
+      instr.code = instruction_code::HALT;
+    }
+    code.push_back(instr);
+  }
+  // backward jumps inside block come from multiplication and division loops
+  std::vector<long long int> line_weights(code.size(), 1);
+  for(int i = 0; i < code.size(); i++) {
+    auto & instr = code.at(i);
+    if(isJumpInstruction(instr.code) && instr.target >= block.first_line && instr.target <= block.first_line + i) {
+      for(long long int j = instr.target - block.first_line; j <= i; j++) {
+        line_weights.at(j) = k_estimated_arithmetic_iterations;
+      }
+    }
+  }
+  for(int i = 0; i < code.size(); i++) {
+    auto & instr = code.at(i);
+    long long int line_executions = executions * line_weights.at(i);
+    if(condition_first_line != -1 && block.first_line + i >= condition_first_line) {
+      line_executions *= trip_count + 1;
+    }
+    block.cost += instructionCost(instr.code) * line_executions;
+    if(instr.code == instruction_code::JUMP && procedures_costs.count(instr.target) != 0) {
+      block.cost += procedures_costs.at(instr.target) * line_executions;
+    }
+  }
+  line += code.size();
+  block.length = code.size();
+  int block_index = procedure_cost.blocks.size();
+  procedure_cost.blocks.push_back(block);
+  if(node->left_node) {
+    estimateNodeCode(node->left_node, executions * trip_count, line, node_ids, procedures_costs, procedure_cost);
+  }
+  if(node->right_node) {
+    estimateNodeCode(node->right_node, executions, line, node_ids, procedures_costs, procedure_cost);
+  }
+  // jump closing loop body or then branch is the last instruction of block output
+  if(node->jump_line_target || node->jump_condition_target) {
+    procedure_cost.blocks.at(block_index).cost += executions;
+    line++;
+  }
+  procedure_cost.cost += procedure_cost.blocks.at(block_index).cost;
+}
+
+void CostModel::printReport(std::ostream &out, std::vector<ProcedureCost> costs) {
+  out << "===== Estimated cost =====" << std::endl;
+  out << std::left << std::setw(24) << "procedure" << std::right
+      << std::setw(14) << "instructions"
+      << std::setw(18) << "cost per call" << std::endl;
+  for(auto & procedure_cost : costs) {
+    out << std::left << std::setw(24) << procedure_cost.name << std::right
+        << std::setw(14) << procedure_cost.instructions
+        << std::setw(18) << procedure_cost.cost << std::endl;
+  }
+  for(auto & procedure_cost : costs) {
+    out << "----- blocks of " << procedure_cost.name << " -----" << std::endl;
+    out << std::left << std::setw(24) << "  block" << std::right
+        << std::setw(16) << "lines"
+        << std::setw(14) << "executions"
+        << std::setw(18) << "cost" << std::endl;
+    for(auto & block : procedure_cost.blocks) {
+      if(block.length == 0) {
+        continue;
+      }
+      std::string lines = std::to_string(block.first_line) + "-" + std::to_string(block.first_line + block.length - 1);
+      out << std::left << std::setw(24) << "  " + block.name << std::right
+          << std::setw(16) << lines
+          << std::setw(14) << block.executions
+          << std::setw(18) << block.cost << std::endl;
+    }
+  }
+}
+
+long long int CostModel::sequenceCost(std::vector<std::string> code) {
+  long long int cost = 0;
+  for(auto & code_line : code) {
+    Instruction instr;
+    if(parseInstruction(code_line, instr)) {
+      cost += instructionCost(instr.code);
+    }
+  }
+  return cost;
+}
+
+int CostModel::cheapestSequence(std::vector<std::vector<std::string>> candidates) {
+  int cheapest = -1;
+  long long int cheapest_cost = 0;
+  for(int i = 0; i < candidates.size(); i++) {
+    long long int cost = sequenceCost(candidates.at(i));
+    if(cheapest == -1 || cost < cheapest_cost) {
+      cheapest = i;
+      cheapest_cost = cost;
+    }
+  }
+  return cheapest;
+}
@@ -0,0 +1,74 @@
+#ifndef CUSTOMCOMPILER_COMPILER_COST_MODEL_H_
+#define CUSTOMCOMPILER_COMPILER_COST_MODEL_H_
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "code_generator.h"
+#include "flow_analysis.h"
+
+// number of iterations assumed for loops without trip count hint
+const long long int k_default_trip_count = 10;
+// cost of jumps and return address handling of procedure call, without passing arguments
+const long long int k_estimated_call_cost = 10;
+
+typedef struct block_cost {
+  std::string name;
+  long long int first_line = 0;
+  long long int length = 0;
+  long long int executions = 0;
+  // cost of all executions of block, including called procedures
+  long long int cost = 0;
+} BlockCost;
+
+typedef struct procedure_cost {
+  std::string name;
+  long long int instructions = 0;
+  // cost of single execution of procedure
+  long long int cost = 0;
+  std::vector<BlockCost> blocks;
+} ProcedureCost;
+
+/**
+ * Static estimate of virtual machine cost. Blocks are flow graph nodes named "<procedure>:<preorder index>",
+ * every loop runs trip count times - counted by profile, hinted for its condition block or default one.
+ */
+class CostModel {
+ public:
+  explicit CostModel(long long int default_trip_count = k_default_trip_count);
+  void setTripCountHint(std::string block_name, long long int trip_count);
+  long long int tripCount(std::string block_name);
+
+  // estimate based on commands of flow graphs, before code generation
+  long long int estimateFlowGraphs(FlowGraphs &graphs);
+  // estimate based on generated code, graphs are in output order with main program last
+  std::vector<ProcedureCost> estimateGeneratedCode(FlowGraphs &graphs);
+  void printReport(std::ostream &out, std::vector<ProcedureCost> costs);
+
+  // cost of executing code sequence once, for choosing between candidate sequences
+  static long long int sequenceCost(std::vector<std::string> code);
+  // index of the cheapest of candidate sequences
+  static int cheapestSequence(std::vector<std::vector<std::string>> candidates);
+
+ private:
+  long long int default_trip_count_;
+  std::map<std::string, long long int> trip_count_hints_;
+
+  long long int loopTripCount(std::shared_ptr<GraphNode> node, std::string block_name);
+  long long int estimateNodeCost(std::shared_ptr<GraphNode> node,
+                                 std::string procedure_name,
+                                 std::map<std::shared_ptr<GraphNode>, int> &node_ids,
+                                 std::map<std::string, long long int> &procedures_costs);
+  void estimateNodeCode(std::shared_ptr<GraphNode> node,
+                        long long int executions,
+                        long long int &line,
+                        std::map<std::shared_ptr<GraphNode>, int> &node_ids,
+                        std::map<long long int, long long int> &procedures_costs,
+                        ProcedureCost &procedure_cost);
+};
+
+std::string blockName(std::string procedure_name, int block_index);
+
+#endif  // CUSTOMCOMPILER_COMPILER_COST_MODEL_H_
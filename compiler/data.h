@@ -1,8 +1,10 @@
 #ifndef CUSTOMCOMPILER_COMPILER_DATA_H_
 #define CUSTOMCOMPILER_COMPILER_DATA_H_
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include "constant_arithmetic.h"
 #include "symbol.h"
 #include "symbol_table.h"
 
@@ -95,6 +97,25 @@ enum class expression_type {
   MODULO
 };
 
+// estimated cost of loading variable - generating its address and LOAD
+const long long int k_estimated_load_cost = 60;
+// estimated number of iterations of multiplication and division loops
+const long long int k_estimated_arithmetic_iterations = 16;
+
+// estimated cost of getting value of variable or constant into register
+inline long long int estimatedOperandCost(VariableContainer* var) {
+  if(var->type == variable_type::R_VAL) {
+    long long int cost = 1;
+    for(size_t val = var->getValue(); val > 0; val >>= 1) {
+      cost += (val & 1) + 1;
+    }
+    return cost;
+  } else if(var->type == variable_type::VARIABLE_INDEXED_ARR) {
+    return 2 * k_estimated_load_cost + 5;
+  }
+  return k_estimated_load_cost;
+}
+
 /**
  * x := var_  (x - left side variable)
  *
@@ -106,6 +127,16 @@ enum class expression_type {
 class DefaultExpression {
  public:
   VariableContainer* var_;
+  // shortcuts for constant operands, enabled by optimization passes; generic code is used otherwise
+  bool increment_shortcut_enabled_ = false;
+  bool shift_shortcut_enabled_ = false;
+  bool multiplication_chain_enabled_ = false;
+  bool reciprocal_division_enabled_ = false;
+  // quotient and remainder of the same operands calculated by consecutive commands: first expression keeps
+  // the other result in register as kept_result_, second one takes it from there if the register still holds it
+  Variable* kept_result_ = nullptr;
+  bool keeps_result_ = false;
+
   virtual std::vector<std::pair<VariableContainer*, bool>> neededVariablesInRegisters() {
     return {};
   }
@@ -132,6 +163,15 @@ class DefaultExpression {
     return registers.at(0);
   }
 
+  virtual std::string stringify() {
+    return var_->stringify();
+  }
+
+  // static estimate of expression cost in virtual machine, used to compare optimization results
+  virtual long long int estimatedCost() {
+    return estimatedOperandCost(var_);
+  }
+
   bool isPowerOfTwo(size_t val) {
     int counter = 0;
     while(val > 0) {
@@ -180,10 +220,10 @@ class PlusExpression : public DefaultExpression {
  public:
   VariableContainer* right_var_;
   std::vector<std::pair<VariableContainer*, bool>> neededVariablesInRegisters() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
+    if(increment_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
     numberGenerationCost(right_var_->getValue()) + 5 > right_var_->getValue()) {
       return {{var_, true}};
-    } else if(var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL &&
+    } else if(increment_shortcut_enabled_ && var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL &&
     numberGenerationCost(var_->getValue()) + 5 > var_->getValue()) {
       return {{right_var_, true}};
     }
@@ -191,10 +231,10 @@ class PlusExpression : public DefaultExpression {
   }
 
   VariableContainer * variableNeededInAccumulator() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
+    if(increment_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
         numberGenerationCost(right_var_->getValue()) + 5 > right_var_->getValue()) {
       return nullptr;
-    } else if(var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL &&
+    } else if(increment_shortcut_enabled_ && var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL &&
         numberGenerationCost(var_->getValue()) + 5 > var_->getValue()) {
       return nullptr;
     }
@@ -202,10 +242,10 @@ class PlusExpression : public DefaultExpression {
   }
 
   bool accumulatorNeededForExpression() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
+    if(increment_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
         numberGenerationCost(right_var_->getValue()) + 5 > right_var_->getValue()) {
       return false;
-    } else if(var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL &&
+    } else if(increment_shortcut_enabled_ && var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL &&
         numberGenerationCost(var_->getValue()) + 5 > var_->getValue()) {
       return false;
     }
@@ -214,7 +254,7 @@ class PlusExpression : public DefaultExpression {
 
   std::vector<std::string> calculateExpression(std::vector<std::shared_ptr<Register>> regs,
                                                long long int expression_first_line_number) override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
+    if(increment_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
     numberGenerationCost(right_var_->getValue()) + 5 > right_var_->getValue()) {
       std::shared_ptr<Register> acc = regs.at(0);
       std::vector<std::string> commands;
@@ -225,7 +265,7 @@ class PlusExpression : public DefaultExpression {
           commands.push_back("INC " + acc->register_name_);
       }
       return commands;
-    } else if(var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL &&
+    } else if(increment_shortcut_enabled_ && var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL &&
     numberGenerationCost(var_->getValue()) + 5 > var_->getValue()) {
       std::shared_ptr<Register> acc = regs.at(0);
       std::vector<std::string> commands;
@@ -246,15 +286,30 @@ class PlusExpression : public DefaultExpression {
   }
 
   std::shared_ptr<Register> updateRegistersState(std::vector<std::shared_ptr<Register>> registers) override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
+    if(increment_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
         numberGenerationCost(right_var_->getValue()) + 5 > right_var_->getValue()) {
       return registers.at(0);
-    } else if(var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL &&
+    } else if(increment_shortcut_enabled_ && var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL &&
         numberGenerationCost(var_->getValue()) + 5 > var_->getValue()) {
       return registers.at(0);
     }
     return registers.at(1);
   }
+
+  std::string stringify() override {
+    return var_->stringify() + " + " + right_var_->stringify();
+  }
+
+  long long int estimatedCost() override {
+    if(increment_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
+        numberGenerationCost(right_var_->getValue()) + 5 > right_var_->getValue()) {
+      return estimatedOperandCost(var_) + right_var_->getValue();
+    } else if(increment_shortcut_enabled_ && var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL &&
+        numberGenerationCost(var_->getValue()) + 5 > var_->getValue()) {
+      return estimatedOperandCost(right_var_) + var_->getValue();
+    }
+    return estimatedOperandCost(var_) + estimatedOperandCost(right_var_) + 5;
+  }
  private:
   expression_type type = expression_type::PLUS;
 };
@@ -272,7 +327,7 @@ class MinusExpression : public DefaultExpression {
  public:
   VariableContainer* right_var_;
   std::vector<std::pair<VariableContainer*, bool>> neededVariablesInRegisters() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
+    if(increment_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
     numberGenerationCost(right_var_->getValue()) + 5 > right_var_->getValue()) {
       return {{var_, true}};
     }
@@ -280,7 +335,7 @@ class MinusExpression : public DefaultExpression {
   }
 
   VariableContainer * variableNeededInAccumulator() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
+    if(increment_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
         numberGenerationCost(right_var_->getValue()) + 5 > right_var_->getValue()) {
       return nullptr;
     }
@@ -288,7 +343,7 @@ class MinusExpression : public DefaultExpression {
   }
 
   bool accumulatorNeededForExpression() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
+    if(increment_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
         numberGenerationCost(right_var_->getValue()) + 5 > right_var_->getValue()) {
       return false;
     }
@@ -297,7 +352,7 @@ class MinusExpression : public DefaultExpression {
 
   std::vector<std::string> calculateExpression(std::vector<std::shared_ptr<Register>> regs,
                                                long long int expression_first_line_number) override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
+    if(increment_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
         numberGenerationCost(right_var_->getValue()) + 5 > right_var_->getValue()) {
       std::shared_ptr<Register> acc = regs.at(0);
       std::vector<std::string> commands;
@@ -318,16 +373,66 @@ class MinusExpression : public DefaultExpression {
   }
 
   std::shared_ptr<Register> updateRegistersState(std::vector<std::shared_ptr<Register>> registers) override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
+    if(increment_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
         numberGenerationCost(right_var_->getValue()) + 5 > right_var_->getValue()) {
       return registers.at(0);
     }
     return registers.at(1);
   }
+
+  std::string stringify() override {
+    return var_->stringify() + " - " + right_var_->stringify();
+  }
+
+  long long int estimatedCost() override {
+    if(increment_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL &&
+        numberGenerationCost(right_var_->getValue()) + 5 > right_var_->getValue()) {
+      return estimatedOperandCost(var_) + right_var_->getValue();
+    }
+    return estimatedOperandCost(var_) + estimatedOperandCost(right_var_) + 5;
+  }
  private:
   expression_type type = expression_type::MINUS;
 };
 
+/**
+ * Straight-line multiplication by constant. Multiplied value stays in its register, product is built in accumulator,
+ * saved register is needed only if chain uses it.
+ */
+inline std::vector<std::string> multiplicationChainCode(std::shared_ptr<Register> value_reg,
+                                                        std::shared_ptr<Register> saved_reg,
+                                                        size_t multiplier,
+                                                        std::string comment,
+                                                        bool with_subtractions = true) {
+  std::vector<std::string> commands;
+  for(auto step : multiplicationChain(multiplier, with_subtractions).steps) {
+    switch(step) {
+      case multiplication_step::GET_VALUE:
+        commands.push_back("GET " + value_reg->register_name_ + " # " + comment);
+        break;
+      case multiplication_step::SHIFT:
+        commands.push_back("SHL a");
+        break;
+      case multiplication_step::ADD_VALUE:
+        commands.push_back("ADD " + value_reg->register_name_);
+        break;
+      case multiplication_step::SUB_VALUE:
+        commands.push_back("SUB " + value_reg->register_name_);
+        break;
+      case multiplication_step::SAVE_PRODUCT:
+        commands.push_back("PUT " + saved_reg->register_name_);
+        break;
+      case multiplication_step::ADD_SAVED:
+        commands.push_back("ADD " + saved_reg->register_name_);
+        break;
+      case multiplication_step::SUB_SAVED:
+        commands.push_back("SUB " + saved_reg->register_name_);
+        break;
+    }
+  }
+  return commands;
+}
+
 /**
  * x := var_ * right_var_
  *
@@ -375,13 +480,16 @@ class MultiplyExpression : public DefaultExpression {
  public:
   VariableContainer* right_var_;
   std::vector<std::pair<VariableContainer*, bool>> neededVariablesInRegisters() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesMultiplicationChain()) {
+      return {{chainOperand(), false}};
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 0) {
         return {};
       } else if(isPowerOfTwo(right_var_->getValue())) {
         return {{var_, true}};
       }
-    } else if(var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL) {
+    } else if(shift_shortcut_enabled_ && var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL) {
       if(var_->getValue() == 0) {
         return {};
       } else if(isPowerOfTwo(var_->getValue())) {
@@ -392,13 +500,16 @@ class MultiplyExpression : public DefaultExpression {
   }
 
   VariableContainer * variableNeededInAccumulator() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesMultiplicationChain()) {
+      return nullptr;
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 0) {
         return nullptr;
       } else if(isPowerOfTwo(right_var_->getValue())) {
         return nullptr;
       }
-    } else if(var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL) {
+    } else if(shift_shortcut_enabled_ && var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL) {
       if(var_->getValue() == 0) {
         return nullptr;
       } else if(isPowerOfTwo(var_->getValue())) {
@@ -409,13 +520,13 @@ class MultiplyExpression : public DefaultExpression {
   }
 
   bool accumulatorNeededForExpression() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 0) {
         return true;
       } else if(isPowerOfTwo(right_var_->getValue())) {
         return false;
       }
-    } else if(var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL) {
+    } else if(shift_shortcut_enabled_ && var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL) {
       if(var_->getValue() == 0) {
         return true;
       } else if(isPowerOfTwo(var_->getValue())) {
@@ -427,7 +538,11 @@ class MultiplyExpression : public DefaultExpression {
 
   std::vector<std::string> calculateExpression(std::vector<std::shared_ptr<Register>> regs,
                                                long long int expression_first_line_number) override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesMultiplicationChain()) {
+      std::shared_ptr<Register> saved_reg = regs.size() > 1 ? regs.at(1) : nullptr;
+      return multiplicationChainCode(regs.at(0), saved_reg, chainMultiplier(), stringify());
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 0) {
         return {"RST a"};
       } else if(isPowerOfTwo(right_var_->getValue())) {
@@ -439,7 +554,7 @@ class MultiplyExpression : public DefaultExpression {
         }
         return commands;
       }
-    } else if(var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL) {
+    } else if(shift_shortcut_enabled_ && var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL) {
       if(var_->getValue() == 0) {
         return {"RST a"};
       } else if(isPowerOfTwo(var_->getValue())) {
@@ -492,13 +607,16 @@ class MultiplyExpression : public DefaultExpression {
   }
 
   int neededEmptyRegs() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesMultiplicationChain()) {
+      return chainUsesSavedRegister(multiplicationChain(chainMultiplier())) ? 1 : 0;
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 0) {
         return 0;
       } else if(isPowerOfTwo(right_var_->getValue())) {
         return 0;
       }
-    } else if(var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL) {
+    } else if(shift_shortcut_enabled_ && var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL) {
       if(var_->getValue() == 0) {
         return 0;
       } else if(isPowerOfTwo(var_->getValue())) {
@@ -509,13 +627,20 @@ class MultiplyExpression : public DefaultExpression {
   }
 
   std::shared_ptr<Register> updateRegistersState(std::vector<std::shared_ptr<Register>> registers) override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesMultiplicationChain()) {
+      if(registers.size() > 1) {
+        registers.at(1)->curr_variable = nullptr;
+        registers.at(1)->variable_saved_ = true;
+      }
+      return nullptr;
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 0) {
         return nullptr;
       } else if(isPowerOfTwo(right_var_->getValue())) {
         return registers.at(0);
       }
-    } else if(var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL) {
+    } else if(shift_shortcut_enabled_ && var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL) {
       if(var_->getValue() == 0) {
         return nullptr;
       } else if(isPowerOfTwo(var_->getValue())) {
@@ -536,13 +661,185 @@ class MultiplyExpression : public DefaultExpression {
     result_reg->variable_saved_ = true;
     return registers.at(1);
   }
+
+  std::string stringify() override {
+    return var_->stringify() + " * " + right_var_->stringify();
+  }
+
+  long long int estimatedCost() override {
+    if(usesMultiplicationChain()) {
+      return estimatedOperandCost(chainOperand()) + multiplicationChain(chainMultiplier()).cost;
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+      if(right_var_->getValue() == 0) {
+        return 1;
+      } else if(isPowerOfTwo(right_var_->getValue())) {
+        return estimatedOperandCost(var_) + msbIndex(right_var_->getValue()) - 1;
+      }
+    } else if(shift_shortcut_enabled_ && var_->type == variable_type::R_VAL && right_var_->type != variable_type::R_VAL) {
+      if(var_->getValue() == 0) {
+        return 1;
+      } else if(isPowerOfTwo(var_->getValue())) {
+        return estimatedOperandCost(right_var_) + msbIndex(var_->getValue()) - 1;
+      }
+    }
+    return estimatedOperandCost(var_) + estimatedOperandCost(right_var_) + 25 + 18 * k_estimated_arithmetic_iterations;
+  }
  private:
   expression_type type = expression_type::MULTIPLY;
+
+  bool isShiftShortcut(size_t multiplier) {
+    return shift_shortcut_enabled_ && (multiplier == 0 || isPowerOfTwo(multiplier));
+  }
+
+  // multiplication by constant, that is calculated with straight-line chain cheaper than generic loop
+  bool usesMultiplicationChain() {
+    if(!multiplication_chain_enabled_ ||
+        (var_->type == variable_type::R_VAL) == (right_var_->type == variable_type::R_VAL)) {
+      return false;
+    }
+    size_t multiplier = chainMultiplier();
+    if(multiplier == 0 || isShiftShortcut(multiplier)) {
+      return false;
+    }
+    // generic loop iterates over bits of smaller operand
+    long long int loop_cost = estimatedOperandCost(var_->type == variable_type::R_VAL ? var_ : right_var_) + 25 +
+        18 * std::min(k_estimated_arithmetic_iterations, (long long int) msbIndex(multiplier));
+    return multiplicationChain(multiplier).cost < loop_cost;
+  }
+
+  VariableContainer* chainOperand() {
+    return var_->type == variable_type::R_VAL ? right_var_ : var_;
+  }
+
+  size_t chainMultiplier() {
+    return var_->type == variable_type::R_VAL ? var_->getValue() : right_var_->getValue();
+  }
 };
 
+/**
+ * Shift-subtract division loop shared by division and modulo. Quotient is left in result register and remainder
+ * in register of dividend, both jumps to the end of division target the line after the loop.
+ */
+inline std::vector<std::string> divisionLoopCode(std::shared_ptr<Register> var_reg,
+                                                 std::shared_ptr<Register> acc_reg,
+                                                 std::shared_ptr<Register> right_var_reg,
+                                                 std::shared_ptr<Register> iterator_reg,
+                                                 std::shared_ptr<Register> result_reg,
+                                                 long long int expression_first_line_number,
+                                                 std::string comment) {
+  return {
+      "PUT " + right_var_reg->register_name_ + " # " + comment,
+      "RST " + result_reg->register_name_,
+      "GET " + var_reg->register_name_,
+      "INC " + acc_reg->register_name_,
+      "SUB " + right_var_reg->register_name_,
+      "JZERO " + std::to_string(expression_first_line_number + 30),
+      "GET " + right_var_reg->register_name_,
+      "JZERO " + std::to_string(expression_first_line_number + 30),
+      "RST " + iterator_reg->register_name_,
+      "INC " + iterator_reg->register_name_,
+      "SHL " + right_var_reg->register_name_,
+      "SHL " + iterator_reg->register_name_,
+      "GET " + right_var_reg->register_name_,
+      "SUB " + var_reg->register_name_,
+      "JZERO " + std::to_string(expression_first_line_number + 10),
+      "SHR " + right_var_reg->register_name_,
+      "SHR " + iterator_reg->register_name_,
+      "GET " + iterator_reg->register_name_,
+      "JZERO " + std::to_string(expression_first_line_number + 30),
+      "GET " + var_reg->register_name_,
+      "INC " + acc_reg->register_name_,
+      "SUB " + right_var_reg->register_name_,
+      "JZERO " + std::to_string(expression_first_line_number + 15),
+      "GET " + var_reg->register_name_,
+      "SUB " + right_var_reg->register_name_,
+      "PUT " + var_reg->register_name_,
+      "GET " + result_reg->register_name_,
+      "ADD " + iterator_reg->register_name_,
+      "PUT " + result_reg->register_name_,
+      "JUMP " + std::to_string(expression_first_line_number + 15)
+  };
+}
+
+/**
+ * Division by constant divisor, that is not a power of two, with estimate of quotient from reciprocal of divisor
+ * (see reciprocalDivision). Dividend and divisor registers are not changed, quotient is left in quotient register
+ * and remainder in temporary register.
+ */
+inline std::vector<std::string> reciprocalDivisionCode(std::shared_ptr<Register> var_reg,
+                                                       std::shared_ptr<Register> divisor_reg,
+                                                       std::shared_ptr<Register> temp_reg,
+                                                       std::shared_ptr<Register> quotient_reg,
+                                                       size_t divisor,
+                                                       long long int expression_first_line_number,
+                                                       std::string comment) {
+  const ReciprocalDivision &division = reciprocalDivision(divisor);
+  std::vector<std::string> commands{"GET " + var_reg->register_name_ + " # " + comment};
+  int shifted = 0;
+  for(int term_shift : division.term_shifts) {
+    if(shifted == 0) {
+      for(; shifted < term_shift; shifted++) {
+        commands.push_back("SHR a");
+      }
+      if(division.term_shifts.size() > 1) {
+        commands.push_back("PUT " + temp_reg->register_name_);
+      }
+      continue;
+    }
+    for(; shifted < term_shift; shifted++) {
+      commands.push_back("SHR " + temp_reg->register_name_);
+    }
+    commands.push_back("ADD " + temp_reg->register_name_);
+  }
+  if(!division.repeat_shifts.empty()) {
+    // sum is kept in temporary register, once sum shifted right is 0 all next repeats add 0
+    long long int repeats_end_line = expression_first_line_number + commands.size() + 1;
+    for(int repeat_shift : division.repeat_shifts) {
+      repeats_end_line += repeat_shift + 3;
+    }
+    commands.push_back("PUT " + temp_reg->register_name_);
+    for(int repeat_shift : division.repeat_shifts) {
+      for(int i = 0; i < repeat_shift; i++) {
+        commands.push_back("SHR a");
+      }
+      commands.push_back("JZERO " + std::to_string(repeats_end_line));
+      commands.push_back("ADD " + temp_reg->register_name_);
+      commands.push_back("PUT " + temp_reg->register_name_);
+    }
+    commands.push_back("GET " + temp_reg->register_name_);
+  }
+  for(int i = 0; i < division.shift; i++) {
+    commands.push_back("SHR a");
+  }
+  commands.push_back("PUT " + quotient_reg->register_name_);
+  // remainder x - q * divisor, quotient is already in accumulator
+  std::vector<std::string> product = multiplicationChainCode(quotient_reg, temp_reg, divisor, comment, false);
+  commands.insert(commands.end(), product.begin() + 1, product.end());
+  commands.push_back("PUT " + temp_reg->register_name_);
+  commands.push_back("GET " + var_reg->register_name_);
+  commands.push_back("SUB " + temp_reg->register_name_);
+  // while remainder >= divisor
+  long long int check_line = expression_first_line_number + commands.size();
+  std::vector<std::string> correction{
+      "PUT " + temp_reg->register_name_,
+      "INC a",
+      "SUB " + divisor_reg->register_name_,
+      "JZERO " + std::to_string(check_line + 8),
+      "GET " + temp_reg->register_name_,
+      "SUB " + divisor_reg->register_name_,
+      "INC " + quotient_reg->register_name_,
+      "JUMP " + std::to_string(check_line)
+  };
+  commands.insert(commands.end(), correction.begin(), correction.end());
+  return commands;
+}
+
 /**
  * x := var_ / right_var_
  *
+ * division by constant, that is not a power of two, uses reciprocal of divisor when it is cheaper than the loop
+ *
  * var in reg_b
  * right_var in reg_a
  * reg_c for right_var
@@ -559,12 +856,11 @@ class MultiplyExpression : public DefaultExpression {
  * JZERO end_of_division
  * RST reg_f
  * INC reg_f
- * GET reg_b
- * SHR reg_a  # last_set_bit_pos
- * SHL reg_c
- * SHL reg_f
- * JPOS last_set_bit_pos
+ * SHL reg_c  # shift_divisor - until right_var is greater than var, so shifted value fits in register
  * SHL reg_f
+ * GET reg_c
+ * SUB reg_b
+ * JZERO shift_divisor
  * SHR reg_c  # main_loop
  * SHR reg_f
  * GET reg_f
@@ -582,13 +878,16 @@ class MultiplyExpression : public DefaultExpression {
  * JUMP main_loop
  * GET reg_d  # end_of_division
  *
- * x is in reg a
+ * x is in reg a, remainder is in reg_b
  */
 class DivideExpression : public DefaultExpression {
  public:
   VariableContainer* right_var_;
   std::vector<std::pair<VariableContainer*, bool>> neededVariablesInRegisters() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesReciprocalDivision()) {
+      return {{var_, false}, {right_var_, false}};
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 0) {
         return {};
       } else if(isPowerOfTwo(right_var_->getValue())) {
@@ -599,7 +898,10 @@ class DivideExpression : public DefaultExpression {
   }
 
   VariableContainer * variableNeededInAccumulator() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesReciprocalDivision()) {
+      return nullptr;
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 0) {
         return nullptr;
       } else if(isPowerOfTwo(right_var_->getValue())) {
@@ -610,7 +912,7 @@ class DivideExpression : public DefaultExpression {
   }
 
   bool accumulatorNeededForExpression() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 0) {
         return true;
       } else if(isPowerOfTwo(right_var_->getValue())) {
@@ -622,7 +924,14 @@ class DivideExpression : public DefaultExpression {
 
   std::vector<std::string> calculateExpression(std::vector<std::shared_ptr<Register>> regs,
                                                long long expression_first_line_number) override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesReciprocalDivision()) {
+      std::vector<std::string> result_code = reciprocalDivisionCode(regs.at(0), regs.at(1), regs.at(2), regs.at(3),
+                                                                    right_var_->getValue(),
+                                                                    expression_first_line_number, stringify());
+      result_code.push_back("GET " + regs.at(3)->register_name_);
+      return result_code;
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 0) {  // TODO(Jakub Drzewiecki): Division by 0 should not be possible.
         return {"RST a"};
       } else if(isPowerOfTwo(right_var_->getValue())) {
@@ -640,44 +949,17 @@ class DivideExpression : public DefaultExpression {
     std::shared_ptr<Register> right_var_reg = regs.at(2);
     std::shared_ptr<Register> iterator_reg = regs.at(3);
     std::shared_ptr<Register> result_reg = regs.at(4);
-    std::vector<std::string> result_code {
-      "PUT " + right_var_reg->register_name_ + " # " + var_->stringify() + " / " + right_var_->stringify(),
-      "RST " + result_reg->register_name_,
-      "GET " + var_reg->register_name_,
-      "INC " + acc_reg->register_name_,
-      "SUB " + right_var_reg->register_name_,
-      "JZERO " + std::to_string(expression_first_line_number + 30),
-      "GET " + right_var_reg->register_name_,
-      "JZERO " + std::to_string(expression_first_line_number + 30),
-      "RST " + iterator_reg->register_name_,
-      "INC " + iterator_reg->register_name_,
-      "GET " + var_reg->register_name_,
-      "SHR " + acc_reg->register_name_,
-      "SHL " + right_var_reg->register_name_,
-      "SHL " + iterator_reg->register_name_,
-      "JPOS " + std::to_string(expression_first_line_number + 11),
-      "SHR " + right_var_reg->register_name_,
-      "SHR " + iterator_reg->register_name_,
-      "GET " + iterator_reg->register_name_,
-      "JZERO " + std::to_string(expression_first_line_number + 30),
-      "GET " + var_reg->register_name_,
-      "INC " + acc_reg->register_name_,
-      "SUB " + right_var_reg->register_name_,
-      "JZERO " + std::to_string(expression_first_line_number + 15),
-      "GET " + var_reg->register_name_,
-      "SUB " + right_var_reg->register_name_,
-      "PUT " + var_reg->register_name_,
-      "GET " + result_reg->register_name_,
-      "ADD " + iterator_reg->register_name_,
-      "PUT " + result_reg->register_name_,
-      "JUMP " + std::to_string(expression_first_line_number + 15),
-      "GET " + result_reg->register_name_
-    };
+    std::vector<std::string> result_code = divisionLoopCode(var_reg, acc_reg, right_var_reg, iterator_reg, result_reg,
+                                                            expression_first_line_number, stringify());
+    result_code.push_back("GET " + result_reg->register_name_);
     return result_code;
   }
 
   int neededEmptyRegs() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesReciprocalDivision()) {
+      return 2;
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 0) {
         return 0;
       } else if(isPowerOfTwo(right_var_->getValue())) {
@@ -688,7 +970,15 @@ class DivideExpression : public DefaultExpression {
   }
 
   std::shared_ptr<Register> updateRegistersState(std::vector<std::shared_ptr<Register>> registers) override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesReciprocalDivision()) {
+      // remainder is left in temporary register
+      registers.at(2)->curr_variable = keeps_result_ ? kept_result_ : nullptr;
+      registers.at(2)->variable_saved_ = true;
+      registers.at(3)->curr_variable = nullptr;
+      registers.at(3)->variable_saved_ = true;
+      return nullptr;
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 0) {
         return nullptr;
       } else if(isPowerOfTwo(right_var_->getValue())) {
@@ -703,20 +993,57 @@ class DivideExpression : public DefaultExpression {
     right_var_reg->variable_saved_ = true;
     iterator_reg->curr_variable = nullptr;
     iterator_reg->variable_saved_ = true;
-    var_reg->curr_variable = nullptr;
+    // remainder is left in register of dividend
+    var_reg->curr_variable = keeps_result_ ? kept_result_ : nullptr;
     var_reg->variable_saved_ = true;
     result_reg->curr_variable = nullptr;
     result_reg->variable_saved_ = true;
     return registers.at(1);
   }
+
+  std::string stringify() override {
+    return var_->stringify() + " / " + right_var_->stringify();
+  }
+
+  long long int estimatedCost() override {
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+      if(right_var_->getValue() == 0) {
+        return 1;
+      } else if(isPowerOfTwo(right_var_->getValue())) {
+        return estimatedOperandCost(var_) + msbIndex(right_var_->getValue()) - 1;
+      }
+    }
+    if(kept_result_ && !keeps_result_) {
+      return 1;
+    }
+    if(usesReciprocalDivision()) {
+      return estimatedOperandCost(var_) + estimatedOperandCost(right_var_) +
+          reciprocalDivision(right_var_->getValue()).cost;
+    }
+    return estimatedOperandCost(var_) + estimatedOperandCost(right_var_) + 30 + 36 * k_estimated_arithmetic_iterations;
+  }
  private:
   expression_type type = expression_type::DIVIDE;
+
+  // division by constant, that is calculated from its reciprocal cheaper than by division loop
+  bool usesReciprocalDivision() {
+    if(!reciprocal_division_enabled_ || right_var_->type != variable_type::R_VAL || var_->type == variable_type::R_VAL) {
+      return false;
+    }
+    size_t divisor = right_var_->getValue();
+    if(divisor < 3 || isPowerOfTwo(divisor)) {
+      return false;
+    }
+    return reciprocalDivision(divisor).cost < 30 + 36 * k_estimated_arithmetic_iterations;
+  }
 };
 
 /**
  * x := var_ % right_var_
  *
  * same as division, but we don't store result - result is var after subtraction
+ * modulo by power of two 2^k is var - ((var >> k) << k), when quotient is kept for next command whole division
+ * code is used, modulo by other constants uses reciprocal of divisor like division
  *
  * var in reg_b
  * right_var in reg_a
@@ -732,11 +1059,11 @@ class DivideExpression : public DefaultExpression {
  * JZERO end_of_modulo
  * RST reg_f
  * INC reg_f
- * GET reg_b
- * SHR reg_a  # last_set_bit_pos
- * SHL reg_c
+ * SHL reg_c  # shift_divisor - until right_var is greater than var, so shifted value fits in register
  * SHL reg_f
- * JPOS last_set_bit_pos
+ * GET reg_c
+ * SUB reg_b
+ * JZERO shift_divisor
  * SHR reg_c  # main_loop
  * SHR reg_f
  * GET reg_f
@@ -757,10 +1084,13 @@ class ModuloExpression : public DefaultExpression {
  public:
   VariableContainer* right_var_;
   std::vector<std::pair<VariableContainer*, bool>> neededVariablesInRegisters() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesReciprocalDivision()) {
+      return {{var_, false}, {right_var_, false}};
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 1) {
         return {};
-      } else if(right_var_->getValue() == 2) {
+      } else if(isPowerOfTwo(right_var_->getValue())) {
         return {};
       }
     }
@@ -768,10 +1098,13 @@ class ModuloExpression : public DefaultExpression {
   }
 
   VariableContainer * variableNeededInAccumulator() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesReciprocalDivision()) {
+      return nullptr;
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 1) {
         return nullptr;
-      } else if(right_var_->getValue() == 2) {
+      } else if(isPowerOfTwo(right_var_->getValue())) {
         return var_;
       }
     }
@@ -779,36 +1112,48 @@ class ModuloExpression : public DefaultExpression {
   }
 
   bool accumulatorNeededForExpression() override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
-      if(right_var_->getValue() == 1) {
-        return true;
-      } else if(right_var_->getValue() == 2) {
-        return true;
-      }
-    }
     return true;
   }
 
   std::vector<std::string> calculateExpression(std::vector<std::shared_ptr<Register>> regs,
                                                long long expression_first_line_number) override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesReciprocalDivision()) {
+      std::vector<std::string> result_code = reciprocalDivisionCode(regs.at(0), regs.at(1), regs.at(2), regs.at(3),
+                                                                    right_var_->getValue(),
+                                                                    expression_first_line_number, stringify());
+      result_code.push_back("GET " + regs.at(2)->register_name_);
+      return result_code;
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 1) {
         return {"RST a"};
-      } else if(right_var_->getValue() == 2) {
-        auto acc = regs.at(0);  // var in acc
+      } else if(isPowerOfTwo(right_var_->getValue())) {
+        // var - (var >> k << k)
         auto free_reg = regs.at(1); // reg for holding var
-        return {
-          "PUT " + free_reg->register_name_,
-          "SHR " + free_reg->register_name_,
-          "SHL " + free_reg->register_name_,
-          "SUB " + free_reg->register_name_
-        };
+        int msb_index = msbIndex(right_var_->getValue());
+        std::vector<std::string> commands{"PUT " + free_reg->register_name_ + " # " + stringify()};
+        for(int i = 0; i < msb_index - 1; i++) {
+          commands.push_back("SHR " + free_reg->register_name_);
+        }
+        for(int i = 0; i < msb_index - 1; i++) {
+          commands.push_back("SHL " + free_reg->register_name_);
+        }
+        commands.push_back("SUB " + free_reg->register_name_);
+        return commands;
       }
     }
     std::shared_ptr<Register> var_reg = regs.at(0);
     std::shared_ptr<Register> acc_reg = regs.at(1);
     std::shared_ptr<Register> right_var_reg = regs.at(2);
     std::shared_ptr<Register> iterator_reg = regs.at(3);
+    if(keeps_result_) {
+      // quotient is calculated too
+      std::shared_ptr<Register> result_reg = regs.at(4);
+      std::vector<std::string> result_code = divisionLoopCode(var_reg, acc_reg, right_var_reg, iterator_reg,
+                                                              result_reg, expression_first_line_number, stringify());
+      result_code.push_back("GET " + var_reg->register_name_);
+      return result_code;
+    }
     std::vector<std::string> result_code {
       "PUT " + right_var_reg->register_name_ + " # " + var_->stringify() + " % " + right_var_->stringify(),
       "GET " + var_reg->register_name_,
@@ -819,11 +1164,11 @@ class ModuloExpression : public DefaultExpression {
       "JZERO " + std::to_string(expression_first_line_number + 26),
       "RST " + iterator_reg->register_name_,
       "INC " + iterator_reg->register_name_,
-      "GET " + var_reg->register_name_,
-      "SHR " + acc_reg->register_name_,
       "SHL " + right_var_reg->register_name_,
       "SHL " + iterator_reg->register_name_,
-      "JPOS " + std::to_string(expression_first_line_number + 10),
+      "GET " + right_var_reg->register_name_,
+      "SUB " + var_reg->register_name_,
+      "JZERO " + std::to_string(expression_first_line_number + 9),
       "SHR " + right_var_reg->register_name_,
       "SHR " + iterator_reg->register_name_,
       "GET " + iterator_reg->register_name_,
@@ -842,21 +1187,32 @@ class ModuloExpression : public DefaultExpression {
   }
 
   int neededEmptyRegs() override {
-    if(right_var_->type == variable_type::R_VAL) {
-      if(right_var_->getValue() == 0) {
+    if(usesReciprocalDivision()) {
+      return 2;
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+      if(right_var_->getValue() == 1) {
         return 0;
-      } else if(right_var_->getValue() == 2) {
+      } else if(isPowerOfTwo(right_var_->getValue())) {
         return 1;
       }
     }
-    return 2;
+    return keeps_result_ ? 3 : 2;
   }
 
   std::shared_ptr<Register> updateRegistersState(std::vector<std::shared_ptr<Register>> registers) override {
-    if(right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+    if(usesReciprocalDivision()) {
+      registers.at(2)->curr_variable = nullptr;
+      registers.at(2)->variable_saved_ = true;
+      // quotient is left in its register
+      registers.at(3)->curr_variable = keeps_result_ ? kept_result_ : nullptr;
+      registers.at(3)->variable_saved_ = true;
+      return nullptr;
+    }
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
       if(right_var_->getValue() == 1) {
         return nullptr;
-      } else if(right_var_->getValue() == 2) {
+      } else if(isPowerOfTwo(right_var_->getValue())) {
         auto free_reg = registers.at(1); // reg for holding var
         free_reg->curr_variable = nullptr;
         free_reg->variable_saved_ = true;
@@ -872,10 +1228,51 @@ class ModuloExpression : public DefaultExpression {
     iterator_reg->variable_saved_ = true;
     var_reg->curr_variable = nullptr;
     var_reg->variable_saved_ = true;
+    if(keeps_result_) {
+      // quotient is left in result register
+      registers.at(4)->curr_variable = kept_result_;
+      registers.at(4)->variable_saved_ = true;
+    }
     return registers.at(1);
   }
+
+  std::string stringify() override {
+    return var_->stringify() + " % " + right_var_->stringify();
+  }
+
+  long long int estimatedCost() override {
+    if(shift_shortcut_enabled_ && right_var_->type == variable_type::R_VAL && var_->type != variable_type::R_VAL) {
+      if(right_var_->getValue() == 1) {
+        return 1;
+      } else if(isPowerOfTwo(right_var_->getValue())) {
+        return estimatedOperandCost(var_) + 2 * msbIndex(right_var_->getValue()) + 4;
+      }
+    }
+    if(kept_result_ && !keeps_result_) {
+      return 1;
+    }
+    if(usesReciprocalDivision()) {
+      return estimatedOperandCost(var_) + estimatedOperandCost(right_var_) +
+          reciprocalDivision(right_var_->getValue()).cost;
+    } else if(keeps_result_) {
+      return estimatedOperandCost(var_) + estimatedOperandCost(right_var_) + 30 + 36 * k_estimated_arithmetic_iterations;
+    }
+    return estimatedOperandCost(var_) + estimatedOperandCost(right_var_) + 30 + 31 * k_estimated_arithmetic_iterations;
+  }
  private:
   expression_type type = expression_type::MODULO;
+
+  // division by constant, that is calculated from its reciprocal cheaper than by division loop
+  bool usesReciprocalDivision() {
+    if(!reciprocal_division_enabled_ || right_var_->type != variable_type::R_VAL || var_->type == variable_type::R_VAL) {
+      return false;
+    }
+    size_t divisor = right_var_->getValue();
+    if(divisor < 3 || isPowerOfTwo(divisor)) {
+      return false;
+    }
+    return reciprocalDivision(divisor).cost < 30 + (keeps_result_ ? 36 : 31) * k_estimated_arithmetic_iterations;
+  }
 };
 
 /**
@@ -938,7 +1335,6 @@ enum class condition_type {
   GE
 };
 
-// TODO(Jakub Drzewiecki): Optimize conditions if they are always false/true
 class Condition {
  public:
   condition_type type_;
@@ -951,6 +1347,25 @@ class Condition {
     return {right_var_, left_var_};
   }
 
+  // static estimate of condition evaluation cost in virtual machine
+  long long int estimatedCost() {
+    return estimatedOperandCost(left_var_) + estimatedOperandCost(right_var_) + getConditionCodeSize() + 5;
+  }
+
+  std::string stringify() {
+    switch(type_) {
+      case condition_type::EQ:
+        return left_var_->stringify() + " = " + right_var_->stringify();
+      case condition_type::NEQ:
+        return left_var_->stringify() + " != " + right_var_->stringify();
+      case condition_type::GT:
+        return left_var_->stringify() + " > " + right_var_->stringify();
+      case condition_type::GE:
+        return left_var_->stringify() + " >= " + right_var_->stringify();
+    }
+    return "";
+  }
+
   long long int getConditionCodeSize() {
     switch(type_) {
       case condition_type::EQ:
@@ -0,0 +1,175 @@
+#include "flow_analysis.h"
+
+namespace {
+void addReadVariable(VariableContainer* var, std::set<std::string> &read) {
+  if(var->type == variable_type::VAR) {
+    read.insert(var->getVariableName());
+  } else if(var->type == variable_type::VARIABLE_INDEXED_ARR) {
+    read.insert(var->getIndexVariableName());
+  }
+}
+}  // namespace
+
+condition_node_kind conditionNodeKind(std::shared_ptr<GraphNode> node) {
+  if(node->left_node->jump_condition_target == node) {
+    return condition_node_kind::LOOP;
+  } else if(node->left_node->jump_line_target) {
+    return condition_node_kind::IF_ELSE;
+  }
+  return condition_node_kind::IF;
+}
+
+bool isLoopConditionNode(std::shared_ptr<GraphNode> node) {
+  return node->cond && node->left_node && node->left_node->jump_condition_target == node;
+}
+
+std::shared_ptr<GraphNode> ifElseNextNode(std::shared_ptr<GraphNode> node) {
+  return node->left_node->jump_line_target;
+}
+
+std::shared_ptr<GraphNode> chainTail(std::shared_ptr<GraphNode> node) {
+  while(node->right_node) {
+    node = node->right_node;
+  }
+  return node;
+}
+
+void forEachGraphNode(std::shared_ptr<GraphNode> node, std::function<void(std::shared_ptr<GraphNode>)> visitor) {
+  visitor(node);
+  if(node->left_node)
+    forEachGraphNode(node->left_node, visitor);
+  if(node->right_node)
+    forEachGraphNode(node->right_node, visitor);
+}
+
+VariableContainer** expressionRightOperand(DefaultExpression* expression) {
+  if(auto plus = dynamic_cast<PlusExpression*>(expression)) {
+    return &plus->right_var_;
+  } else if(auto minus = dynamic_cast<MinusExpression*>(expression)) {
+    return &minus->right_var_;
+  } else if(auto multiply = dynamic_cast<MultiplyExpression*>(expression)) {
+    return &multiply->right_var_;
+  } else if(auto divide = dynamic_cast<DivideExpression*>(expression)) {
+    return &divide->right_var_;
+  } else if(auto modulo = dynamic_cast<ModuloExpression*>(expression)) {
+    return &modulo->right_var_;
+  }
+  return nullptr;
+}
+
+size_t inductionStep(Command *comm) {
+  if(comm->type != command_type::ASSIGNMENT) {
+    return 0;
+  }
+  AssignmentCommand* assignment_command = static_cast<AssignmentCommand*>(comm);
+  auto plus = dynamic_cast<PlusExpression*>(assignment_command->expression_);
+  if(!plus || assignment_command->left_var_->type != variable_type::VAR) {
+    return 0;
+  }
+  std::string variable_name = assignment_command->left_var_->getVariableName();
+  VariableContainer* step = nullptr;
+  if(plus->var_->type == variable_type::VAR && plus->var_->getVariableName() == variable_name) {
+    step = plus->right_var_;
+  } else if(plus->right_var_->type == variable_type::VAR && plus->right_var_->getVariableName() == variable_name) {
+    step = plus->var_;
+  }
+  if(!step || step->type != variable_type::R_VAL ||
+      plus->numberGenerationCost(step->getValue()) + 5 <= step->getValue()) {
+    return 0;
+  }
+  return step->getValue();
+}
+
+std::set<std::string> commandReadVariables(Command *comm) {
+  std::set<std::string> read;
+  if(comm->type == command_type::ASSIGNMENT) {
+    AssignmentCommand* assignment_command = static_cast<AssignmentCommand*>(comm);
+    addReadVariable(assignment_command->expression_->var_, read);
+    VariableContainer** right_operand = expressionRightOperand(assignment_command->expression_);
+    if(right_operand) {
+      addReadVariable(*right_operand, read);
+    }
+    if(assignment_command->left_var_->type == variable_type::VARIABLE_INDEXED_ARR) {
+      read.insert(assignment_command->left_var_->getIndexVariableName());
+    }
+  } else if(comm->type == command_type::READ) {
+    ReadCommand* read_command = static_cast<ReadCommand*>(comm);
+    if(read_command->var_->type == variable_type::VARIABLE_INDEXED_ARR) {
+      read.insert(read_command->var_->getIndexVariableName());
+    }
+  } else if(comm->type == command_type::WRITE) {
+    WriteCommand* write_command = static_cast<WriteCommand*>(comm);
+    addReadVariable(write_command->written_value_, read);
+  } else if(comm->type == command_type::PROC_CALL) {
+    // procedure can read every argument passed by reference
+    ProcedureCallCommand* procedure_call_command = static_cast<ProcedureCallCommand*>(comm);
+    for(auto & arg : procedure_call_command->proc_call_.args) {
+      read.insert(arg.name);
+    }
+  }
+  return read;
+}
+
+std::vector<VariableContainer*> commandAccessedValues(Command *comm) {
+  if(comm->type == command_type::ASSIGNMENT) {
+    AssignmentCommand* assignment_command = static_cast<AssignmentCommand*>(comm);
+    std::vector<VariableContainer*> values{assignment_command->left_var_, assignment_command->expression_->var_};
+    VariableContainer** right_operand = expressionRightOperand(assignment_command->expression_);
+    if(right_operand) {
+      values.push_back(*right_operand);
+    }
+    return values;
+  } else if(comm->type == command_type::READ) {
+    return {static_cast<ReadCommand*>(comm)->var_};
+  } else if(comm->type == command_type::WRITE) {
+    return {static_cast<WriteCommand*>(comm)->written_value_};
+  }
+  return {};
+}
+
+std::set<std::string> conditionReadVariables(Condition *cond) {
+  std::set<std::string> read;
+  addReadVariable(cond->left_var_, read);
+  addReadVariable(cond->right_var_, read);
+  return read;
+}
+
+std::set<std::string> commandWrittenVariables(Command *comm) {
+  std::set<std::string> written;
+  if(comm->type == command_type::ASSIGNMENT) {
+    AssignmentCommand* assignment_command = static_cast<AssignmentCommand*>(comm);
+    if(assignment_command->left_var_->type == variable_type::VAR) {
+      written.insert(assignment_command->left_var_->getVariableName());
+    }
+  } else if(comm->type == command_type::READ) {
+    ReadCommand* read_command = static_cast<ReadCommand*>(comm);
+    if(read_command->var_->type == variable_type::VAR) {
+      written.insert(read_command->var_->getVariableName());
+    }
+  } else if(comm->type == command_type::PROC_CALL) {
+    // arguments are passed by reference, so procedure can change every one of them
+    ProcedureCallCommand* procedure_call_command = static_cast<ProcedureCallCommand*>(comm);
+    for(auto & arg : procedure_call_command->proc_call_.args) {
+      written.insert(arg.name);
+    }
+  }
+  return written;
+}
+
+std::set<std::string> subgraphWrittenVariables(std::shared_ptr<GraphNode> node) {
+  std::set<std::string> written;
+  forEachGraphNode(node, [&written](std::shared_ptr<GraphNode> visited_node) {
+    for(auto comm : visited_node->commands) {
+      auto command_written = commandWrittenVariables(comm);
+      written.insert(command_written.begin(), command_written.end());
+    }
+  });
+  return written;
+}
+
+std::shared_ptr<Symbol> memorySymbol(std::shared_ptr<Symbol> sym) {
+  while(sym->memory_owner) {
+    sym = sym->memory_owner;
+  }
+  return sym;
+}
@@ -0,0 +1,56 @@
+#ifndef CUSTOMCOMPILER_COMPILER_FLOW_ANALYSIS_H_
+#define CUSTOMCOMPILER_COMPILER_FLOW_ANALYSIS_H_
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "code_generator.h"
+
+/**
+ * Helpers for analysis of structured flow graphs built by CodeGenerator.
+ *
+ * Node with condition is one of:
+ * - loop - left node is loop body, jumping back to condition, right node is code after loop,
+ * - if-else - left node is then branch jumping to next node, right node is else branch, which last node
+ *   continues to next node,
+ * - if - left node is then branch, right node is code after condition.
+ */
+enum class condition_node_kind {
+  LOOP,
+  IF_ELSE,
+  IF
+};
+
+condition_node_kind conditionNodeKind(std::shared_ptr<GraphNode> node);
+bool isLoopConditionNode(std::shared_ptr<GraphNode> node);
+// node following both branches of if-else node
+std::shared_ptr<GraphNode> ifElseNextNode(std::shared_ptr<GraphNode> node);
+// last node of chain of nodes connected by right nodes
+std::shared_ptr<GraphNode> chainTail(std::shared_ptr<GraphNode> node);
+
+// visits every node of flow graph once, in preorder
+void forEachGraphNode(std::shared_ptr<GraphNode> node, std::function<void(std::shared_ptr<GraphNode>)> visitor);
+
+// right operand of two argument expression, nullptr for expression being single value
+VariableContainer** expressionRightOperand(DefaultExpression* expression);
+
+// step c of command x := x + c (or x := c + x) with constant small enough to be added by INC chain, 0 otherwise
+size_t inductionStep(Command* comm);
+
+// names of scalar variables, that are read by command, including index variables of arrays
+std::set<std::string> commandReadVariables(Command* comm);
+// values accessed by assignment, READ or WRITE command: assigned variable and operands, empty for other commands
+std::vector<VariableContainer*> commandAccessedValues(Command* comm);
+// names of scalar variables, that are read by condition
+std::set<std::string> conditionReadVariables(Condition* cond);
+// names of scalar variables, that can be changed by command
+std::set<std::string> commandWrittenVariables(Command* comm);
+// names of scalar variables, that can be changed by any command of subgraph
+std::set<std::string> subgraphWrittenVariables(std::shared_ptr<GraphNode> node);
+
+// symbol, which memory is used by given symbol - symbols of clones and of overlaid frames use memory of other symbols
+std::shared_ptr<Symbol> memorySymbol(std::shared_ptr<Symbol> sym);
+
+#endif  // CUSTOMCOMPILER_COMPILER_FLOW_ANALYSIS_H_
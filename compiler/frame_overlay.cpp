@@ -0,0 +1,109 @@
+#include <vector>
+#include "frame_overlay.h"
+#include "flow_analysis.h"
+
+FrameOverlay::FrameOverlay(std::shared_ptr<CompilerStats> stats) : stats_(stats) {
+}
+
+void FrameOverlay::run(FlowGraphs &graphs) {
+  calls_.clear();
+  reachable_.clear();
+  for(auto graph : graphs) {
+    auto & called = calls_[graph->proc_name];
+    forEachGraphNode(graph, [&called](std::shared_ptr<GraphNode> node) {
+      for(auto comm : node->commands) {
+        if(comm->type == command_type::PROC_CALL) {
+          called.insert(static_cast<ProcedureCallCommand*>(comm)->proc_call_.name);
+        }
+      }
+    });
+  }
+
+  // symbols owning memory in declaration order, with procedures using their memory
+  std::vector<std::pair<std::shared_ptr<Symbol>, std::string>> memory_symbols;
+  std::map<std::shared_ptr<Symbol>, std::set<std::string>> users;
+  std::set<std::shared_ptr<Symbol>> kept_symbols;
+  for(auto graph : graphs) {
+    for(auto sym : graph->symbol_table->getSymbols()) {
+      auto memory_sym = memorySymbol(sym);
+      if(users.count(memory_sym) == 0) {
+        memory_symbols.push_back({memory_sym, graph->proc_name});
+      }
+      users[memory_sym].insert(graph->proc_name);
+      // main program is active during execution of every procedure
+      if(graph->proc_name.empty() || !isTransient(sym, graph)) {
+        kept_symbols.insert(memory_sym);
+      }
+    }
+  }
+
+  // first symbol of every slot and procedures using the slot
+  std::vector<std::pair<std::shared_ptr<Symbol>, std::set<std::string>>> slots;
+  for(auto & memory_symbol : memory_symbols) {
+    auto sym = memory_symbol.first;
+    if(kept_symbols.count(sym) > 0 || sym->type == symbol_type::ARR) {
+      continue;
+    }
+    auto & procedures = users[sym];
+    bool overlaid = false;
+    for(auto & slot : slots) {
+      if(!activeTogether(procedures, slot.second)) {
+        sym->memory_owner = slot.first;
+        slot.second.insert(procedures.begin(), procedures.end());
+        stats_->addProcedureCounter(memory_symbol.second, "symbols_overlaid", 1);
+        overlaid = true;
+        break;
+      }
+    }
+    if(!overlaid) {
+      slots.push_back({sym, procedures});
+    }
+  }
+  for(auto graph : graphs) {
+    for(auto sym : graph->symbol_table->getSymbols()) {
+      if(sym->memory_owner) {
+        sym->mem_start = memorySymbol(sym)->mem_start;
+      }
+    }
+  }
+}
+
+const std::set<std::string>& FrameOverlay::reachableProcedures(std::string name) {
+  auto found = reachable_.find(name);
+  if(found != reachable_.end()) {
+    return found->second;
+  }
+  // procedures can not be recursive, so call graph has no cycles
+  std::set<std::string> reachable;
+  for(auto & called : calls_[name]) {
+    reachable.insert(called);
+    auto & called_reachable = reachableProcedures(called);
+    reachable.insert(called_reachable.begin(), called_reachable.end());
+  }
+  return reachable_[name] = reachable;
+}
+
+bool FrameOverlay::activeTogether(std::set<std::string> &first, std::set<std::string> &second) {
+  for(auto & first_name : first) {
+    for(auto & second_name : second) {
+      if(first_name == second_name || reachableProcedures(first_name).count(second_name) > 0 ||
+          reachableProcedures(second_name).count(first_name) > 0) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/**
+ * Checks, if value of symbol is written in every call of procedure before being read, so memory of symbol does
+ * not have to keep it between calls.
+ */
+bool FrameOverlay::isTransient(std::shared_ptr<Symbol> sym, std::shared_ptr<GraphNode> graph) {
+  if(sym->proc_jump_back_mem || sym->value_argument || sym->type == symbol_type::PROC_ARGUMENT ||
+      sym->type == symbol_type::PROC_ARRAY_ARGUMENT) {
+    return true;
+  }
+  return sym->type == symbol_type::VAR && !sym->memory_shared && graph->liveness_computed_ &&
+      graph->live_in_.count(sym->symbol_name) == 0;
+}
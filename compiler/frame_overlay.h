@@ -0,0 +1,40 @@
+#ifndef CUSTOMCOMPILER_COMPILER_FRAME_OVERLAY_H_
+#define CUSTOMCOMPILER_COMPILER_FRAME_OVERLAY_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include "code_generator.h"
+#include "compiler_stats.h"
+
+/**
+ * Static allocation of procedure frames over call graph. Procedures can not be recursive, so two procedures are
+ * active at the same time only if one of them calls the other, directly or through other procedures. Memory of
+ * symbols, which values are not kept between calls, can be shared by procedures never active at the same time.
+ *
+ * Values not kept between calls are addresses of arguments and return address, written at every call, arguments
+ * passed by value, copied in by caller, and local variables not live at procedure start - written before being
+ * read in every call. Other locals, locals shared with clones of procedure, arrays and variables of main program
+ * keep their memory. Symbols are placed in declaration order into the first slot, which symbols belong only to
+ * procedures never active together with procedures of the symbol. Symbol placed in slot gets memory of its first
+ * symbol, so following memory layout places every slot once.
+ */
+class FrameOverlay {
+ public:
+  explicit FrameOverlay(std::shared_ptr<CompilerStats> stats);
+  void run(FlowGraphs &graphs);
+
+ private:
+  std::shared_ptr<CompilerStats> stats_;
+  // procedures called directly by procedure, by procedure name
+  std::map<std::string, std::set<std::string>> calls_;
+  // procedures called by procedure directly or through other procedures, by procedure name
+  std::map<std::string, std::set<std::string>> reachable_;
+
+  const std::set<std::string>& reachableProcedures(std::string name);
+  bool activeTogether(std::set<std::string> &first, std::set<std::string> &second);
+  bool isTransient(std::shared_ptr<Symbol> sym, std::shared_ptr<GraphNode> graph);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_FRAME_OVERLAY_H_
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include "inlining.h"
+#include "code_generator.h"
+#include "command_copy.h"
+#include "cost_model.h"
+#include "flow_analysis.h"
+
+namespace {
+// average number of instructions generated for single command or condition
+const long long int k_estimated_command_size = 10;
+// limit of estimated executions, to avoid overflow in deeply nested loops
+const long long int k_max_executions = 1000000000;
+
+void addValueNames(VariableContainer* var, std::vector<std::string> &names) {
+  if(var->type != variable_type::R_VAL) {
+    names.push_back(var->getVariableName());
+  }
+  if(var->type == variable_type::VARIABLE_INDEXED_ARR) {
+    names.push_back(var->getIndexVariableName());
+  }
+}
+
+std::string procedureName(Procedure &proc) {
+  return proc.head.name.empty() ? k_main_procedure_name : proc.head.name;
+}
+}  // namespace
+
+ProcedureInlining::ProcedureInlining(std::shared_ptr<CompilerStats> stats, long long int trip_count)
+    : stats_(stats), trip_count_(trip_count) {
+}
+
+void ProcedureInlining::setMemoryEnd(size_t memory_end) {
+  memory_end_ = memory_end;
+}
+
+void ProcedureInlining::run(std::vector<Procedure> &procedures, Procedure &main) {
+  for(auto & proc : procedures) {
+    countCalls(proc.commands, 1);
+  }
+  countCalls(main.commands, 1);
+  for(auto & proc : procedures) {
+    inlineCalls(proc.commands, proc, 1);
+    summaries_[proc.head.name] = summarizeProcedure(proc);
+    procedures_[proc.head.name] = proc;
+  }
+  inlineCalls(main.commands, main, 1);
+  removeUnusedProcedures(procedures, main);
+}
+
+/**
+ * Replaces calls worth inlining by bodies of called procedures. Bodies are copied from already processed
+ * procedures, so they do not contain calls worth inlining and are skipped.
+ *
+ * @param executions estimated executions of commands, every loop runs trip count times
+ */
+void ProcedureInlining::inlineCalls(std::vector<Command*> &commands, Procedure &caller, long long int executions) {
+  long long int loop_executions = std::min(executions * trip_count_, k_max_executions);
+  for(int i = 0; i < commands.size(); i++) {
+    Command* comm = commands.at(i);
+    if(comm->type == command_type::IF_ELSE) {
+      IfElseCommand* if_else_command = static_cast<IfElseCommand*>(comm);
+      inlineCalls(if_else_command->then_commands_, caller, executions);
+      inlineCalls(if_else_command->else_commands_, caller, executions);
+    } else if(comm->type == command_type::WHILE) {
+      inlineCalls(static_cast<WhileCommand*>(comm)->commands_, caller, loop_executions);
+    } else if(comm->type == command_type::REPEAT) {
+      inlineCalls(static_cast<RepeatUntilCommand*>(comm)->commands_, caller, loop_executions);
+    } else if(comm->type == command_type::PROC_CALL) {
+      ProcedureCallCommand* procedure_call_command = static_cast<ProcedureCallCommand*>(comm);
+      if(!summaries_[procedure_call_command->proc_call_.name].inlinable ||
+          !isWorthInlining(procedure_call_command, executions)) {
+        continue;
+      }
+      std::vector<Command*> body = inlineBody(procedure_call_command, caller);
+      commands.erase(commands.begin() + i);
+      commands.insert(commands.begin() + i, body.begin(), body.end());
+      i += (int) body.size() - 1;
+      stats_->addProcedureCounter(procedureName(caller), "calls_inlined", 1);
+    }
+  }
+}
+
+bool ProcedureInlining::isWorthInlining(ProcedureCallCommand* command, long long int executions) {
+  // body of procedure called once is not duplicated, removing procedure only saves code
+  if(calls_count_[command->proc_call_.name] == 1) {
+    return true;
+  }
+  Procedure &callee = procedures_[command->proc_call_.name];
+  std::set<std::string> arguments;
+  for(auto & arg : callee.head.arguments) {
+    arguments.insert(arg.name);
+  }
+  long long int size = 0;
+  long long int accesses = 0;
+  measureCommands(callee.commands, arguments, 1, size, accesses);
+  // argument holds address of passed variable, so every access needs additional load
+  long long int call_cost = k_estimated_call_cost + 2 * k_estimated_load_cost * command->proc_call_.args.size() +
+      k_estimated_load_cost * accesses;
+  long long int growth = k_estimated_command_size * size;
+  return call_cost >= (growth + executions - 1) / executions;
+}
+
+/**
+ * Counts commands and conditions of procedure body and accesses to arguments of procedure.
+ *
+ * @param executions estimated executions of commands, accesses in loops are counted trip count times
+ */
+void ProcedureInlining::measureCommands(std::vector<Command*> &commands,
+                                        std::set<std::string> &arguments,
+                                        long long int executions,
+                                        long long int &size,
+                                        long long int &accesses) {
+  long long int loop_executions = std::min(executions * trip_count_, k_max_executions);
+  for(auto comm : commands) {
+    size++;
+    std::vector<std::string> names;
+    std::vector<VariableContainer*> values = commandAccessedValues(comm);
+    if(comm->type == command_type::IF_ELSE) {
+      IfElseCommand* if_else_command = static_cast<IfElseCommand*>(comm);
+      values = {if_else_command->cond_.left_var_, if_else_command->cond_.right_var_};
+      measureCommands(if_else_command->then_commands_, arguments, executions, size, accesses);
+      measureCommands(if_else_command->else_commands_, arguments, executions, size, accesses);
+    } else if(comm->type == command_type::WHILE) {
+      WhileCommand* while_command = static_cast<WhileCommand*>(comm);
+      values = {while_command->cond_.left_var_, while_command->cond_.right_var_};
+      measureCommands(while_command->commands_, arguments, loop_executions, size, accesses);
+    } else if(comm->type == command_type::REPEAT) {
+      RepeatUntilCommand* repeat_command = static_cast<RepeatUntilCommand*>(comm);
+      values = {repeat_command->cond_.left_var_, repeat_command->cond_.right_var_};
+      measureCommands(repeat_command->commands_, arguments, loop_executions, size, accesses);
+    }
+    for(auto var : values) {
+      addValueNames(var, names);
+    }
+    long long int condition_executions = comm->type == command_type::WHILE ||
+        comm->type == command_type::REPEAT ? loop_executions : executions;
+    for(auto & name : names) {
+      if(arguments.count(name) > 0) {
+        accesses = std::min(accesses + condition_executions, k_max_executions);
+      }
+    }
+  }
+}
+
+/**
+ * Copies body of called procedure. Arguments are replaced by names passed by the caller, local variables by new
+ * variables added to symbol table of the caller.
+ */
+std::vector<Command*> ProcedureInlining::inlineBody(ProcedureCallCommand* command, Procedure &caller) {
+  Procedure &callee = procedures_[command->proc_call_.name];
+  std::map<std::string, std::string> renamed_variables;
+  for(int i = 0; i < callee.head.arguments.size(); i++) {
+    renamed_variables[callee.head.arguments.at(i).name] = command->proc_call_.args.at(i).name;
+  }
+  for(auto sym : callee.symbol_table->getSymbols()) {
+    if(sym->type != symbol_type::VAR || sym->proc_jump_back_mem) {
+      continue;
+    }
+    // names of source variables can not contain digits, so generated name is unique
+    std::string variable_name = sym->symbol_name + "_" + std::to_string(inlined_calls_count_);
+    Symbol new_symbol;
+    new_symbol.symbol_name = variable_name;
+    new_symbol.type = symbol_type::VAR;
+    new_symbol.initialized = true;
+    new_symbol.mem_start = memory_end_++;
+    new_symbol.length = 1;
+    caller.symbol_table->addSymbol(new_symbol, 0);
+    renamed_variables[sym->symbol_name] = variable_name;
+  }
+  inlined_calls_count_++;
+  CommandCopy copy(renamed_variables);
+  std::vector<Command*> body = copy.copyCommands(callee.commands);
+  calls_count_[command->proc_call_.name]--;
+  countCalls(body, 1);
+  return body;
+}
+
+/**
+ * Finds arguments, which procedure can read before writing them, and arguments written in every execution.
+ * Procedure can be inlined, if it has no local arrays and none of its local variables is read before being
+ * written, so values left by previous calls are never used.
+ */
+ProcedureInlining::ProcedureSummary ProcedureInlining::summarizeProcedure(Procedure &proc) {
+  ProcedureSummary summary;
+  std::set<std::string> written;
+  std::set<std::string> read_first;
+  findReadsBeforeWrites(proc.commands, written, read_first);
+  for(int i = 0; i < proc.head.arguments.size(); i++) {
+    if(read_first.count(proc.head.arguments.at(i).name) > 0) {
+      summary.read_arguments.insert(i);
+    }
+    if(written.count(proc.head.arguments.at(i).name) > 0) {
+      summary.written_arguments.insert(i);
+    }
+  }
+  summary.inlinable = true;
+  for(auto sym : proc.symbol_table->getSymbols()) {
+    if(sym->type == symbol_type::ARR ||
+        (sym->type == symbol_type::VAR && !sym->proc_jump_back_mem && read_first.count(sym->symbol_name) > 0)) {
+      summary.inlinable = false;
+    }
+  }
+  return summary;
+}
+
+/**
+ * Walks commands in execution order, collecting scalar variables read when they could be not written yet.
+ *
+ * @param written variables written in every execution of previous commands, updated by commands
+ * @param read_first variables read before being written
+ */
+void ProcedureInlining::findReadsBeforeWrites(std::vector<Command*> &commands,
+                                              std::set<std::string> &written,
+                                              std::set<std::string> &read_first) {
+  auto read = [&written, &read_first](std::set<std::string> names) {
+    for(auto & name : names) {
+      if(written.count(name) == 0) {
+        read_first.insert(name);
+      }
+    }
+  };
+  for(auto comm : commands) {
+    if(comm->type == command_type::IF_ELSE) {
+      IfElseCommand* if_else_command = static_cast<IfElseCommand*>(comm);
+      read(conditionReadVariables(&if_else_command->cond_));
+      std::set<std::string> then_written = written;
+      findReadsBeforeWrites(if_else_command->then_commands_, then_written, read_first);
+      std::set<std::string> else_written = written;
+      findReadsBeforeWrites(if_else_command->else_commands_, else_written, read_first);
+      written.clear();
+      std::set_intersection(then_written.begin(), then_written.end(), else_written.begin(), else_written.end(),
+                            std::inserter(written, written.begin()));
+    } else if(comm->type == command_type::WHILE) {
+      WhileCommand* while_command = static_cast<WhileCommand*>(comm);
+      read(conditionReadVariables(&while_command->cond_));
+      // body can be skipped, so its writes are not certain
+      std::set<std::string> body_written = written;
+      findReadsBeforeWrites(while_command->commands_, body_written, read_first);
+    } else if(comm->type == command_type::REPEAT) {
+      // flow graph checks negated condition of repeat-until loop before its body, like in while loop
+      RepeatUntilCommand* repeat_command = static_cast<RepeatUntilCommand*>(comm);
+      read(conditionReadVariables(&repeat_command->cond_));
+      std::set<std::string> body_written = written;
+      findReadsBeforeWrites(repeat_command->commands_, body_written, read_first);
+    } else if(comm->type == command_type::PROC_CALL) {
+      ProcedureCallCommand* procedure_call_command = static_cast<ProcedureCallCommand*>(comm);
+      ProcedureSummary &summary = summaries_[procedure_call_command->proc_call_.name];
+      auto & args = procedure_call_command->proc_call_.args;
+      for(int i = 0; i < args.size(); i++) {
+        if(summary.read_arguments.count(i) > 0) {
+          read({args.at(i).name});
+        }
+      }
+      for(int i = 0; i < args.size(); i++) {
+        if(summary.written_arguments.count(i) > 0) {
+          written.insert(args.at(i).name);
+        }
+      }
+    } else {
+      read(commandReadVariables(comm));
+      auto command_written = commandWrittenVariables(comm);
+      written.insert(command_written.begin(), command_written.end());
+    }
+  }
+}
+
+void ProcedureInlining::countCalls(std::vector<Command*> &commands, long long int added_calls) {
+  for(auto comm : commands) {
+    if(comm->type == command_type::IF_ELSE) {
+      countCalls(static_cast<IfElseCommand*>(comm)->then_commands_, added_calls);
+      countCalls(static_cast<IfElseCommand*>(comm)->else_commands_, added_calls);
+    } else if(comm->type == command_type::WHILE) {
+      countCalls(static_cast<WhileCommand*>(comm)->commands_, added_calls);
+    } else if(comm->type == command_type::REPEAT) {
+      countCalls(static_cast<RepeatUntilCommand*>(comm)->commands_, added_calls);
+    } else if(comm->type == command_type::PROC_CALL) {
+      calls_count_[static_cast<ProcedureCallCommand*>(comm)->proc_call_.name] += added_calls;
+    }
+  }
+}
+
+// procedures are removed from the last one, as they can be called only by procedures declared later
+void ProcedureInlining::removeUnusedProcedures(std::vector<Procedure> &procedures, Procedure &main) {
+  calls_count_.clear();
+  countCalls(main.commands, 1);
+  for(int i = procedures.size() - 1; i >= 0; i--) {
+    if(calls_count_[procedures.at(i).head.name] > 0) {
+      countCalls(procedures.at(i).commands, 1);
+    } else {
+      stats_->addCounter("procedures_removed", 1);
+      procedures.erase(procedures.begin() + i);
+    }
+  }
+}
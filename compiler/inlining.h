@@ -0,0 +1,65 @@
+#ifndef CUSTOMCOMPILER_COMPILER_INLINING_H_
+#define CUSTOMCOMPILER_COMPILER_INLINING_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "compiler_stats.h"
+#include "data.h"
+
+/**
+ * Inlining of procedure calls, performed on commands of procedures before flow graphs are generated. Body of
+ * called procedure is copied in place of the call - arguments are replaced by variables and arrays passed by the
+ * caller, local variables by new variables of the caller. Procedures can call only procedures declared earlier
+ * and can not call themselves, so procedures are processed in declaration order and every inlined body has its
+ * own calls already inlined.
+ *
+ * Local variables of procedure keep their values between calls, so procedure is inlined only if it has no local
+ * arrays and every local variable is written before being read. Call is inlined if cost of the call (passing
+ * addresses of arguments, jumps and indirect accesses to arguments), multiplied by estimated executions of the
+ * call, exceeds estimated size of copied commands. Body of procedure called only once is never duplicated, so
+ * such call is always inlined. Procedures, which are not called anymore, are removed.
+ */
+class ProcedureInlining {
+ public:
+  ProcedureInlining(std::shared_ptr<CompilerStats> stats, long long int trip_count);
+  // sets first free memory address, used for variables replacing local variables of inlined procedures
+  void setMemoryEnd(size_t memory_end);
+  void run(std::vector<Procedure> &procedures, Procedure &main);
+
+ private:
+  // arguments of procedure, which can be read before being written by the procedure, and certainly written ones
+  typedef struct procedure_summary {
+    std::set<int> read_arguments;
+    std::set<int> written_arguments;
+    bool inlinable = false;
+  } ProcedureSummary;
+
+  std::shared_ptr<CompilerStats> stats_;
+  long long int trip_count_;
+  size_t memory_end_ = 0;
+  int inlined_calls_count_ = 0;
+  std::map<std::string, Procedure> procedures_;
+  std::map<std::string, ProcedureSummary> summaries_;
+  // calls of every procedure left in program
+  std::map<std::string, long long int> calls_count_;
+
+  void inlineCalls(std::vector<Command*> &commands, Procedure &caller, long long int executions);
+  bool isWorthInlining(ProcedureCallCommand* command, long long int executions);
+  void measureCommands(std::vector<Command*> &commands,
+                       std::set<std::string> &arguments,
+                       long long int executions,
+                       long long int &size,
+                       long long int &accesses);
+  std::vector<Command*> inlineBody(ProcedureCallCommand* command, Procedure &caller);
+  ProcedureSummary summarizeProcedure(Procedure &proc);
+  void findReadsBeforeWrites(std::vector<Command*> &commands,
+                             std::set<std::string> &written,
+                             std::set<std::string> &read_first);
+  void countCalls(std::vector<Command*> &commands, long long int added_calls);
+  void removeUnusedProcedures(std::vector<Procedure> &procedures, Procedure &main);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_INLINING_H_
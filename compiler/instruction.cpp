@@ -0,0 +1,192 @@
+#include <sstream>
+#include "instruction.h"
+
+namespace {
+const std::vector<std::pair<std::string, instruction_code>> k_mnemonics {
+  {"READ", instruction_code::READ},
+  {"WRITE", instruction_code::WRITE},
+  {"LOAD", instruction_code::LOAD},
+  {"STORE", instruction_code::STORE},
+  {"ADD", instruction_code::ADD},
+  {"SUB", instruction_code::SUB},
+  {"GET", instruction_code::GET},
+  {"PUT", instruction_code::PUT},
+  {"RST", instruction_code::RST},
+  {"INC", instruction_code::INC},
+  {"DEC", instruction_code::DEC},
+  {"SHL", instruction_code::SHL},
+  {"SHR", instruction_code::SHR},
+  {"JUMP", instruction_code::JUMP},
+  {"JPOS", instruction_code::JPOS},
+  {"JZERO", instruction_code::JZERO},
+  {"STRK", instruction_code::STRK},
+  {"JUMPR", instruction_code::JUMPR},
+  {"HALT", instruction_code::HALT}
+};
+}  // namespace
+
+bool parseInstruction(std::string line, Instruction &result) {
+  result = Instruction{};
+  size_t comment_start = line.find('#');
+  if(comment_start != std::string::npos) {
+    result.comment = line.substr(comment_start + 1);
+    size_t first_char = result.comment.find_first_not_of(' ');
+    result.comment = first_char == std::string::npos ? "" : result.comment.substr(first_char);
+    line = line.substr(0, comment_start);
+  }
+  std::stringstream line_stream(line);
+  std::string mnemonic;
+  std::string argument;
+  if(!(line_stream >> mnemonic)) {
+    return false;
+  }
+  bool found = false;
+  for(auto & entry : k_mnemonics) {
+    if(entry.first == mnemonic) {
+      result.code = entry.second;
+      found = true;
+      break;
+    }
+  }
+  if(!found) {
+    return false;
+  }
+  if(hasRegisterArgument(result.code)) {
+    if(!(line_stream >> argument) || argument.size() != 1 || argument.at(0) < 'a' || argument.at(0) > 'h') {
+      return false;
+    }
+    result.reg = argument;
+  } else if(isJumpInstruction(result.code)) {
+    if(!(line_stream >> argument)) {
+      return false;
+    }
+    try {
+      result.target = std::stoll(argument);
+    } catch(std::exception & e) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string instructionToString(Instruction instr) {
+  std::string result = instructionMnemonic(instr.code);
+  if(hasRegisterArgument(instr.code)) {
+    result += " " + instr.reg;
+  } else if(isJumpInstruction(instr.code)) {
+    result += " " + std::to_string(instr.target);
+  }
+  if(!instr.comment.empty()) {
+    result += " # " + instr.comment;
+  }
+  return result;
+}
+
+std::string instructionMnemonic(instruction_code code) {
+  for(auto & entry : k_mnemonics) {
+    if(entry.second == code) {
+      return entry.first;
+    }
+  }
+  return "";
+}
+
+bool hasRegisterArgument(instruction_code code) {
+  switch(code) {
+    case instruction_code::LOAD:
+    case instruction_code::STORE:
+    case instruction_code::ADD:
+    case instruction_code::SUB:
+    case instruction_code::GET:
+    case instruction_code::PUT:
+    case instruction_code::RST:
+    case instruction_code::INC:
+    case instruction_code::DEC:
+    case instruction_code::SHL:
+    case instruction_code::SHR:
+    case instruction_code::STRK:
+    case instruction_code::JUMPR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool isJumpInstruction(instruction_code code) {
+  return code == instruction_code::JUMP || code == instruction_code::JPOS || code == instruction_code::JZERO;
+}
+
+std::string writtenRegister(const Instruction &instr) {
+  switch(instr.code) {
+    case instruction_code::READ:
+    case instruction_code::LOAD:
+    case instruction_code::ADD:
+    case instruction_code::SUB:
+    case instruction_code::GET:
+      return "a";
+    case instruction_code::PUT:
+    case instruction_code::RST:
+    case instruction_code::INC:
+    case instruction_code::DEC:
+    case instruction_code::SHL:
+    case instruction_code::SHR:
+    case instruction_code::STRK:
+      return instr.reg;
+    default:
+      return "";
+  }
+}
+
+long long int instructionCost(instruction_code code) {
+  switch(code) {
+    case instruction_code::READ:
+    case instruction_code::WRITE:
+      return 100;
+    case instruction_code::LOAD:
+    case instruction_code::STORE:
+      return 50;
+    case instruction_code::ADD:
+    case instruction_code::SUB:
+      return 5;
+    case instruction_code::HALT:
+      return 0;
+    default:
+      return 1;
+  }
+}
+
+std::vector<bool> findJumpTargets(const std::vector<Instruction> &code) {
+  std::vector<bool> targets(code.size() + 1, false);
+  for(long long int i = 0; i < code.size(); i++) {
+    if(isJumpInstruction(code.at(i).code) && code.at(i).target >= 0 && code.at(i).target < targets.size()) {
+      targets.at(code.at(i).target) = true;
+    }
+    if(code.at(i).code == instruction_code::STRK && i + 2 < targets.size()) {
+      targets.at(i + 1) = true;
+      targets.at(i + 2) = true;
+    }
+  }
+  return targets;
+}
+
+std::vector<Instruction> replaceInstructions(const std::vector<Instruction> &code,
+                                             const std::vector<std::vector<Instruction>> &replacements) {
+  // jump to removed instruction continues at next kept one
+  std::vector<long long int> new_lines(code.size() + 1);
+  long long int new_size = 0;
+  for(long long int i = 0; i < code.size(); i++) {
+    new_lines.at(i) = new_size;
+    new_size += replacements.at(i).size();
+  }
+  new_lines.at(code.size()) = new_size;
+  std::vector<Instruction> new_code;
+  for(auto & sequence : replacements) {
+    for(auto instr : sequence) {
+      if(isJumpInstruction(instr.code) && instr.target >= 0 && instr.target < new_lines.size()) {
+        instr.target = new_lines.at(instr.target);
+      }
+      new_code.push_back(instr);
+    }
+  }
+  return new_code;
+}
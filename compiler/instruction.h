@@ -0,0 +1,64 @@
+#ifndef CUSTOMCOMPILER_COMPILER_INSTRUCTION_H_
+#define CUSTOMCOMPILER_COMPILER_INSTRUCTION_H_
+
+#include <string>
+#include <vector>
+
+enum class instruction_code {
+  READ,
+  WRITE,
+  LOAD,
+  STORE,
+  ADD,
+  SUB,
+  GET,
+  PUT,
+  RST,
+  INC,
+  DEC,
+  SHL,
+  SHR,
+  JUMP,
+  JPOS,
+  JZERO,
+  STRK,
+  JUMPR,
+  HALT
+};
+
+/**
+ * Single instruction of the virtual machine parsed from generated code line.
+ * Register argument is empty for instructions without one, jump target is -1 for non-jump instructions.
+ */
+typedef struct instruction {
+  instruction_code code;
+  std::string reg;
+  long long int target = -1;
+  std::string comment;
+} Instruction;
+
+bool parseInstruction(std::string line, Instruction &result);
+std::string instructionToString(Instruction instr);
+std::string instructionMnemonic(instruction_code code);
+
+bool hasRegisterArgument(instruction_code code);
+bool isJumpInstruction(instruction_code code);
+// register changed by execution of instruction, empty for instructions that do not change any register
+std::string writtenRegister(const Instruction &instr);
+// cost of instruction execution in virtual machine
+long long int instructionCost(instruction_code code);
+
+/**
+ * Marks lines of code, that are targets of jumps. Procedure returns by JUMPR to second instruction after STRK,
+ * so both instructions following STRK are marked too.
+ */
+std::vector<bool> findJumpTargets(const std::vector<Instruction> &code);
+/**
+ * Builds new code by replacing every instruction with its sequence from replacements, empty sequence removes
+ * instruction. Targets of all jumps, including jumps of replacing sequences, are lines of old code and are moved
+ * to the beginning of sequence replacing target instruction.
+ */
+std::vector<Instruction> replaceInstructions(const std::vector<Instruction> &code,
+                                             const std::vector<std::vector<Instruction>> &replacements);
+
+#endif  // CUSTOMCOMPILER_COMPILER_INSTRUCTION_H_
@@ -0,0 +1,119 @@
+#include <vector>
+#include "liveness.h"
+#include "flow_analysis.h"
+
+void LivenessAnalysis::run(std::shared_ptr<GraphNode> graph) {
+  symbol_table_ = graph->symbol_table;
+  if(graph->proc_name.empty()) {
+    // nothing is read after end of main program
+    analyzeChain(graph, {}, nullptr);
+    return;
+  }
+  // locals of procedure keep their values between calls, so variables live at procedure start
+  // are live at its end too; arguments passed by value are read by caller after the call and locals
+  // shared with clones of procedure can be read by them
+  LiveVariables copied_out;
+  for(auto sym : symbol_table_->getSymbols()) {
+    if(sym->value_argument || sym->memory_shared) {
+      copied_out.insert(sym->symbol_name);
+    }
+  }
+  LiveVariables live_at_end = copied_out;
+  while(true) {
+    LiveVariables live_at_start = analyzeChain(graph, live_at_end, nullptr);
+    live_at_start.insert(copied_out.begin(), copied_out.end());
+    if(live_at_start == live_at_end) {
+      break;
+    }
+    live_at_end = live_at_start;
+  }
+}
+
+bool LivenessAnalysis::isTrackedVariable(std::string variable_name) {
+  auto sym = symbol_table_->findSymbol(variable_name);
+  return sym && sym->type == symbol_type::VAR;
+}
+
+LivenessAnalysis::LiveVariables LivenessAnalysis::analyzeChain(std::shared_ptr<GraphNode> node,
+                                                               LiveVariables live_at_end,
+                                                               std::shared_ptr<GraphNode> stop_node) {
+  std::vector<std::shared_ptr<GraphNode>> chain;
+  while(node && node != stop_node) {
+    chain.push_back(node);
+    if(node->cond && conditionNodeKind(node) == condition_node_kind::IF_ELSE) {
+      node = ifElseNextNode(node);
+    } else {
+      node = node->right_node;
+    }
+  }
+  LiveVariables live = live_at_end;
+  for(auto it = chain.rbegin(); it != chain.rend(); it++) {
+    live = analyzeNode(*it, live);
+  }
+  return live;
+}
+
+LivenessAnalysis::LiveVariables LivenessAnalysis::analyzeNode(std::shared_ptr<GraphNode> node, LiveVariables live_out) {
+  node->live_out_ = live_out;
+  LiveVariables live = live_out;
+  if(node->cond) {
+    LiveVariables condition_read = trackedOnly(conditionReadVariables(node->cond.get()));
+    condition_node_kind kind = conditionNodeKind(node);
+    if(kind == condition_node_kind::LOOP) {
+      // condition is checked before every iteration, so it is reached from loop body too
+      LiveVariables loop_live = live;
+      loop_live.insert(condition_read.begin(), condition_read.end());
+      while(true) {
+        LiveVariables body_live = analyzeChain(node->left_node, loop_live, nullptr);
+        body_live.insert(loop_live.begin(), loop_live.end());
+        if(body_live == loop_live) {
+          break;
+        }
+        loop_live = body_live;
+      }
+      live = loop_live;
+    } else if(kind == condition_node_kind::IF_ELSE) {
+      LiveVariables then_live = analyzeChain(node->left_node, live, nullptr);
+      LiveVariables else_live = analyzeChain(node->right_node, live, ifElseNextNode(node));
+      live = then_live;
+      live.insert(else_live.begin(), else_live.end());
+      live.insert(condition_read.begin(), condition_read.end());
+    } else {
+      LiveVariables then_live = analyzeChain(node->left_node, live, nullptr);
+      live.insert(then_live.begin(), then_live.end());
+      live.insert(condition_read.begin(), condition_read.end());
+    }
+    node->live_before_condition_ = live;
+  }
+  node->live_after_commands_.resize(node->commands.size());
+  for(int i = node->commands.size() - 1; i >= 0; i--) {
+    node->live_after_commands_.at(i) = live;
+    live = analyzeCommand(node->commands.at(i), live);
+  }
+  node->live_in_ = live;
+  node->liveness_computed_ = true;
+  return live;
+}
+
+LivenessAnalysis::LiveVariables LivenessAnalysis::analyzeCommand(Command *comm, LiveVariables live_after) {
+  LiveVariables live = live_after;
+  // procedure call can leave arguments unchanged, so only assignment and read surely overwrite variable
+  if(comm->type == command_type::ASSIGNMENT || comm->type == command_type::READ) {
+    for(auto & name : commandWrittenVariables(comm)) {
+      live.erase(name);
+    }
+  }
+  LiveVariables read = trackedOnly(commandReadVariables(comm));
+  live.insert(read.begin(), read.end());
+  return live;
+}
+
+LivenessAnalysis::LiveVariables LivenessAnalysis::trackedOnly(std::set<std::string> variables) {
+  LiveVariables tracked;
+  for(auto & name : variables) {
+    if(isTrackedVariable(name)) {
+      tracked.insert(name);
+    }
+  }
+  return tracked;
+}
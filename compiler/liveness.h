@@ -0,0 +1,35 @@
+#ifndef CUSTOMCOMPILER_COMPILER_LIVENESS_H_
+#define CUSTOMCOMPILER_COMPILER_LIVENESS_H_
+
+#include <memory>
+#include <set>
+#include <string>
+#include "code_generator.h"
+
+/**
+ * Backward liveness analysis of scalar variables on structured flow graph of single procedure.
+ * Results are stored in graph nodes and used by code generator to skip storing values, that are never read again.
+ * Only local variables are tracked - procedure arguments can be read by caller and arrays are not analysed,
+ * so both are always treated as live. Arguments passed by value are tracked like locals, but they are live
+ * at procedure end, where caller copies them out.
+ */
+class LivenessAnalysis {
+ public:
+  void run(std::shared_ptr<GraphNode> graph);
+  // variable is tracked by analysis, so it can be dead
+  bool isTrackedVariable(std::string variable_name);
+
+ private:
+  typedef std::set<std::string> LiveVariables;
+
+  std::shared_ptr<SymbolTable> symbol_table_;
+
+  LiveVariables analyzeChain(std::shared_ptr<GraphNode> node,
+                             LiveVariables live_at_end,
+                             std::shared_ptr<GraphNode> stop_node);
+  LiveVariables analyzeNode(std::shared_ptr<GraphNode> node, LiveVariables live_out);
+  LiveVariables analyzeCommand(Command* comm, LiveVariables live_after);
+  LiveVariables trackedOnly(std::set<std::string> variables);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_LIVENESS_H_
@@ -0,0 +1,137 @@
+#include "loop_invariant_motion.h"
+#include "flow_analysis.h"
+
+LoopInvariantMotion::LoopInvariantMotion(std::shared_ptr<CompilerStats> stats) : stats_(stats) {
+}
+
+void LoopInvariantMotion::setMemoryEnd(size_t memory_end) {
+  memory_end_ = memory_end;
+}
+
+void LoopInvariantMotion::run(std::shared_ptr<GraphNode> graph) {
+  symbol_table_ = graph->symbol_table;
+  procedure_name_ = graph->proc_name.empty() ? k_main_procedure_name : graph->proc_name;
+  hoisted_variables_.clear();
+  processChain(graph, nullptr);
+}
+
+void LoopInvariantMotion::processChain(std::shared_ptr<GraphNode> node, std::shared_ptr<GraphNode> stop_node) {
+  while(node && node != stop_node) {
+    if(!node->cond) {
+      node = node->right_node;
+      continue;
+    }
+    condition_node_kind kind = conditionNodeKind(node);
+    if(kind == condition_node_kind::LOOP) {
+      processChain(node->left_node, nullptr);
+      hoistFromLoop(node);
+      node = node->right_node;
+    } else if(kind == condition_node_kind::IF_ELSE) {
+      auto next_node = ifElseNextNode(node);
+      processChain(node->left_node, nullptr);
+      processChain(node->right_node, next_node);
+      node = next_node;
+    } else {
+      processChain(node->left_node, nullptr);
+      node = node->right_node;
+    }
+  }
+}
+
+/**
+ * Moves invariant expressions of loop body to the end of commands of loop condition node. Expressions already
+ * hoisted from inner loops are moved together with their variables, other expressions get new variable, shared
+ * by all occurrences of the same expression in the loop.
+ *
+ * @param node loop condition node
+ */
+void LoopInvariantMotion::hoistFromLoop(std::shared_ptr<GraphNode> node) {
+  std::set<std::string> written = subgraphWrittenVariables(node->left_node);
+  // arguments can reference the same variable, so change of any of them can change the others
+  bool arguments_written = false;
+  for(auto & name : written) {
+    auto sym = symbol_table_->findSymbol(name);
+    arguments_written = arguments_written || (sym && sym->type == symbol_type::PROC_ARGUMENT);
+  }
+  std::map<std::string, std::string> hoisted_expressions;
+  std::vector<Command*> preheader_commands;
+  forEachGraphNode(node->left_node, [&](std::shared_ptr<GraphNode> loop_node) {
+    for(int i = 0; i < loop_node->commands.size(); i++) {
+      if(loop_node->commands.at(i)->type != command_type::ASSIGNMENT) {
+        continue;
+      }
+      AssignmentCommand* assignment_command = static_cast<AssignmentCommand*>(loop_node->commands.at(i));
+      DefaultExpression* expression = assignment_command->expression_;
+      VariableContainer** right_operand = expressionRightOperand(expression);
+      if(!right_operand || !isInvariant(expression->var_, written, arguments_written) ||
+          !isInvariant(*right_operand, written, arguments_written)) {
+        continue;
+      }
+      if(assignment_command->left_var_->type == variable_type::VAR &&
+          hoisted_variables_.count(assignment_command->left_var_->getVariableName()) > 0) {
+        preheader_commands.push_back(assignment_command);
+        loop_node->commands.erase(loop_node->commands.begin() + i);
+        i--;
+        continue;
+      }
+      if(!isWorthHoisting(expression)) {
+        continue;
+      }
+      auto hoisted = hoisted_expressions.find(expression->stringify());
+      if(hoisted == hoisted_expressions.end()) {
+        std::string variable_name = createVariable();
+        Variable* hoisted_var = new Variable;
+        hoisted_var->type = variable_type::VAR;
+        hoisted_var->var_name = variable_name;
+        AssignmentCommand* hoisted_command = new AssignmentCommand;
+        hoisted_command->type = command_type::ASSIGNMENT;
+        hoisted_command->left_var_ = hoisted_var;
+        hoisted_command->expression_ = expression;
+        preheader_commands.push_back(hoisted_command);
+        hoisted = hoisted_expressions.insert({expression->stringify(), variable_name}).first;
+      }
+      Variable* hoisted_value = new Variable;
+      hoisted_value->type = variable_type::VAR;
+      hoisted_value->var_name = hoisted->second;
+      DefaultExpression* copy_expression = new DefaultExpression;
+      copy_expression->var_ = hoisted_value;
+      assignment_command->expression_ = copy_expression;
+      stats_->addProcedureCounter(procedure_name_, "expressions_hoisted", 1);
+    }
+  });
+  for(auto comm : preheader_commands) {
+    node->commands.push_back(comm);
+  }
+}
+
+bool LoopInvariantMotion::isInvariant(VariableContainer *var, std::set<std::string> &written, bool arguments_written) {
+  if(var->type == variable_type::R_VAL) {
+    return true;
+  } else if(var->type != variable_type::VAR || written.count(var->getVariableName()) > 0) {
+    return false;
+  }
+  auto sym = symbol_table_->findSymbol(var->getVariableName());
+  return sym->type == symbol_type::VAR || (sym->type == symbol_type::PROC_ARGUMENT && !arguments_written);
+}
+
+// hoisted value can end up in memory, so computation itself has to cost more than loading the value
+bool LoopInvariantMotion::isWorthHoisting(DefaultExpression *expression) {
+  VariableContainer** right_operand = expressionRightOperand(expression);
+  long long int computation_cost = expression->estimatedCost() - estimatedOperandCost(expression->var_) -
+      estimatedOperandCost(*right_operand);
+  return computation_cost > k_estimated_load_cost;
+}
+
+std::string LoopInvariantMotion::createVariable() {
+  // names of source variables can not contain digits, so generated name is unique
+  std::string variable_name = "inv" + std::to_string(hoisted_variables_count_++);
+  Symbol new_symbol;
+  new_symbol.symbol_name = variable_name;
+  new_symbol.type = symbol_type::VAR;
+  new_symbol.initialized = true;
+  new_symbol.mem_start = memory_end_++;
+  new_symbol.length = 1;
+  symbol_table_->addSymbol(new_symbol, 0);
+  hoisted_variables_.insert(variable_name);
+  return variable_name;
+}
@@ -0,0 +1,44 @@
+#ifndef CUSTOMCOMPILER_COMPILER_LOOP_INVARIANT_MOTION_H_
+#define CUSTOMCOMPILER_COMPILER_LOOP_INVARIANT_MOTION_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include "code_generator.h"
+#include "compiler_stats.h"
+
+/**
+ * Loop-invariant code motion on structured flow graphs. Expressions inside loop, which operands are not changed
+ * by the loop, are calculated once before loop condition - commands of loop condition node are executed only on
+ * entering the loop, so they form its preheader. Result is kept in new local variable, that replaces expression
+ * inside the loop, so it can be kept in register by register allocation.
+ *
+ * Only expressions more expensive than loading their result from memory are hoisted (multiplication, division
+ * and modulo without shortcuts), so hoisting pays off even if the new variable does not get a register.
+ * Inner loops are processed first, so expressions invariant in several loops are moved out of all of them.
+ */
+class LoopInvariantMotion {
+ public:
+  explicit LoopInvariantMotion(std::shared_ptr<CompilerStats> stats);
+  // sets first free memory address, used for variables holding hoisted values
+  void setMemoryEnd(size_t memory_end);
+  void run(std::shared_ptr<GraphNode> graph);
+
+ private:
+  std::shared_ptr<SymbolTable> symbol_table_;
+  std::shared_ptr<CompilerStats> stats_;
+  std::string procedure_name_;
+  size_t memory_end_ = 0;
+  int hoisted_variables_count_ = 0;
+  // variables created for hoisted expressions, they are assigned only once
+  std::set<std::string> hoisted_variables_;
+
+  void processChain(std::shared_ptr<GraphNode> node, std::shared_ptr<GraphNode> stop_node);
+  void hoistFromLoop(std::shared_ptr<GraphNode> node);
+  bool isInvariant(VariableContainer* var, std::set<std::string> &written, bool arguments_written);
+  bool isWorthHoisting(DefaultExpression* expression);
+  std::string createVariable();
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_LOOP_INVARIANT_MOTION_H_
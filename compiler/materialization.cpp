@@ -0,0 +1,251 @@
+#include "materialization.h"
+
+namespace {
+typedef std::map<std::string, size_t> RegisterValues;
+
+void setValue(RegisterValues &values, const std::string &reg, bool known, size_t value) {
+  if(known && value < k_max_tracked_value) {
+    values[reg] = value;
+  } else {
+    values.erase(reg);
+  }
+}
+
+/**
+ * Updates known values of registers after execution of instruction. Loaded and read values are unknown,
+ * after unconditional jump nothing is known, as next instruction is reached from other place of code.
+ */
+void simulateInstruction(const Instruction &instr, RegisterValues &values) {
+  bool reg_known = values.count(instr.reg) > 0;
+  size_t reg_value = reg_known ? values.at(instr.reg) : 0;
+  bool acc_known = values.count("a") > 0;
+  size_t acc_value = acc_known ? values.at("a") : 0;
+  switch(instr.code) {
+    case instruction_code::RST:
+      setValue(values, instr.reg, true, 0);
+      break;
+    case instruction_code::INC:
+      setValue(values, instr.reg, reg_known, reg_value + 1);
+      break;
+    case instruction_code::DEC:
+      setValue(values, instr.reg, reg_known, reg_value > 0 ? reg_value - 1 : 0);
+      break;
+    case instruction_code::SHL:
+      setValue(values, instr.reg, reg_known, reg_value * 2);
+      break;
+    case instruction_code::SHR:
+      setValue(values, instr.reg, reg_known, reg_value / 2);
+      break;
+    case instruction_code::GET:
+      setValue(values, "a", reg_known, reg_value);
+      break;
+    case instruction_code::PUT:
+      setValue(values, instr.reg, acc_known, acc_value);
+      break;
+    case instruction_code::ADD:
+      setValue(values, "a", acc_known && reg_known, acc_value + reg_value);
+      break;
+    case instruction_code::SUB:
+      setValue(values, "a", acc_known && reg_known, acc_value > reg_value ? acc_value - reg_value : 0);
+      break;
+    case instruction_code::LOAD:
+    case instruction_code::READ:
+      values.erase("a");
+      break;
+    case instruction_code::STRK:
+      values.erase(instr.reg);
+      break;
+    case instruction_code::JUMP:
+    case instruction_code::JUMPR:
+    case instruction_code::HALT:
+      values.clear();
+      break;
+    default:
+      break;
+  }
+}
+
+long long int sequenceCost(const std::vector<Instruction> &code) {
+  long long int cost = 0;
+  for(auto & instr : code) {
+    cost += instructionCost(instr.code);
+  }
+  return cost;
+}
+
+/**
+ * Appends cheapest code changing register from known value to constant. Value is moved by INC or DEC
+ * to the constant shifted right, then shifted back with INC for every set bit.
+ *
+ * @return false if constant is too far from known value
+ */
+bool appendAdjustment(std::vector<Instruction> &code, const std::string &reg, size_t from, size_t constant) {
+  long long int best_cost = -1;
+  int best_shift = 0;
+  for(int shift = 0; shift < 64 && (shift == 0 || (constant >> shift) > 0); shift++) {
+    size_t start = constant >> shift;
+    size_t distance = start > from ? start - from : from - start;
+    if(distance > k_max_value_adjustment) {
+      continue;
+    }
+    long long int cost = distance * instructionCost(start > from ? instruction_code::INC : instruction_code::DEC) +
+        shift * instructionCost(instruction_code::SHL);
+    for(int bit = 0; bit < shift; bit++) {
+      if((constant >> bit) & 1) {
+        cost += instructionCost(instruction_code::INC);
+      }
+    }
+    if(best_cost < 0 || cost < best_cost) {
+      best_cost = cost;
+      best_shift = shift;
+    }
+  }
+  if(best_cost < 0) {
+    return false;
+  }
+  size_t start = constant >> best_shift;
+  instruction_code step = start > from ? instruction_code::INC : instruction_code::DEC;
+  for(size_t distance = start > from ? start - from : from - start; distance > 0; distance--) {
+    code.push_back({step, reg});
+  }
+  for(int bit = best_shift - 1; bit >= 0; bit--) {
+    code.push_back({instruction_code::SHL, reg});
+    if((constant >> bit) & 1) {
+      code.push_back({instruction_code::INC, reg});
+    }
+  }
+  return true;
+}
+
+// accumulator value set in code ending before given line is overwritten before being read
+bool accumulatorOverwritten(const std::vector<Instruction> &code, long long int line) {
+  if(line >= code.size()) {
+    return false;
+  }
+  const Instruction &instr = code.at(line);
+  switch(instr.code) {
+    case instruction_code::LOAD:
+    case instruction_code::GET:
+      return instr.reg != "a";
+    case instruction_code::RST:
+      return instr.reg == "a";
+    case instruction_code::READ:
+      return true;
+    default:
+      return false;
+  }
+}
+}  // namespace
+
+ConstantMaterialization::ConstantMaterialization(std::shared_ptr<CompilerStats> stats) : stats_(stats) {
+}
+
+std::vector<std::string> ConstantMaterialization::run(std::vector<std::string> lines) {
+  std::vector<Instruction> code;
+  for(auto & line : lines) {
+    Instruction instr;
+    if(!parseInstruction(line, instr)) {
+      return lines;
+    }
+    code.push_back(instr);
+  }
+  deriveConstants(code);
+  std::vector<std::string> result;
+  for(auto & instr : code) {
+    result.push_back(instructionToString(instr));
+  }
+  return result;
+}
+
+/**
+ * Finds every constant built from zero, RST followed by SHL and INC of the same register without jump target
+ * inside, and replaces it with cheapest code deriving the constant from known values of registers.
+ */
+void ConstantMaterialization::deriveConstants(std::vector<Instruction> &code) {
+  std::vector<bool> targets = findJumpTargets(code);
+  std::vector<std::vector<Instruction>> replacements(code.size());
+  RegisterValues values;
+  bool changed = false;
+  long long int line = 0;
+  while(line < code.size()) {
+    if(targets.at(line)) {
+      values.clear();
+    }
+    const Instruction &instr = code.at(line);
+    long long int end = line + 1;
+    if(instr.code == instruction_code::RST) {
+      size_t constant = 0;
+      while(end < code.size() && !targets.at(end) && code.at(end).reg == instr.reg &&
+          (code.at(end).code == instruction_code::INC || code.at(end).code == instruction_code::SHL) &&
+          constant < k_max_tracked_value / 2) {
+        constant = code.at(end).code == instruction_code::INC ? constant + 1 : constant * 2;
+        end++;
+      }
+      std::vector<Instruction> materialization(code.begin() + line, code.begin() + end);
+      if(cheapestMaterialization(code, line, end, constant, values, materialization)) {
+        if(!materialization.empty()) {
+          materialization.front().comment = instr.comment;
+        }
+        stats_->addCounter("constants_derived", 1);
+        changed = true;
+      }
+      for(auto & materialization_instr : materialization) {
+        simulateInstruction(materialization_instr, values);
+      }
+      replacements.at(line) = materialization;
+      line = end;
+      continue;
+    }
+    simulateInstruction(instr, values);
+    replacements.at(line).push_back(instr);
+    line++;
+  }
+  if(changed) {
+    code = replaceInstructions(code, replacements);
+  }
+}
+
+/**
+ * Chooses cheapest code setting register to constant built by instructions from begin to end. Constant can be
+ * derived from previous value of the register or, when accumulator is not read after the constant, in
+ * accumulator from value of any known register and copied by PUT.
+ *
+ * @return whether cheaper derivation was found and replaced original instructions in best
+ */
+bool ConstantMaterialization::cheapestMaterialization(const std::vector<Instruction> &code, long long int begin,
+                                                      long long int end, size_t constant,
+                                                      const RegisterValues &values, std::vector<Instruction> &best) {
+  const std::string &reg = code.at(begin).reg;
+  long long int best_cost = sequenceCost(best);
+  bool found = false;
+  auto consider = [&](const std::vector<Instruction> &candidate) {
+    long long int cost = sequenceCost(candidate);
+    if(cost < best_cost || (cost == best_cost && candidate.size() < best.size())) {
+      best = candidate;
+      best_cost = cost;
+      found = true;
+    }
+  };
+  std::vector<Instruction> candidate;
+  if(values.count(reg) > 0 && appendAdjustment(candidate, reg, values.at(reg), constant)) {
+    consider(candidate);
+  }
+  bool derive_in_accumulator = reg == "a" || accumulatorOverwritten(code, end);
+  for(auto & known : values) {
+    if(!derive_in_accumulator || known.first == reg) {
+      continue;
+    }
+    candidate.clear();
+    if(known.first != "a") {
+      candidate.push_back({instruction_code::GET, known.first});
+    }
+    if(!appendAdjustment(candidate, "a", known.second, constant)) {
+      continue;
+    }
+    if(reg != "a") {
+      candidate.push_back({instruction_code::PUT, reg});
+    }
+    consider(candidate);
+  }
+  return found;
+}
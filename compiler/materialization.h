@@ -0,0 +1,38 @@
+#ifndef CUSTOMCOMPILER_COMPILER_MATERIALIZATION_H_
+#define CUSTOMCOMPILER_COMPILER_MATERIALIZATION_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "compiler_stats.h"
+#include "instruction.h"
+
+// register values from this one up are treated as unknown, so derived constants never overflow
+const size_t k_max_tracked_value = 1ULL << 62;
+// longest run of INC or DEC instructions used to move known value towards constant
+const size_t k_max_value_adjustment = 64;
+
+/**
+ * Planner of constants built in final code of whole program, run after block layout and before peephole
+ * optimizer. Values of registers are followed through the code and forgotten at jump targets and after
+ * unconditional jumps. Constant built from zero by RST followed by SHL and INC instructions is derived instead
+ * from register already holding close value, when it is cheaper: in place from previous value of the register,
+ * or in accumulator from any known register, when accumulator is overwritten right after the constant.
+ */
+class ConstantMaterialization {
+ public:
+  explicit ConstantMaterialization(std::shared_ptr<CompilerStats> stats);
+  // returns changed code, code that can not be parsed is returned unchanged
+  std::vector<std::string> run(std::vector<std::string> lines);
+
+ private:
+  std::shared_ptr<CompilerStats> stats_;
+
+  void deriveConstants(std::vector<Instruction> &code);
+  bool cheapestMaterialization(const std::vector<Instruction> &code, long long int begin, long long int end,
+                               size_t constant, const std::map<std::string, size_t> &values,
+                               std::vector<Instruction> &best);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_MATERIALIZATION_H_
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include "memory_layout.h"
+#include "cost_model.h"
+#include "flow_analysis.h"
+#include "profile.h"
+
+namespace {
+// limit of estimated executions, to avoid overflow in deeply nested loops and procedures called in loops
+const long long int k_max_frequency = 1000000000;
+
+// cost of generating address in register, the same as cost of generating constant operand
+long long int addressCost(size_t address) {
+  RValue value;
+  value.type = variable_type::R_VAL;
+  value.value = address;
+  return estimatedOperandCost(&value);
+}
+}  // namespace
+
+MemoryLayout::MemoryLayout(std::shared_ptr<CompilerStats> stats) : stats_(stats) {
+}
+
+void MemoryLayout::run(FlowGraphs &graphs) {
+  accesses_.clear();
+  executions_.clear();
+  register_arguments_.clear();
+  for(auto graph : graphs) {
+    for(auto & allocation : graph->allocated_registers) {
+      auto sym = graph->symbol_table->findSymbol(allocation.first);
+      if(sym->value_argument) {
+        register_arguments_.insert(sym);
+      }
+    }
+  }
+  for(int i = graphs.size() - 1; i >= 0; i--) {
+    auto graph = graphs.at(i);
+    symbol_table_ = graph->symbol_table;
+    long long int executions = graph->proc_name.empty() ? 1 : executions_[graph->proc_name];
+    auto jump_back_symbol = symbol_table_->getProcedureJumpBackMemoryAddressSymbol();
+    if(jump_back_symbol && graph->return_address_register.empty()) {
+      accesses_[memorySymbol(jump_back_symbol)] += 2 * executions;
+    }
+    in_registers_.clear();
+    for(auto & allocation : graph->allocated_registers) {
+      if(register_arguments_.count(symbol_table_->findSymbol(allocation.first)) == 0) {
+        addAccesses(allocation.first, 2 * executions);
+      }
+      in_registers_.insert(allocation.first);
+    }
+    countAccesses(graph, executions, nullptr);
+  }
+
+  // symbols in declaration order, so symbols with the same number of accesses keep their order
+  std::vector<std::pair<std::shared_ptr<Symbol>, std::string>> scalars;
+  std::vector<std::pair<std::shared_ptr<Symbol>, std::string>> arrays;
+  std::vector<std::shared_ptr<Symbol>> shared_memory_symbols;
+  std::set<std::shared_ptr<Symbol>> placed_symbols;
+  for(auto graph : graphs) {
+    std::string procedure_name = graph->proc_name.empty() ? k_main_procedure_name : graph->proc_name;
+    for(auto sym : graph->symbol_table->getSymbols()) {
+      if(sym->memory_owner) {
+        shared_memory_symbols.push_back(sym);
+      }
+      // owner of memory can belong to procedure removed after cloning or to other procedure of overlaid frames,
+      // then it is placed with its first user
+      auto memory_sym = memorySymbol(sym);
+      if(!placed_symbols.insert(memory_sym).second) {
+        continue;
+      }
+      if(memory_sym->type == symbol_type::ARR) {
+        arrays.push_back({memory_sym, procedure_name});
+      } else {
+        scalars.push_back({memory_sym, procedure_name});
+      }
+    }
+  }
+  auto more_accessed = [this](const std::pair<std::shared_ptr<Symbol>, std::string> &first,
+                              const std::pair<std::shared_ptr<Symbol>, std::string> &second) {
+    return accesses_[first.first] > accesses_[second.first];
+  };
+  std::stable_sort(scalars.begin(), scalars.end(), more_accessed);
+  std::stable_sort(arrays.begin(), arrays.end(), more_accessed);
+
+  std::vector<size_t> addresses(scalars.size());
+  for(size_t i = 0; i < addresses.size(); i++) {
+    addresses.at(i) = i;
+  }
+  std::stable_sort(addresses.begin(), addresses.end(), [](size_t first, size_t second) {
+    return addressCost(first) < addressCost(second);
+  });
+  auto relocate = [this](std::pair<std::shared_ptr<Symbol>, std::string> &symbol, size_t address) {
+    if(symbol.first->mem_start != address) {
+      stats_->addProcedureCounter(symbol.second, "symbols_relocated", 1);
+    }
+    symbol.first->mem_start = address;
+  };
+  for(size_t i = 0; i < scalars.size(); i++) {
+    relocate(scalars.at(i), addresses.at(i));
+  }
+  size_t memory_end = scalars.size();
+  for(auto & array : arrays) {
+    relocate(array, memory_end);
+    memory_end += array.first->length;
+  }
+  for(auto sym : shared_memory_symbols) {
+    sym->mem_start = memorySymbol(sym)->mem_start;
+  }
+}
+
+void MemoryLayout::countAccesses(std::shared_ptr<GraphNode> node,
+                                 long long int frequency,
+                                 std::shared_ptr<GraphNode> stop_node) {
+  while(node && node != stop_node) {
+    frequency = profiledExecutions(node, frequency);
+    for(auto comm : node->commands) {
+      countCommandAccesses(comm, frequency);
+    }
+    if(!node->cond) {
+      node = node->right_node;
+      continue;
+    }
+    condition_node_kind kind = conditionNodeKind(node);
+    long long int condition_frequency = kind == condition_node_kind::LOOP ?
+        std::min(frequency * k_default_trip_count, k_max_frequency) : frequency;
+    condition_frequency = profiledConditionExecutions(node, condition_frequency);
+    std::set<std::string> outer_registers = in_registers_;
+    if(kind == condition_node_kind::LOOP) {
+      // values kept in registers during loop are loaded before it and stored after it
+      for(auto & allocation : node->loop_allocated_registers) {
+        addAccesses(allocation.first, 2 * frequency);
+        in_registers_.insert(allocation.first);
+      }
+      for(auto & allocation : node->loop_array_registers) {
+        addAccesses(allocation.first, frequency);
+        in_registers_.insert(allocation.first);
+      }
+    }
+    addAccesses(node->cond->left_var_, condition_frequency);
+    addAccesses(node->cond->right_var_, condition_frequency);
+    if(kind == condition_node_kind::LOOP) {
+      countAccesses(node->left_node, condition_frequency, nullptr);
+      in_registers_ = outer_registers;
+      node = node->right_node;
+    } else if(kind == condition_node_kind::IF_ELSE) {
+      auto next_node = ifElseNextNode(node);
+      countAccesses(node->left_node, frequency, nullptr);
+      countAccesses(node->right_node, frequency, next_node);
+      node = next_node;
+    } else {
+      countAccesses(node->left_node, frequency, nullptr);
+      node = node->right_node;
+    }
+  }
+}
+
+void MemoryLayout::countCommandAccesses(Command* comm, long long int frequency) {
+  for(auto value : commandAccessedValues(comm)) {
+    addAccesses(value, frequency);
+  }
+  if(comm->type != command_type::PROC_CALL) {
+    return;
+  }
+  // address or value of every argument is stored in memory of called procedure, unless it is passed in register
+  ProcedureCallCommand* procedure_call_command = static_cast<ProcedureCallCommand*>(comm);
+  for(auto & arg : procedure_call_command->proc_call_.args) {
+    addAccesses(arg.name, frequency);
+    if(register_arguments_.count(arg.target_variable_symbol) == 0 && !arg.target_variable_symbol->bound_array_argument) {
+      accesses_[memorySymbol(arg.target_variable_symbol)] += frequency;
+    }
+  }
+  long long int &executions = executions_[procedure_call_command->proc_call_.name];
+  executions = std::min(executions + frequency, k_max_frequency);
+}
+
+void MemoryLayout::addAccesses(VariableContainer* value, long long int frequency) {
+  if(value->type == variable_type::R_VAL) {
+    return;
+  }
+  addAccesses(value->getVariableName(), frequency);
+  if(value->type == variable_type::VARIABLE_INDEXED_ARR) {
+    addAccesses(value->getIndexVariableName(), frequency);
+  }
+}
+
+void MemoryLayout::addAccesses(std::string name, long long int frequency) {
+  if(in_registers_.count(name) > 0) {
+    return;
+  }
+  auto sym = symbol_table_->findSymbol(name);
+  if(sym) {
+    accesses_[memorySymbol(sym)] += frequency;
+  }
+}
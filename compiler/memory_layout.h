@@ -0,0 +1,47 @@
+#ifndef CUSTOMCOMPILER_COMPILER_MEMORY_LAYOUT_H_
+#define CUSTOMCOMPILER_COMPILER_MEMORY_LAYOUT_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include "code_generator.h"
+#include "compiler_stats.h"
+
+/**
+ * Assigns memory addresses of symbols of all procedures, replacing addresses given in declaration order.
+ * Every access generates address of symbol from zero, with cost depending on number and positions of its set bits,
+ * so scalars are sorted by estimated number of accesses and the most used ones get the cheapest addresses.
+ * Arrays are placed above all scalars, the most used first.
+ *
+ * Accesses are weighted by loop nesting or by counts of profile, procedure is executed as many times as it is
+ * called. Procedures can call only procedures declared before them and main program is the last graph, so graphs
+ * are visited backwards and number of executions of procedure is known before visiting it. Call stores address of every argument
+ * in memory of called procedure and procedure stores and loads its return address, unless they are kept in registers. Layout is done after register
+ * allocation, so uses of values kept in registers are replaced by loading and storing them around their procedure
+ * or loop. Symbols of procedure clones and of overlaid frames use memory of other symbols, so their accesses are
+ * counted for owner of the memory and they get its address after placement.
+ */
+class MemoryLayout {
+ public:
+  explicit MemoryLayout(std::shared_ptr<CompilerStats> stats);
+  void run(FlowGraphs &graphs);
+
+ private:
+  std::shared_ptr<CompilerStats> stats_;
+  std::shared_ptr<SymbolTable> symbol_table_;
+  std::map<std::shared_ptr<Symbol>, long long int> accesses_;
+  // estimated executions of procedures, by procedure name
+  std::map<std::string, long long int> executions_;
+  // variables and arrays kept in registers in currently visited part of procedure, their accesses are not counted
+  std::set<std::string> in_registers_;
+  // arguments passed by value in registers, their memory is not used by calls
+  std::set<std::shared_ptr<Symbol>> register_arguments_;
+
+  void countAccesses(std::shared_ptr<GraphNode> node, long long int frequency, std::shared_ptr<GraphNode> stop_node);
+  void countCommandAccesses(Command* comm, long long int frequency);
+  void addAccesses(VariableContainer* value, long long int frequency);
+  void addAccesses(std::string name, long long int frequency);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_MEMORY_LAYOUT_H_
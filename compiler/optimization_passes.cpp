@@ -0,0 +1,283 @@
+#include "optimization_passes.h"
+#include "calling_convention.h"
+#include "constant_propagation.h"
+#include "frame_overlay.h"
+#include "liveness.h"
+#include "loop_invariant_motion.h"
+#include "memory_layout.h"
+#include "peephole.h"
+#include "register_allocation.h"
+
+namespace {
+void forEachAssignment(FlowGraphs &graphs, std::function<void(AssignmentCommand*)> visitor) {
+  for(auto graph : graphs) {
+    forEachGraphNode(graph, [&visitor](std::shared_ptr<GraphNode> node) {
+      for(auto comm : node->commands) {
+        if(comm->type == command_type::ASSIGNMENT) {
+          visitor(static_cast<AssignmentCommand*>(comm));
+        }
+      }
+    });
+  }
+}
+
+// x + c and x - c with small constant c are calculated with chain of INC/DEC instructions
+void enableIncrementShortcuts(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  forEachAssignment(graphs, [](AssignmentCommand* command) {
+    command->expression_->increment_shortcut_enabled_ = true;
+  });
+}
+
+// multiplication, division and modulo by 0, 1, 2 and powers of two are calculated with shifts
+void enableShiftShortcuts(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  forEachAssignment(graphs, [](AssignmentCommand* command) {
+    command->expression_->shift_shortcut_enabled_ = true;
+  });
+}
+
+// multiplication by other constants is calculated with straight-line chain of shifts, additions and subtractions
+void enableMultiplicationChains(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  forEachAssignment(graphs, [](AssignmentCommand* command) {
+    command->expression_->multiplication_chain_enabled_ = true;
+  });
+}
+
+// division and modulo by other constants are calculated from reciprocal of divisor, without division loop
+void enableReciprocalDivisions(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  forEachAssignment(graphs, [](AssignmentCommand* command) {
+    command->expression_->reciprocal_division_enabled_ = true;
+  });
+}
+
+void passArgumentsByValue(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  CallingConvention calling_convention(stats);
+  calling_convention.run(graphs);
+}
+
+void propagateConstants(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  ConstantPropagation constant_propagation(stats);
+  for(auto graph : graphs) {
+    constant_propagation.run(graph);
+  }
+}
+
+// variables for hoisted values are placed after memory of all procedures
+void hoistLoopInvariants(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  size_t memory_end = 0;
+  for(auto graph : graphs) {
+    for(auto sym : graph->symbol_table->getSymbols()) {
+      memory_end = std::max(memory_end, sym->mem_start + sym->length);
+    }
+  }
+  LoopInvariantMotion loop_invariant_motion(stats);
+  loop_invariant_motion.setMemoryEnd(memory_end);
+  for(auto graph : graphs) {
+    loop_invariant_motion.run(graph);
+  }
+}
+
+// liveness is stored in graph nodes and used during code generation to skip stores of dead values
+void computeLiveness(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  LivenessAnalysis liveness;
+  for(auto graph : graphs) {
+    liveness.run(graph);
+  }
+}
+
+// removed assignment can be the only read of other variables, so liveness is computed until nothing changes
+void removeDeadAssignments(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  LivenessAnalysis liveness;
+  for(auto graph : graphs) {
+    std::string procedure_name = graph->proc_name.empty() ? k_main_procedure_name : graph->proc_name;
+    bool removed = true;
+    while(removed) {
+      removed = false;
+      liveness.run(graph);
+      forEachGraphNode(graph, [&](std::shared_ptr<GraphNode> node) {
+        for(int i = node->commands.size() - 1; i >= 0; i--) {
+          if(node->commands.at(i)->type != command_type::ASSIGNMENT) {
+            continue;
+          }
+          auto left_var = static_cast<AssignmentCommand*>(node->commands.at(i))->left_var_;
+          if(left_var->type == variable_type::VAR && liveness.isTrackedVariable(left_var->getVariableName()) &&
+              node->live_after_commands_.at(i).count(left_var->getVariableName()) == 0) {
+            node->commands.erase(node->commands.begin() + i);
+            node->live_after_commands_.erase(node->live_after_commands_.begin() + i);
+            stats->addProcedureCounter(procedure_name, "dead_assignments_removed", 1);
+            removed = true;
+          }
+        }
+      });
+    }
+  }
+}
+
+/**
+ * Checks, whether second command assigns the other result of division calculated by first command. Operands
+ * can not be changed by first command, also through procedure arguments pointing to the same variable.
+ * Division and modulo by powers of two calculated with shifts are cheaper than taking the kept result.
+ */
+bool canCombineDivisions(AssignmentCommand* first, AssignmentCommand* second, std::shared_ptr<SymbolTable> symbols) {
+  VariableContainer *dividend = nullptr;
+  VariableContainer *divisor = nullptr;
+  if(auto divide = dynamic_cast<DivideExpression*>(first->expression_)) {
+    auto modulo = dynamic_cast<ModuloExpression*>(second->expression_);
+    if(!modulo || modulo->var_->stringify() != divide->var_->stringify() ||
+        modulo->right_var_->stringify() != divide->right_var_->stringify()) {
+      return false;
+    }
+    dividend = divide->var_;
+    divisor = divide->right_var_;
+  } else if(auto modulo = dynamic_cast<ModuloExpression*>(first->expression_)) {
+    auto divide = dynamic_cast<DivideExpression*>(second->expression_);
+    if(!divide || modulo->var_->stringify() != divide->var_->stringify() ||
+        modulo->right_var_->stringify() != divide->right_var_->stringify()) {
+      return false;
+    }
+    dividend = modulo->var_;
+    divisor = modulo->right_var_;
+  } else {
+    return false;
+  }
+  bool argument_operand = false;
+  for(auto operand : {dividend, divisor}) {
+    if(operand->type != variable_type::VAR && operand->type != variable_type::R_VAL) {
+      return false;
+    }
+    if(operand->type == variable_type::VAR) {
+      if(first->left_var_->type == variable_type::VAR &&
+          first->left_var_->getVariableName() == operand->getVariableName()) {
+        return false;
+      }
+      argument_operand = argument_operand ||
+          symbols->findSymbol(operand->getVariableName())->type == symbol_type::PROC_ARGUMENT;
+    }
+  }
+  if(argument_operand && first->left_var_->type == variable_type::VAR &&
+      symbols->findSymbol(first->left_var_->getVariableName())->type == symbol_type::PROC_ARGUMENT) {
+    return false;
+  }
+  if(divisor->type == variable_type::R_VAL && dividend->type != variable_type::R_VAL &&
+      first->expression_->shift_shortcut_enabled_ &&
+      (divisor->getValue() == 0 || first->expression_->isPowerOfTwo(divisor->getValue()))) {
+    return false;
+  }
+  return true;
+}
+
+// quotient and remainder of the same operands assigned by consecutive commands are calculated by one division loop
+void combineDivisions(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  for(auto graph : graphs) {
+    std::string procedure_name = graph->proc_name.empty() ? k_main_procedure_name : graph->proc_name;
+    forEachGraphNode(graph, [&](std::shared_ptr<GraphNode> node) {
+      for(int i = 0; i + 1 < node->commands.size(); i++) {
+        if(node->commands.at(i)->type != command_type::ASSIGNMENT ||
+            node->commands.at(i + 1)->type != command_type::ASSIGNMENT) {
+          continue;
+        }
+        auto first = static_cast<AssignmentCommand*>(node->commands.at(i));
+        auto second = static_cast<AssignmentCommand*>(node->commands.at(i + 1));
+        if(!canCombineDivisions(first, second, graph->symbol_table)) {
+          continue;
+        }
+        // name of kept result can not be confused with any variable
+        Variable *kept_result = new Variable;
+        kept_result->type = variable_type::VAR;
+        kept_result->var_name = second->expression_->stringify();
+        first->expression_->kept_result_ = kept_result;
+        first->expression_->keeps_result_ = true;
+        second->expression_->kept_result_ = kept_result;
+        stats->addProcedureCounter(procedure_name, "divisions_combined", 1);
+        i++;
+      }
+    });
+  }
+}
+
+void overlayFrames(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  FrameOverlay frame_overlay(stats);
+  frame_overlay.run(graphs);
+}
+
+void layOutMemory(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  MemoryLayout memory_layout(stats);
+  memory_layout.run(graphs);
+}
+
+void allocateRegisters(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  RegisterAllocation register_allocation(stats);
+  for(auto graph : graphs) {
+    register_allocation.run(graph);
+  }
+}
+}  // namespace
+
+void registerOptimizationPasses(PassManager &pass_manager) {
+  // inlining is performed by compiler on commands of procedures, before flow graphs are generated
+  pass_manager.registerPass({"inline-procedures",
+                             "replace calls by bodies of procedures, if saved call cost exceeds code size growth",
+                             2, false, {}, nullptr});
+  // cloning is performed by compiler on commands of procedures left after inlining
+  pass_manager.registerPass({"clone-procedures",
+                             "specialize procedures for arrays and constants passed by callers, accessing bound arrays directly",
+                             2, false, {}, nullptr});
+  // arguments passed by value are local variables for all following passes
+  pass_manager.registerPass({"register-arguments",
+                             "pass scalar arguments by value, in registers of called procedure, instead of by address",
+                             2, true, {}, passArgumentsByValue});
+  pass_manager.registerPass({"constant-propagation",
+                             "replace variables with known values by constants, fold constant expressions and conditions",
+                             2, true, {}, propagateConstants});
+  pass_manager.registerPass({"increment-constants",
+                             "add and subtract small constants with INC/DEC chains",
+                             1, false, {}, enableIncrementShortcuts});
+  pass_manager.registerPass({"shift-constants",
+                             "multiply, divide and take modulo by powers of two with shifts",
+                             1, true, {}, enableShiftShortcuts});
+  pass_manager.registerPass({"multiply-constants",
+                             "multiply by other constants with the cheapest chain of shifts, additions and subtractions",
+                             1, true, {}, enableMultiplicationChains});
+  pass_manager.registerPass({"divide-constants",
+                             "divide and take modulo by other constants with shifted sums approximating reciprocal",
+                             1, false, {}, enableReciprocalDivisions});
+  pass_manager.registerPass({"loop-invariant-motion",
+                             "calculate expensive expressions with operands not changed by loop once, before the loop",
+                             2, false, {}, hoistLoopInvariants});
+  // passes changing flow graphs should be registered above, so liveness describes final graphs
+  pass_manager.registerPass({"liveness",
+                             "skip storing values of variables, that are overwritten before being read",
+                             2, true, {}, computeLiveness});
+  pass_manager.registerPass({"dead-assignments",
+                             "remove assignments to variables, that are never read later",
+                             2, true, {"liveness"}, removeDeadAssignments});
+  // commands can be removed by dead-assignments, so divisions are combined after it
+  pass_manager.registerPass({"combine-divisions",
+                             "calculate quotient and remainder of the same operands with one division loop",
+                             1, true, {}, combineDivisions});
+  pass_manager.registerPass({"register-allocation",
+                             "keep most used local variables in registers for whole procedure, by graph coloring",
+                             2, true, {"liveness"}, allocateRegisters});
+  // locals are overlaid only if liveness shows, that they are written before being read in every call
+  pass_manager.registerPass({"overlay-frames",
+                             "share memory of arguments and locals of procedures, which are never active at the same time",
+                             1, true, {}, overlayFrames});
+  // accesses of variables kept in registers by register-allocation are not counted
+  pass_manager.registerPass({"memory-layout",
+                             "place most accessed variables at addresses, which are the cheapest to generate",
+                             1, true, {}, layOutMemory});
+  // layout of final code, checked by compiler after code generation
+  pass_manager.registerPass({"jump-threading",
+                             "redirect jumps to unconditional jumps to their final targets, remove unreachable code",
+                             1, true, {}, nullptr});
+  pass_manager.registerPass({"loop-rotation",
+                             "replace jump back to loop condition with inverted copy of the condition",
+                             2, false, {}, nullptr});
+  pass_manager.registerPass({"derive-constants",
+                             "derive constants in final code from registers already holding close values",
+                             1, true, {}, nullptr});
+  // patterns of peephole optimizer of final code, checked by compiler after code generation
+  for(auto & pattern : peepholePatterns()) {
+    pass_manager.registerPass({k_peephole_pass_prefix + pattern.name, "peephole: remove " + pattern.description,
+                               1, true, {}, nullptr});
+  }
+}
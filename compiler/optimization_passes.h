@@ -0,0 +1,13 @@
+#ifndef CUSTOMCOMPILER_COMPILER_OPTIMIZATION_PASSES_H_
+#define CUSTOMCOMPILER_COMPILER_OPTIMIZATION_PASSES_H_
+
+#include <string>
+#include "pass_manager.h"
+
+// prefix of names of passes enabling single patterns of peephole optimizer
+const std::string k_peephole_pass_prefix = "peephole-";
+
+// registers all optimization passes of the compiler in pass manager
+void registerOptimizationPasses(PassManager &pass_manager);
+
+#endif  // CUSTOMCOMPILER_COMPILER_OPTIMIZATION_PASSES_H_
@@ -61,7 +61,7 @@ std::shared_ptr<Compiler> compiler;
  * add optimizations in translation phase
  */
 
-program_all  : procedures main { compiler->compile(); }
+program_all  : procedures main
              ;
 
 procedures   : procedures PROCEDURE proc_head IS declarations IN commands END { compiler->declareProcedure(*$7); }
@@ -144,21 +144,36 @@ void yyerror( std::string s )
 int main(int argc, char* argv[]) {
     compiler = std::make_shared<Compiler>();
 
-    if(argc != 3) {
-        std::cout << "Bad number of program arguments\n Usage: compiler <input_file_name> <output_file_name>\n";
+    CompilerOptions options;
+    try {
+        options = parseCompilerOptions(argc, argv);
+    } catch(std::runtime_error & e) {
+        std::cout << e.what() << "\n" << compilerUsage();
         return 1;
     }
 
-    yyin = fopen(argv[1], "r");
+    yyin = fopen(options.input_file_name.c_str(), "r");
     if (yyin == NULL){
         std::cout << "Input file does not exist" << std::endl;
         return 1;
     }
 
-    std::string output_file_name = std::string(argv[2]);
-    compiler->setOutputFileName(output_file_name);
+    try {
+        compiler->setOptions(options);
+    } catch(std::runtime_error & e) {
+        std::cout << e.what() << "\n" << compilerUsage();
+        return 1;
+    }
 
-	yyparse();
+    compiler->getStats()->startPhase("parse");
+    int parse_result = yyparse();
+    compiler->getStats()->endPhase("parse");
+    if(parse_result == 0) {
+        bool compile_result = compiler->compile();
+        compiler->reportStats();
+        if(!compile_result) {
+            return 1;
+        }
+    }
     return 0;
 }
-
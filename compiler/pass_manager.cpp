@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+#include "pass_manager.h"
+
+void PassManager::registerPass(Pass pass) {
+  if(findPass(pass.name) != -1) {
+    throw std::runtime_error("Pass " + pass.name + " registered twice");
+  }
+  passes_.push_back(pass);
+}
+
+void PassManager::configure(CompilerOptions options) {
+  for(auto & name : options.enabled_passes) {
+    if(findPass(name) == -1) {
+      throw std::runtime_error("Unknown optimization pass " + name);
+    }
+  }
+  for(auto & name : options.disabled_passes) {
+    if(findPass(name) == -1) {
+      throw std::runtime_error("Unknown optimization pass " + name);
+    }
+  }
+  auto explicitlyDisabled = [&options](std::string name) {
+    return std::find(options.disabled_passes.begin(), options.disabled_passes.end(), name) !=
+        options.disabled_passes.end();
+  };
+  std::vector<bool> enabled;
+  for(auto & pass : passes_) {
+    bool enabled_by_level = options.optimization_level >= pass.min_level &&
+        (!options.optimize_for_size || pass.enabled_for_size);
+    bool enabled_explicitly = std::find(options.enabled_passes.begin(), options.enabled_passes.end(), pass.name) !=
+        options.enabled_passes.end();
+    enabled.push_back((enabled_by_level || enabled_explicitly) && !explicitlyDisabled(pass.name));
+  }
+  // enabled pass enables its dependencies, unless dependency was disabled explicitly - then pass is disabled too
+  bool changed = true;
+  while(changed) {
+    changed = false;
+    for(int i = 0; i < passes_.size(); i++) {
+      if(!enabled.at(i)) {
+        continue;
+      }
+      for(auto & dependency : passes_.at(i).dependencies) {
+        int dependency_index = findPass(dependency);
+        if(dependency_index == -1 || explicitlyDisabled(dependency)) {
+          enabled.at(i) = false;
+          changed = true;
+          break;
+        } else if(!enabled.at(dependency_index)) {
+          enabled.at(dependency_index) = true;
+          changed = true;
+        }
+      }
+    }
+  }
+  enabled_passes_.clear();
+  for(int i = 0; i < passes_.size(); i++) {
+    if(enabled.at(i)) {
+      enabled_passes_.push_back(passes_.at(i).name);
+    }
+  }
+}
+
+bool PassManager::isEnabled(std::string pass_name) {
+  return std::find(enabled_passes_.begin(), enabled_passes_.end(), pass_name) != enabled_passes_.end();
+}
+
+void PassManager::setCostModel(std::shared_ptr<CostModel> cost_model) {
+  cost_model_ = cost_model;
+}
+
+std::vector<Pass> PassManager::getPasses() {
+  return passes_;
+}
+
+void PassManager::runPasses(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats) {
+  results_.clear();
+  long long int cost = cost_model_->estimateFlowGraphs(graphs);
+  for(int i : passesOrder()) {
+    auto & pass = passes_.at(i);
+    if(!isEnabled(pass.name) || !pass.run) {
+      continue;
+    }
+    PassResult result;
+    result.name = pass.name;
+    result.cost_before = cost;
+    stats->startPhase("pass " + pass.name);
+    pass.run(graphs, stats);
+    stats->endPhase("pass " + pass.name);
+    cost = cost_model_->estimateFlowGraphs(graphs);
+    result.cost_after = cost;
+    results_.push_back(result);
+  }
+  stats->addCounter("estimated_flow_graph_cost", cost);
+}
+
+void PassManager::printReport(std::ostream &out) {
+  out << "===== Optimization passes =====" << std::endl;
+  out << std::left << std::setw(28) << "pass" << std::right
+      << std::setw(14) << "cost before"
+      << std::setw(14) << "cost after"
+      << std::setw(12) << "change" << std::endl;
+  for(auto & result : results_) {
+    out << std::left << std::setw(28) << result.name << std::right
+        << std::setw(14) << result.cost_before
+        << std::setw(14) << result.cost_after
+        << std::setw(12) << result.cost_after - result.cost_before << std::endl;
+  }
+  out << "enabled:";
+  for(auto & name : enabled_passes_) {
+    out << " " << name;
+  }
+  out << std::endl;
+}
+
+int PassManager::findPass(std::string pass_name) {
+  for(int i = 0; i < passes_.size(); i++) {
+    if(passes_.at(i).name == pass_name) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+std::vector<int> PassManager::passesOrder() {
+  // registration order, but every pass is placed after its dependencies
+  std::vector<int> order;
+  std::vector<int> state(passes_.size(), 0);
+  std::function<void(int)> visit = [&](int i) {
+    if(state.at(i) == 2) {
+      return;
+    }
+    if(state.at(i) == 1) {
+      throw std::runtime_error("Cyclic dependency of optimization pass " + passes_.at(i).name);
+    }
+    state.at(i) = 1;
+    for(auto & dependency : passes_.at(i).dependencies) {
+      int dependency_index = findPass(dependency);
+      if(dependency_index != -1) {
+        visit(dependency_index);
+      }
+    }
+    state.at(i) = 2;
+    order.push_back(i);
+  };
+  for(int i = 0; i < passes_.size(); i++) {
+    visit(i);
+  }
+  return order;
+}
@@ -0,0 +1,60 @@
+#ifndef CUSTOMCOMPILER_COMPILER_PASS_MANAGER_H_
+#define CUSTOMCOMPILER_COMPILER_PASS_MANAGER_H_
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "code_generator.h"
+#include "compiler_options.h"
+#include "compiler_stats.h"
+#include "cost_model.h"
+#include "flow_analysis.h"
+
+/**
+ * Optimization pass. Passes with run function transform flow graphs before code generation,
+ * passes without it only switch behaviour of code generator, which checks them with PassManager::isEnabled.
+ */
+typedef struct pass {
+  std::string name;
+  std::string description;
+  // lowest optimization level that enables pass
+  int min_level;
+  // whether pass is enabled by -Os, passes increasing code size should not be
+  bool enabled_for_size;
+  // passes that have to run before this pass, enabling pass enables its dependencies
+  std::vector<std::string> dependencies;
+  std::function<void(FlowGraphs&, std::shared_ptr<CompilerStats>)> run;
+} Pass;
+
+typedef struct pass_result {
+  std::string name;
+  long long int cost_before = 0;
+  long long int cost_after = 0;
+} PassResult;
+
+class PassManager {
+ public:
+  void registerPass(Pass pass);
+  // selects passes for options, throws std::runtime_error on unknown pass name
+  void configure(CompilerOptions options);
+  bool isEnabled(std::string pass_name);
+  void setCostModel(std::shared_ptr<CostModel> cost_model);
+  std::vector<Pass> getPasses();
+
+  // runs enabled passes in dependency order, estimating cost of graphs before and after every pass
+  void runPasses(FlowGraphs &graphs, std::shared_ptr<CompilerStats> stats);
+  void printReport(std::ostream &out);
+
+ private:
+  std::vector<Pass> passes_;
+  std::vector<std::string> enabled_passes_;
+  std::vector<PassResult> results_;
+  std::shared_ptr<CostModel> cost_model_ = std::make_shared<CostModel>();
+
+  int findPass(std::string pass_name);
+  std::vector<int> passesOrder();
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_PASS_MANAGER_H_
@@ -0,0 +1,135 @@
+#include "peephole.h"
+
+namespace {
+bool isAccumulatorOverwrite(const Instruction &instr) {
+  return instr.code == instruction_code::GET || (instr.code == instruction_code::RST && instr.reg == "a");
+}
+}  // namespace
+
+const std::vector<PeepholePattern> &peepholePatterns() {
+  static const std::vector<PeepholePattern> patterns{
+      {"put-get", "GET of register just set by PUT", 2,
+       [](const std::vector<Instruction> &code, long long int line) -> std::vector<int> {
+         if(code.at(line).code == instruction_code::PUT && code.at(line + 1).code == instruction_code::GET &&
+             code.at(line).reg == code.at(line + 1).reg) {
+           return {1};
+         }
+         return {};
+       }},
+      {"get-put", "PUT to register just read by GET", 2,
+       [](const std::vector<Instruction> &code, long long int line) -> std::vector<int> {
+         if(code.at(line).code == instruction_code::GET && code.at(line + 1).code == instruction_code::PUT &&
+             code.at(line).reg == code.at(line + 1).reg) {
+           return {1};
+         }
+         return {};
+       }},
+      {"dead-accumulator", "GET or RST a overwritten by next GET or RST a", 2,
+       [](const std::vector<Instruction> &code, long long int line) -> std::vector<int> {
+         // GET a reads accumulator, so value set by first instruction would be used
+         if(isAccumulatorOverwrite(code.at(line)) && isAccumulatorOverwrite(code.at(line + 1)) &&
+             !(code.at(line + 1).code == instruction_code::GET && code.at(line + 1).reg == "a")) {
+           return {0};
+         }
+         return {};
+       }},
+      {"double-reset", "RST of register that was just reset", 2,
+       [](const std::vector<Instruction> &code, long long int line) -> std::vector<int> {
+         if(code.at(line).code == instruction_code::RST && code.at(line + 1).code == instruction_code::RST &&
+             code.at(line).reg == code.at(line + 1).reg) {
+           return {1};
+         }
+         return {};
+       }},
+      {"store-load", "LOAD of value just stored at the same address", 2,
+       [](const std::vector<Instruction> &code, long long int line) -> std::vector<int> {
+         if(code.at(line).code == instruction_code::STORE && code.at(line + 1).code == instruction_code::LOAD &&
+             code.at(line).reg == code.at(line + 1).reg) {
+           return {1};
+         }
+         return {};
+       }},
+      {"jump-next", "JUMP to the next instruction", 1,
+       [](const std::vector<Instruction> &code, long long int line) -> std::vector<int> {
+         if(code.at(line).code == instruction_code::JUMP && code.at(line).target == line + 1) {
+           return {0};
+         }
+         return {};
+       }}};
+  return patterns;
+}
+
+PeepholeOptimizer::PeepholeOptimizer(std::shared_ptr<CompilerStats> stats, std::set<std::string> enabled_patterns)
+    : stats_(stats) {
+  for(auto & pattern : peepholePatterns()) {
+    if(enabled_patterns.count(pattern.name) > 0) {
+      patterns_.push_back(pattern);
+    }
+  }
+}
+
+std::vector<std::string> PeepholeOptimizer::run(std::vector<std::string> lines) {
+  std::vector<Instruction> code;
+  for(auto & line : lines) {
+    Instruction instr;
+    if(!parseInstruction(line, instr)) {
+      return lines;
+    }
+    code.push_back(instr);
+  }
+  while(applyPatterns(code)) {
+  }
+  stats_->addCounter("peephole_removed_instructions", lines.size() - code.size());
+  std::vector<std::string> result;
+  for(auto & instr : code) {
+    result.push_back(instructionToString(instr));
+  }
+  return result;
+}
+
+/**
+ * Single pass of all patterns over the code. Instructions are only marked as removed during the pass, windows
+ * with removed instructions are skipped and matched again in next pass.
+ *
+ * @return whether any instruction was removed
+ */
+bool PeepholeOptimizer::applyPatterns(std::vector<Instruction> &code) {
+  std::vector<bool> targets = findJumpTargets(code);
+  std::vector<bool> removed(code.size(), false);
+  bool changed = false;
+  for(long long int i = 0; i < code.size(); i++) {
+    for(auto & pattern : patterns_) {
+      if(i + pattern.length > code.size()) {
+        continue;
+      }
+      bool window_allowed = true;
+      for(int j = 0; j < pattern.length; j++) {
+        window_allowed = window_allowed && !removed.at(i + j) && (j == 0 || !targets.at(i + j));
+      }
+      if(!window_allowed) {
+        continue;
+      }
+      std::vector<int> removed_positions = pattern.match(code, i);
+      if(removed_positions.empty()) {
+        continue;
+      }
+      for(int position : removed_positions) {
+        removed.at(i + position) = true;
+      }
+      stats_->addCounter("peephole_" + pattern.name, 1);
+      changed = true;
+      break;
+    }
+  }
+  if(!changed) {
+    return false;
+  }
+  std::vector<std::vector<Instruction>> replacements(code.size());
+  for(long long int i = 0; i < code.size(); i++) {
+    if(!removed.at(i)) {
+      replacements.at(i).push_back(code.at(i));
+    }
+  }
+  code = replaceInstructions(code, replacements);
+  return true;
+}
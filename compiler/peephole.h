@@ -0,0 +1,45 @@
+#ifndef CUSTOMCOMPILER_COMPILER_PEEPHOLE_H_
+#define CUSTOMCOMPILER_COMPILER_PEEPHOLE_H_
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "compiler_stats.h"
+#include "instruction.h"
+
+/**
+ * Pattern of peephole optimizer. Pattern matches window of consecutive instructions starting at given line
+ * of code and returns positions of window instructions, that can be removed, empty if window does not match.
+ * Patterns only remove instructions, so execution of code never gets more expensive.
+ */
+typedef struct peephole_pattern {
+  std::string name;
+  std::string description;
+  int length;
+  std::function<std::vector<int>(const std::vector<Instruction> &code, long long int line)> match;
+} PeepholePattern;
+
+const std::vector<PeepholePattern> &peepholePatterns();
+
+/**
+ * Peephole optimizer working on final code of whole program. Patterns are applied until none of them
+ * matches. Window can not contain jump target except its first instruction, so every matched sequence is
+ * executed from its beginning, and targets of jumps are moved after removing instructions. Instruction
+ * following procedure call is target of procedure return, which is relative to STRK instruction of the call.
+ */
+class PeepholeOptimizer {
+ public:
+  PeepholeOptimizer(std::shared_ptr<CompilerStats> stats, std::set<std::string> enabled_patterns);
+  // returns optimized code, code that can not be parsed is returned unchanged
+  std::vector<std::string> run(std::vector<std::string> lines);
+
+ private:
+  std::shared_ptr<CompilerStats> stats_;
+  std::vector<PeepholePattern> patterns_;
+
+  bool applyPatterns(std::vector<Instruction> &code);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_PEEPHOLE_H_
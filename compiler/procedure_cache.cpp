@@ -0,0 +1,84 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include "procedure_cache.h"
+
+namespace {
+const std::string k_fragment_header = "CUSTOMCOMPILER-FRAGMENT 1";
+
+unsigned long long fnv1a(std::string text, unsigned long long seed) {
+  unsigned long long hash = seed;
+  for(unsigned char c : text) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+}  // namespace
+
+ProcedureCache::ProcedureCache(std::string directory) : directory_(directory) {
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+}
+
+std::string ProcedureCache::computeKey(std::string description) {
+  std::stringstream key;
+  key << std::hex << fnv1a(description, 14695981039346656037ULL)
+      << "-" << fnv1a(description, 0x84222325cbf29ce4ULL)
+      << "-" << description.size();
+  return key.str();
+}
+
+bool ProcedureCache::loadFragment(std::string key, std::vector<std::string> &fragment) {
+  std::ifstream f(fragmentPath(key));
+  if(!f.is_open()) {
+    return false;
+  }
+  std::string line;
+  if(!std::getline(f, line) || line != k_fragment_header) {
+    return false;
+  }
+  // second line holds number of instructions, it protects from using partially written fragments
+  size_t fragment_length;
+  if(!std::getline(f, line)) {
+    return false;
+  }
+  try {
+    fragment_length = std::stoull(line);
+  } catch(std::exception & e) {
+    return false;
+  }
+  fragment.clear();
+  while(std::getline(f, line)) {
+    fragment.push_back(line);
+  }
+  if(fragment.size() != fragment_length) {
+    fragment.clear();
+    return false;
+  }
+  return true;
+}
+
+void ProcedureCache::storeFragment(std::string key, std::vector<std::string> fragment) {
+  std::string path = fragmentPath(key);
+  // temporary file is renamed only after whole fragment was written, so concurrent compilations never read partial files
+  std::string tmp_path = path + "." + std::to_string(getpid()) + ".tmp";
+  std::ofstream f(tmp_path);
+  if(!f.is_open()) {
+    return;
+  }
+  f << k_fragment_header << "\n" << fragment.size() << "\n";
+  for(auto & line : fragment) {
+    f << line << "\n";
+  }
+  f.close();
+  if(f.fail() || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+  }
+}
+
+std::string ProcedureCache::fragmentPath(std::string key) {
+  return (std::filesystem::path(directory_) / (key + ".frag")).string();
+}
@@ -0,0 +1,27 @@
+#ifndef CUSTOMCOMPILER_COMPILER_PROCEDURE_CACHE_H_
+#define CUSTOMCOMPILER_COMPILER_PROCEDURE_CACHE_H_
+
+#include <string>
+#include <vector>
+
+/**
+ * Persistent cache of generated procedures code, kept as one file per procedure in given directory.
+ * Fragments are stored in relocatable form - jumps inside of the procedure target "@<offset>"
+ * from procedure start and calls of other procedures target "$<procedure name>".
+ */
+class ProcedureCache {
+ public:
+  explicit ProcedureCache(std::string directory);
+
+  // content hash of procedure description, used as file name of the fragment
+  static std::string computeKey(std::string description);
+  bool loadFragment(std::string key, std::vector<std::string> &fragment);
+  void storeFragment(std::string key, std::vector<std::string> fragment);
+
+ private:
+  std::string directory_;
+
+  std::string fragmentPath(std::string key);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_PROCEDURE_CACHE_H_
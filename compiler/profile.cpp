@@ -0,0 +1,118 @@
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "profile.h"
+#include "cost_model.h"
+#include "flow_analysis.h"
+
+namespace {
+const std::string k_profile_header = "CUSTOMCOMPILER-PROFILE 1";
+
+long long int lineExecutions(const std::vector<long long int> &line_executions, long long int line) {
+  return line >= 0 && line < line_executions.size() ? line_executions.at(line) : -1;
+}
+}  // namespace
+
+void Profile::nameBlocks(FlowGraphs &graphs) {
+  for(auto graph : graphs) {
+    std::string procedure_name = graph->proc_name.empty() ? k_main_procedure_name : graph->proc_name;
+    int block_index = 0;
+    forEachGraphNode(graph, [&](std::shared_ptr<GraphNode> node) {
+      node->profile_block_name_ = blockName(procedure_name, block_index++);
+    });
+  }
+}
+
+Profile Profile::collect(FlowGraphs &graphs, const std::vector<long long int> &line_executions) {
+  Profile profile;
+  for(auto graph : graphs) {
+    forEachGraphNode(graph, [&](std::shared_ptr<GraphNode> node) {
+      if(node->profile_block_name_.empty()) {
+        return;
+      }
+      BlockProfile block;
+      if(!node->commands.empty()) {
+        block.executions = lineExecutions(line_executions, node->start_line_);
+      }
+      if(node->cond) {
+        block.condition_executions = lineExecutions(line_executions, node->condition_start_line_);
+      }
+      if(block.executions >= 0 || block.condition_executions >= 0) {
+        profile.blocks_[node->profile_block_name_] = block;
+      }
+    });
+  }
+  return profile;
+}
+
+Profile Profile::read(std::string file_name) {
+  std::ifstream f(file_name);
+  if(!f.is_open()) {
+    throw std::runtime_error("Cannot open profile file " + file_name);
+  }
+  std::string line;
+  if(!std::getline(f, line) || line != k_profile_header) {
+    throw std::runtime_error("Invalid profile file " + file_name);
+  }
+  Profile profile;
+  while(std::getline(f, line)) {
+    std::stringstream line_stream(line);
+    std::string name;
+    BlockProfile block;
+    if(!(line_stream >> name >> block.executions >> block.condition_executions)) {
+      throw std::runtime_error("Invalid profile file " + file_name + ": " + line);
+    }
+    profile.blocks_[name] = block;
+  }
+  return profile;
+}
+
+void Profile::write(std::string file_name) {
+  std::ofstream f(file_name);
+  if(!f.is_open()) {
+    throw std::runtime_error("Cannot write profile file " + file_name);
+  }
+  f << k_profile_header << "\n";
+  for(auto & block : blocks_) {
+    f << block.first << " " << block.second.executions << " " << block.second.condition_executions << "\n";
+  }
+}
+
+void Profile::apply(FlowGraphs &graphs) {
+  for(auto graph : graphs) {
+    forEachGraphNode(graph, [this](std::shared_ptr<GraphNode> node) {
+      auto block = blocks_.find(node->profile_block_name_);
+      if(block == blocks_.end()) {
+        return;
+      }
+      node->profile_executions_ = block->second.executions;
+      node->profile_condition_executions_ = block->second.condition_executions;
+    });
+  }
+}
+
+bool hasProfile(std::shared_ptr<GraphNode> graph) {
+  bool profiled = false;
+  forEachGraphNode(graph, [&profiled](std::shared_ptr<GraphNode> node) {
+    profiled = profiled || node->profile_executions_ >= 0 || node->profile_condition_executions_ >= 0;
+  });
+  return profiled;
+}
+
+long long int profiledExecutions(std::shared_ptr<GraphNode> node, long long int estimate) {
+  return node->profile_executions_ >= 0 ? node->profile_executions_ : estimate;
+}
+
+long long int profiledConditionExecutions(std::shared_ptr<GraphNode> node, long long int estimate) {
+  return node->profile_condition_executions_ >= 0 ? node->profile_condition_executions_ : estimate;
+}
+
+// condition of loop is checked once more than the loop body runs on every entry
+long long int profiledTripCount(std::shared_ptr<GraphNode> node) {
+  if(node->profile_condition_executions_ < 0 || !node->left_node || node->left_node->profile_executions_ < 0) {
+    return -1;
+  }
+  long long int iterations = node->left_node->profile_executions_;
+  long long int entries = node->profile_condition_executions_ - iterations;
+  return entries > 0 ? iterations / entries : -1;
+}
@@ -0,0 +1,45 @@
+#ifndef CUSTOMCOMPILER_COMPILER_PROFILE_H_
+#define CUSTOMCOMPILER_COMPILER_PROFILE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "code_generator.h"
+
+typedef struct block_profile {
+  long long int executions = -1;
+  long long int condition_executions = -1;
+} BlockProfile;
+
+/**
+ * Execution counts of flow graph blocks, gathered by running program compiled with --profile-gen and used
+ * by compilation with --profile-use. Blocks are named "<procedure>:<preorder index>" in flow graphs built from
+ * source, before optimization passes change them, so names are the same in both compilations of the program.
+ * Counts are taken from executions of first line of commands and of condition of every node, so code is
+ * generated without changes of final code, which move lines.
+ */
+class Profile {
+ public:
+  static void nameBlocks(FlowGraphs &graphs);
+  static Profile collect(FlowGraphs &graphs, const std::vector<long long int> &line_executions);
+  // throws std::runtime_error if file can not be read or is malformed
+  static Profile read(std::string file_name);
+  void write(std::string file_name);
+  // stores counts in nodes of flow graphs with the same block names
+  void apply(FlowGraphs &graphs);
+
+ private:
+  std::map<std::string, BlockProfile> blocks_;
+};
+
+// whether any node of flow graph has counts of profile
+bool hasProfile(std::shared_ptr<GraphNode> graph);
+// executions of commands of node counted by profile, estimate if node has no profile data
+long long int profiledExecutions(std::shared_ptr<GraphNode> node, long long int estimate);
+// executions of condition of node counted by profile, estimate if node has no profile data
+long long int profiledConditionExecutions(std::shared_ptr<GraphNode> node, long long int estimate);
+// average number of iterations of loop counted by profile, -1 if loop or its body has no profile data
+long long int profiledTripCount(std::shared_ptr<GraphNode> node);
+
+#endif  // CUSTOMCOMPILER_COMPILER_PROFILE_H_
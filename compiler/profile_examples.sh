@@ -0,0 +1,27 @@
+#!/bin/bash
+# Profile-guided optimization cycle over example programs. Every program listed in profile_inputs.txt
+# (name followed by values read by the program) is run with --profile-gen on its inputs, then compiled
+# with --profile-use. Costs of runs without and with profile are printed for comparison.
+# Usage: profile_examples.sh [optimization level flag, default -O2] [output directory, default profiles]
+set -e
+compiler_dir=$(cd "$(dirname "$0")" && pwd)
+examples_dir="$compiler_dir/../example_programs"
+level=${1:--O2}
+out_dir=${2:-profiles}
+mkdir -p "$out_dir"
+
+run_cost() {
+  "$compiler_dir/kompilator" "$level" --run --inputs "$@" | sed -n 's/^Program finished (cost: \([0-9]*\);.*/\1/p'
+}
+
+printf "%-16s %14s %14s\n" "program" "cost" "with profile"
+while read -r name inputs; do
+  [ -z "$name" ] && continue
+  echo "$inputs" > "$out_dir/$name.in"
+  source_file="$examples_dir/$name.imp"
+  run_cost "$out_dir/$name.in" --profile-gen "$out_dir/$name.profile" "$source_file" > /dev/null
+  "$compiler_dir/kompilator" "$level" --profile-use "$out_dir/$name.profile" "$source_file" "$out_dir/$name.mr"
+  cost=$(run_cost "$out_dir/$name.in" "$source_file")
+  profiled_cost=$(run_cost "$out_dir/$name.in" --profile-use "$out_dir/$name.profile" "$source_file")
+  printf "%-16s %14s %14s\n" "$name" "$cost" "$profiled_cost"
+done < "$examples_dir/profile_inputs.txt"
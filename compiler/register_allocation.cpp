@@ -0,0 +1,539 @@
+#include <algorithm>
+#include "register_allocation.h"
+#include "cost_model.h"
+#include "flow_analysis.h"
+#include "profile.h"
+
+namespace {
+// limit of estimated executions, to avoid overflow in deeply nested loops
+const long long int k_max_frequency = 1000000000;
+// registers used by code generator besides operands of expression - one for value moved out of accumulator
+// and one for address of spilled variable
+const int k_reserved_registers = 2;
+// registers left for caching variables and constants even in procedures with simple expressions only
+const int k_minimal_free_registers = 4;
+// array address is kept in register only if it saves generating address of few instructions in every iteration
+const long long int k_minimal_array_saving = 10;
+
+bool hasLoops(std::shared_ptr<GraphNode> graph) {
+  bool loops = false;
+  forEachGraphNode(graph, [&loops](std::shared_ptr<GraphNode> node) {
+    loops = loops || (node->cond && conditionNodeKind(node) == condition_node_kind::LOOP);
+  });
+  return loops;
+}
+}  // namespace
+
+RegisterAllocation::RegisterAllocation(std::shared_ptr<CompilerStats> stats) : stats_(stats) {
+}
+
+void RegisterAllocation::run(std::shared_ptr<GraphNode> graph) {
+  symbol_table_ = graph->symbol_table;
+  candidates_.clear();
+  benefits_.clear();
+  interferences_.clear();
+  array_candidates_.clear();
+  graph->allocated_registers.clear();
+  graph->return_address_register.clear();
+  bool liveness_computed = true;
+  forEachGraphNode(graph, [&liveness_computed](std::shared_ptr<GraphNode> node) {
+    liveness_computed = liveness_computed && node->liveness_computed_;
+  });
+  if(!liveness_computed) {
+    return;
+  }
+  // variables are allocated only if they are used at least once in loop - in every iteration of loop running
+  // the default trip count times, or with profile counting real executions, just once per iteration
+  assumed_iterations_ = hasProfile(graph) ? 1 : k_default_trip_count;
+  findCandidates(graph);
+  estimateBenefits(graph, 1, nullptr);
+  // values live at procedure start and end have to be moved between memory and register, arguments passed
+  // by value are passed in the register
+  long long int executions = profiledExecutions(graph, 1);
+  addUses(withoutValueArguments(graph->live_in_), -k_estimated_load_cost * executions);
+  addUses(withoutValueArguments(chainTail(graph)->live_out_), -k_estimated_load_cost * executions);
+  buildInterferenceGraph(graph);
+
+  std::vector<std::string> order(candidates_.begin(), candidates_.end());
+  std::stable_sort(order.begin(), order.end(), [this](const std::string &first, const std::string &second) {
+    return benefits_[first] > benefits_[second];
+  });
+  procedure_name_ = graph->proc_name.empty() ? k_main_procedure_name : graph->proc_name;
+  int available_registers = std::min((int)k_allocatable_registers.size(),
+                                     k_general_registers - std::max(registerDemand(graph), k_minimal_free_registers));
+  bool loops = hasLoops(graph);
+  for(auto & name : order) {
+    // argument passed in register is not copied through memory, so it is worth a register in procedure without
+    // loops too; in procedure with loops register is worth more for variables of single loop
+    bool worth = benefits_[name] >= k_estimated_load_cost * assumed_iterations_;
+    if(symbol_table_->findSymbol(name)->value_argument) {
+      worth = !loops && benefits_[name] > 0;
+    }
+    if(!worth) {
+      continue;
+    }
+    std::set<std::string> used_registers;
+    for(auto & neighbour : interferences_[name]) {
+      auto it = graph->allocated_registers.find(neighbour);
+      if(it != graph->allocated_registers.end()) {
+        used_registers.insert(it->second);
+      }
+    }
+    bool allocated = false;
+    for(int i = 0; i < available_registers; i++) {
+      auto & register_name = k_allocatable_registers.at(i);
+      if(used_registers.count(register_name) == 0) {
+        graph->allocated_registers[name] = register_name;
+        allocated = true;
+        break;
+      }
+    }
+    stats_->addProcedureCounter(procedure_name_, allocated ? "variables_allocated" : "variables_spilled", 1);
+  }
+
+  allocated_variables_.clear();
+  std::set<std::string> used_registers;
+  for(auto & allocation : graph->allocated_registers) {
+    allocated_variables_.insert(allocation.first);
+    used_registers.insert(allocation.second);
+  }
+  // procedure with return address in register has no loops, so it is not given to loops
+  allocateReturnAddress(graph, used_registers, available_registers);
+  std::vector<std::string> free_registers;
+  for(auto & register_name : k_allocatable_registers) {
+    if(used_registers.count(register_name) == 0) {
+      free_registers.push_back(register_name);
+    }
+  }
+  allocateLoopRegisters(graph, 1, nullptr, free_registers,
+                        k_general_registers - (int)graph->allocated_registers.size());
+}
+
+/**
+ * Keeps return address of procedure in register left after global allocation, instead of storing it in memory
+ * at procedure start and loading it before return. Procedure calling other procedures would have to store it
+ * anyway and in procedure with loops the register is worth more for variables of loops.
+ */
+void RegisterAllocation::allocateReturnAddress(std::shared_ptr<GraphNode> graph,
+                                               const std::set<std::string> &used_registers,
+                                               int available_registers) {
+  graph->return_address_register.clear();
+  if(graph->proc_name.empty()) {
+    return;
+  }
+  bool leaf = true;
+  forEachGraphNode(graph, [&](std::shared_ptr<GraphNode> node) {
+    for(auto comm : node->commands) {
+      leaf = leaf && comm->type != command_type::PROC_CALL;
+    }
+  });
+  if(!leaf || hasLoops(graph)) {
+    return;
+  }
+  for(int i = 0; i < available_registers; i++) {
+    if(used_registers.count(k_allocatable_registers.at(i)) == 0) {
+      graph->return_address_register = k_allocatable_registers.at(i);
+      stats_->addProcedureCounter(procedure_name_, "return_address_in_register", 1);
+      return;
+    }
+  }
+}
+
+std::set<std::string> RegisterAllocation::withoutValueArguments(std::set<std::string> variables) {
+  std::set<std::string> result;
+  for(auto & name : variables) {
+    auto sym = symbol_table_->findSymbol(name);
+    if(!sym || !sym->value_argument) {
+      result.insert(name);
+    }
+  }
+  return result;
+}
+
+void RegisterAllocation::allocateLoopRegisters(std::shared_ptr<GraphNode> node,
+                                               long long int frequency,
+                                               std::shared_ptr<GraphNode> stop_node,
+                                               std::vector<std::string> free_registers,
+                                               int registers_pool_size) {
+  while(node && node != stop_node) {
+    frequency = profiledExecutions(node, frequency);
+    node->loop_allocated_registers.clear();
+    node->loop_array_registers.clear();
+    node->loop_array_induction_variables.clear();
+    if(!node->cond) {
+      node = node->right_node;
+      continue;
+    }
+    condition_node_kind kind = conditionNodeKind(node);
+    if(kind == condition_node_kind::LOOP) {
+      auto loop_free_registers = free_registers;
+      int loop_registers_pool_size = registers_pool_size;
+      allocateSingleLoop(node, frequency, loop_free_registers, loop_registers_pool_size);
+      for(auto & allocation : node->loop_allocated_registers) {
+        allocated_variables_.insert(allocation.first);
+      }
+      for(auto & allocation : node->loop_array_registers) {
+        allocated_variables_.insert(allocation.first);
+      }
+      long long int loop_frequency =
+          profiledConditionExecutions(node, std::min(frequency * k_default_trip_count, k_max_frequency));
+      allocateLoopRegisters(node->left_node, loop_frequency, nullptr, loop_free_registers, loop_registers_pool_size);
+      for(auto & allocation : node->loop_allocated_registers) {
+        allocated_variables_.erase(allocation.first);
+      }
+      for(auto & allocation : node->loop_array_registers) {
+        allocated_variables_.erase(allocation.first);
+      }
+      node = node->right_node;
+    } else if(kind == condition_node_kind::IF_ELSE) {
+      auto next_node = ifElseNextNode(node);
+      allocateLoopRegisters(node->left_node, frequency, nullptr, free_registers, registers_pool_size);
+      allocateLoopRegisters(node->right_node, frequency, next_node, free_registers, registers_pool_size);
+      node = next_node;
+    } else {
+      allocateLoopRegisters(node->left_node, frequency, nullptr, free_registers, registers_pool_size);
+      node = node->right_node;
+    }
+  }
+}
+
+/**
+ * Chooses variables kept in registers during single loop. Benefit of variable is counted like for global
+ * allocation, but only inside the loop, reduced by cost of loading it on loop entry and storing it on exit.
+ * Scalar arguments of procedure need two loads for every access, so their benefit is doubled.
+ */
+void RegisterAllocation::allocateSingleLoop(std::shared_ptr<GraphNode> node,
+                                            long long int frequency,
+                                            std::vector<std::string> &free_registers,
+                                            int &registers_pool_size) {
+  int demand = std::max({registerDemand(node->left_node), 2 + k_reserved_registers, k_minimal_free_registers});
+  if(free_registers.empty() || registers_pool_size <= demand) {
+    return;
+  }
+  std::set<std::string> used;
+  std::set<std::string> written;
+  std::set<std::string> passed_to_procedures;
+  bool has_calls = false;
+  used = conditionReadVariables(node->cond.get());
+  forEachGraphNode(node->left_node, [&](std::shared_ptr<GraphNode> loop_node) {
+    for(auto comm : loop_node->commands) {
+      auto read = commandReadVariables(comm);
+      auto comm_written = commandWrittenVariables(comm);
+      used.insert(read.begin(), read.end());
+      used.insert(comm_written.begin(), comm_written.end());
+      written.insert(comm_written.begin(), comm_written.end());
+      if(comm->type == command_type::PROC_CALL) {
+        has_calls = true;
+        passed_to_procedures.insert(read.begin(), read.end());
+      }
+    }
+    if(loop_node->cond) {
+      auto read = conditionReadVariables(loop_node->cond.get());
+      used.insert(read.begin(), read.end());
+    }
+  });
+  // arguments can reference the same variable, so they are kept in registers only if none of them is changed
+  // or the loop uses single argument
+  int used_arguments = 0;
+  bool arguments_written = false;
+  for(auto & name : used) {
+    auto sym = symbol_table_->findSymbol(name);
+    if(sym && sym->type == symbol_type::PROC_ARGUMENT) {
+      used_arguments++;
+      arguments_written = arguments_written || written.count(name) > 0;
+    }
+  }
+  bool arguments_allowed = !has_calls && (!arguments_written || used_arguments == 1);
+
+  candidates_.clear();
+  benefits_.clear();
+  for(auto & name : used) {
+    auto sym = symbol_table_->findSymbol(name);
+    if(!sym || allocated_variables_.count(name) > 0 || passed_to_procedures.count(name) > 0) {
+      continue;
+    }
+    if(sym->type == symbol_type::VAR || (sym->type == symbol_type::PROC_ARGUMENT && arguments_allowed)) {
+      candidates_.insert(name);
+    }
+  }
+  // called procedure can use every register, so addresses would have to be generated again after every call
+  array_candidates_.clear();
+  array_benefits_.clear();
+  if(!has_calls) {
+    auto add_array_candidates = [this](std::vector<VariableContainer*> values) {
+      for(auto value : values) {
+        if((value->type == variable_type::ARR || value->type == variable_type::VARIABLE_INDEXED_ARR) &&
+            allocated_variables_.count(value->getVariableName()) == 0) {
+          array_candidates_.insert(value->getVariableName());
+        }
+      }
+    };
+    add_array_candidates({node->cond->left_var_, node->cond->right_var_});
+    forEachGraphNode(node->left_node, [&](std::shared_ptr<GraphNode> loop_node) {
+      for(auto comm : loop_node->commands) {
+        add_array_candidates(commandAccessedValues(comm));
+      }
+      if(loop_node->cond) {
+        add_array_candidates({loop_node->cond->left_var_, loop_node->cond->right_var_});
+      }
+    });
+  }
+  long long int loop_frequency =
+      profiledConditionExecutions(node, std::min(frequency * k_default_trip_count, k_max_frequency));
+  addUses(conditionReadVariables(node->cond.get()), k_estimated_load_cost * loop_frequency);
+  addArrayUses({node->cond->left_var_, node->cond->right_var_}, loop_frequency);
+  estimateBenefits(node->left_node, loop_frequency, nullptr);
+  // pairs of benefit and name of variable or array
+  std::vector<std::pair<long long int, std::string>> order;
+  for(auto & name : candidates_) {
+    bool argument = symbol_table_->findSymbol(name)->type == symbol_type::PROC_ARGUMENT;
+    long long int access_cost = argument ? 2 * k_estimated_load_cost : k_estimated_load_cost;
+    if(argument) {
+      benefits_[name] *= 2;
+    }
+    if(argument || !node->liveness_computed_ || node->live_before_condition_.count(name) > 0) {
+      benefits_[name] -= access_cost * frequency;
+    }
+    if(written.count(name) > 0 && (argument || !node->liveness_computed_ || node->live_out_.count(name) > 0)) {
+      benefits_[name] -= access_cost * frequency;
+    }
+    if(benefits_[name] >= k_estimated_load_cost * assumed_iterations_) {
+      order.push_back({benefits_[name], name});
+    }
+  }
+  std::vector<std::string> arrays;
+  for(auto & name : array_candidates_) {
+    // address is generated once, on entering the loop
+    long long int benefit = array_benefits_[name] - arrayAddressCost(name) * frequency;
+    if(benefit >= k_minimal_array_saving * assumed_iterations_) {
+      order.push_back({benefit, name});
+      arrays.push_back(name);
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [](const std::pair<long long int, std::string> &first,
+                                                  const std::pair<long long int, std::string> &second) {
+    return first.first > second.first;
+  });
+  for(auto & candidate : order) {
+    if(free_registers.empty() || registers_pool_size <= demand) {
+      break;
+    }
+    if(std::find(arrays.begin(), arrays.end(), candidate.second) != arrays.end()) {
+      node->loop_array_registers[candidate.second] = free_registers.front();
+      stats_->addProcedureCounter(procedure_name_, "loop_array_addresses_allocated", 1);
+      std::string index_name = findInductionIndex(node, candidate.second);
+      if(!index_name.empty()) {
+        node->loop_array_induction_variables[candidate.second] = index_name;
+        stats_->addProcedureCounter(procedure_name_, "induction_addresses", 1);
+      }
+    } else {
+      node->loop_allocated_registers[candidate.second] = free_registers.front();
+      stats_->addProcedureCounter(procedure_name_, "loop_variables_allocated", 1);
+    }
+    free_registers.erase(free_registers.begin());
+    registers_pool_size--;
+  }
+  array_candidates_.clear();
+}
+
+/**
+ * Finds variable used as index of every access to array in loop, which is changed in loop only by adding small
+ * constants. Register can then hold address of indexed element, increased together with the variable, instead
+ * of address of array. Elements with constant index of local array have constant addresses, so they are allowed.
+ *
+ * @param node loop condition node
+ * @param array_name name of array, which address is kept in register during the loop
+ * @return name of index variable, empty if there is no such variable
+ */
+std::string RegisterAllocation::findInductionIndex(std::shared_ptr<GraphNode> node, std::string array_name) {
+  bool local_array = symbol_table_->findSymbol(array_name)->type == symbol_type::ARR;
+  std::string index_name;
+  bool single_index = true;
+  auto check_accesses = [&](std::vector<VariableContainer*> values) {
+    for(auto value : values) {
+      if(value->getVariableName() != array_name || (value->type == variable_type::ARR && local_array)) {
+        continue;
+      }
+      if(value->type != variable_type::VARIABLE_INDEXED_ARR ||
+          (!index_name.empty() && index_name != value->getIndexVariableName())) {
+        single_index = false;
+      } else {
+        index_name = value->getIndexVariableName();
+      }
+    }
+  };
+  check_accesses({node->cond->left_var_, node->cond->right_var_});
+  forEachGraphNode(node->left_node, [&](std::shared_ptr<GraphNode> loop_node) {
+    for(auto comm : loop_node->commands) {
+      check_accesses(commandAccessedValues(comm));
+    }
+    if(loop_node->cond) {
+      check_accesses({loop_node->cond->left_var_, loop_node->cond->right_var_});
+    }
+  });
+  // arguments can be changed through other arguments referencing the same variable
+  if(!single_index || index_name.empty() || symbol_table_->findSymbol(index_name)->type != symbol_type::VAR) {
+    return "";
+  }
+  bool induction = true;
+  forEachGraphNode(node->left_node, [&](std::shared_ptr<GraphNode> loop_node) {
+    for(auto comm : loop_node->commands) {
+      if(commandWrittenVariables(comm).count(index_name) > 0 && inductionStep(comm) == 0) {
+        induction = false;
+      }
+    }
+  });
+  return induction ? index_name : "";
+}
+
+void RegisterAllocation::findCandidates(std::shared_ptr<GraphNode> graph) {
+  std::set<std::string> used;
+  std::set<std::string> passed_to_procedures;
+  forEachGraphNode(graph, [&](std::shared_ptr<GraphNode> node) {
+    for(auto comm : node->commands) {
+      auto read = commandReadVariables(comm);
+      auto written = commandWrittenVariables(comm);
+      used.insert(read.begin(), read.end());
+      used.insert(written.begin(), written.end());
+      if(comm->type == command_type::PROC_CALL) {
+        // called procedure accesses arguments in memory
+        passed_to_procedures.insert(read.begin(), read.end());
+      }
+    }
+    if(node->cond) {
+      auto read = conditionReadVariables(node->cond.get());
+      used.insert(read.begin(), read.end());
+    }
+  });
+  for(auto & name : used) {
+    auto sym = symbol_table_->findSymbol(name);
+    if(sym && sym->type == symbol_type::VAR && passed_to_procedures.count(name) == 0) {
+      candidates_.insert(name);
+    }
+  }
+}
+
+void RegisterAllocation::estimateBenefits(std::shared_ptr<GraphNode> node,
+                                          long long int frequency,
+                                          std::shared_ptr<GraphNode> stop_node) {
+  while(node && node != stop_node) {
+    frequency = profiledExecutions(node, frequency);
+    for(int i = 0; i < node->commands.size(); i++) {
+      auto comm = node->commands.at(i);
+      addUses(commandReadVariables(comm), k_estimated_load_cost * frequency);
+      addUses(commandWrittenVariables(comm), k_estimated_load_cost * frequency);
+      addArrayUses(commandAccessedValues(comm), frequency);
+      if(comm->type == command_type::PROC_CALL) {
+        // called procedure can use every register, so values live after call are stored and loaded again
+        addUses(node->live_after_commands_.at(i), -2 * k_estimated_load_cost * frequency);
+      }
+    }
+    if(!node->cond) {
+      node = node->right_node;
+      continue;
+    }
+    condition_node_kind kind = conditionNodeKind(node);
+    std::vector<VariableContainer*> condition_values{node->cond->left_var_, node->cond->right_var_};
+    long long int condition_frequency = kind == condition_node_kind::LOOP ?
+        std::min(frequency * k_default_trip_count, k_max_frequency) : frequency;
+    condition_frequency = profiledConditionExecutions(node, condition_frequency);
+    if(kind == condition_node_kind::LOOP) {
+      addUses(conditionReadVariables(node->cond.get()), k_estimated_load_cost * condition_frequency);
+      addArrayUses(condition_values, condition_frequency);
+      estimateBenefits(node->left_node, condition_frequency, nullptr);
+      node = node->right_node;
+    } else if(kind == condition_node_kind::IF_ELSE) {
+      addUses(conditionReadVariables(node->cond.get()), k_estimated_load_cost * condition_frequency);
+      addArrayUses(condition_values, condition_frequency);
+      auto next_node = ifElseNextNode(node);
+      estimateBenefits(node->left_node, frequency, nullptr);
+      estimateBenefits(node->right_node, frequency, next_node);
+      node = next_node;
+    } else {
+      addUses(conditionReadVariables(node->cond.get()), k_estimated_load_cost * condition_frequency);
+      addArrayUses(condition_values, condition_frequency);
+      estimateBenefits(node->left_node, frequency, nullptr);
+      node = node->right_node;
+    }
+  }
+}
+
+void RegisterAllocation::addUses(std::set<std::string> variables, long long int benefit) {
+  for(auto & name : variables) {
+    if(candidates_.count(name) > 0) {
+      benefits_[name] += benefit;
+    }
+  }
+}
+
+void RegisterAllocation::addArrayUses(std::vector<VariableContainer*> accessed_values, long long int frequency) {
+  for(auto value : accessed_values) {
+    if(array_candidates_.count(value->getVariableName()) == 0) {
+      continue;
+    }
+    // address of element with constant index of local array is a constant, so it does not use array address
+    auto sym = symbol_table_->findSymbol(value->getVariableName());
+    if(value->type == variable_type::VARIABLE_INDEXED_ARR ||
+        (value->type == variable_type::ARR && sym->type == symbol_type::PROC_ARRAY_ARGUMENT)) {
+      array_benefits_[value->getVariableName()] += arrayAddressCost(value->getVariableName()) * frequency;
+    }
+  }
+}
+
+// cost of getting address of array into register, which is replaced by single GET
+long long int RegisterAllocation::arrayAddressCost(std::string array_name) {
+  auto sym = symbol_table_->findSymbol(array_name);
+  RValue address;
+  address.type = variable_type::R_VAL;
+  address.value = sym->mem_start;
+  long long int cost = estimatedOperandCost(&address) - 1;
+  if(sym->type == symbol_type::PROC_ARRAY_ARGUMENT) {
+    cost += k_estimated_load_cost;
+  }
+  return cost;
+}
+
+void RegisterAllocation::addInterferences(std::set<std::string> live_variables) {
+  for(auto & first : live_variables) {
+    if(candidates_.count(first) == 0) {
+      continue;
+    }
+    for(auto & second : live_variables) {
+      if(first != second && candidates_.count(second) > 0) {
+        interferences_[first].insert(second);
+      }
+    }
+  }
+}
+
+void RegisterAllocation::buildInterferenceGraph(std::shared_ptr<GraphNode> graph) {
+  // variables interfere if they are live at the same point of procedure
+  forEachGraphNode(graph, [this](std::shared_ptr<GraphNode> node) {
+    addInterferences(node->live_in_);
+    for(auto & live_variables : node->live_after_commands_) {
+      addInterferences(live_variables);
+    }
+    if(node->cond) {
+      addInterferences(node->live_before_condition_);
+    }
+    addInterferences(node->live_out_);
+  });
+}
+
+int RegisterAllocation::registerDemand(std::shared_ptr<GraphNode> graph) {
+  int demand = 0;
+  forEachGraphNode(graph, [&demand](std::shared_ptr<GraphNode> node) {
+    for(auto comm : node->commands) {
+      if(comm->type == command_type::ASSIGNMENT) {
+        auto expression = static_cast<AssignmentCommand*>(comm)->expression_;
+        int expression_demand = expression->neededVariablesInRegisters().size() + expression->neededEmptyRegs();
+        demand = std::max(demand, expression_demand + k_reserved_registers);
+      }
+    }
+    if(node->cond) {
+      // operand outside of accumulator and register for comparison
+      demand = std::max(demand, 2 + k_reserved_registers);
+    }
+  });
+  return demand;
+}
@@ -0,0 +1,82 @@
+#ifndef CUSTOMCOMPILER_COMPILER_REGISTER_ALLOCATION_H_
+#define CUSTOMCOMPILER_COMPILER_REGISTER_ALLOCATION_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include "code_generator.h"
+#include "compiler_stats.h"
+
+// registers taken from pool of code generator for variables kept in registers for whole procedure
+const std::vector<std::string> k_allocatable_registers{"h", "g", "f"};
+// number of general registers b-h
+const int k_general_registers = 7;
+
+/**
+ * Global register allocation of local scalar variables of single procedure, done by coloring of interference
+ * graph built from liveness analysis results.
+ *
+ * Every arithmetic instruction works on accumulator, so variable kept in register still needs GET/PUT to be
+ * used - it only replaces address generation and LOAD/STORE, which is the benefit counted for every use,
+ * weighted by loop nesting. Accumulator and registers needed at once by the most demanding expression of
+ * procedure are left to code generator, so only remaining registers are colored. Variables with the highest
+ * benefit are colored first, variables interfering with all registers are spilled - they stay in memory and
+ * are cached by local register management of code generator. Allocation is stored in start node of flow graph.
+ * In procedures without loops arguments passed by value are colored too, caller passes them directly in their
+ * registers. Register left after coloring can hold return address of procedure without calls and loops.
+ *
+ * Registers left after global allocation are then given to variables of single loops - they are loaded before
+ * loop condition, kept in register for all iterations and stored on loop exit if they were changed. Loops can use
+ * also variables passed to procedures outside of loop and scalar arguments of procedure, if loop has no calls and
+ * arguments can not be aliased by each other. Allocation is stored in condition node of the loop.
+ * In loops without calls registers can hold also addresses of arrays accessed by variable index, so the address
+ * is not generated again (and for array arguments loaded from memory) on every access. If every access uses the
+ * same index variable, changed only by adding small constants, register holds address of the indexed element.
+ */
+class RegisterAllocation {
+ public:
+  explicit RegisterAllocation(std::shared_ptr<CompilerStats> stats);
+  void run(std::shared_ptr<GraphNode> graph);
+
+ private:
+  std::shared_ptr<SymbolTable> symbol_table_;
+  std::string procedure_name_;
+  // variables that already have register assigned in currently visited part of procedure
+  std::set<std::string> allocated_variables_;
+  std::shared_ptr<CompilerStats> stats_;
+  std::set<std::string> candidates_;
+  std::map<std::string, long long int> benefits_;
+  std::map<std::string, std::set<std::string>> interferences_;
+  // arrays, which address can be kept in register during currently allocated loop
+  std::set<std::string> array_candidates_;
+  std::map<std::string, long long int> array_benefits_;
+  // number of loop iterations, in which candidate has to be used to be worth a register
+  long long int assumed_iterations_ = 1;
+
+  void findCandidates(std::shared_ptr<GraphNode> graph);
+  void estimateBenefits(std::shared_ptr<GraphNode> node, long long int frequency, std::shared_ptr<GraphNode> stop_node);
+  void addUses(std::set<std::string> variables, long long int benefit);
+  void addArrayUses(std::vector<VariableContainer*> accessed_values, long long int frequency);
+  long long int arrayAddressCost(std::string array_name);
+  std::string findInductionIndex(std::shared_ptr<GraphNode> node, std::string array_name);
+  void addInterferences(std::set<std::string> live_variables);
+  void buildInterferenceGraph(std::shared_ptr<GraphNode> graph);
+  void allocateLoopRegisters(std::shared_ptr<GraphNode> node,
+                             long long int frequency,
+                             std::shared_ptr<GraphNode> stop_node,
+                             std::vector<std::string> free_registers,
+                             int registers_pool_size);
+  void allocateSingleLoop(std::shared_ptr<GraphNode> node,
+                          long long int frequency,
+                          std::vector<std::string> &free_registers,
+                          int &registers_pool_size);
+  void allocateReturnAddress(std::shared_ptr<GraphNode> graph,
+                             const std::set<std::string> &used_registers,
+                             int available_registers);
+  std::set<std::string> withoutValueArguments(std::set<std::string> variables);
+  static int registerDemand(std::shared_ptr<GraphNode> graph);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_REGISTER_ALLOCATION_H_
@@ -2,6 +2,7 @@
 #define CUSTOMCOMPILER_COMPILER_SYMBOL_H_
 
 #include <iostream>
+#include <memory>
 #include <vector>
 
 enum symbol_type {
@@ -18,6 +19,15 @@ typedef struct symbol {
   size_t mem_start;
   size_t length;
   bool proc_jump_back_mem = false;
+  // scalar argument changed to local variable, which value is copied in and out by callers
+  bool value_argument = false;
+  // symbol placed in memory of other symbol - of cloned procedure, of array passed by callers or of procedure
+  // never active at the same time
+  std::shared_ptr<struct symbol> memory_owner;
+  // array argument of procedure clone, accessed directly in memory of the same array passed by every caller
+  bool bound_array_argument = false;
+  // local variable, which memory is used by procedure and its clones, so value written by one is read by other
+  bool memory_shared = false;
 } Symbol;
 
 #endif  // CUSTOMCOMPILER_COMPILER_SYMBOL_H_
@@ -34,6 +34,10 @@ std::shared_ptr<Symbol> SymbolTable::getProcedureJumpBackMemoryAddressSymbol() {
   return nullptr;
 }
 
+std::vector<std::shared_ptr<Symbol>> SymbolTable::getSymbols() {
+  return symbol_table_list_;
+}
+
 void SymbolTable::output_symbols() {
   for(auto s : symbol_table_list_)
     std::cout << s->symbol_name << " " << s->mem_start << " " << s->length << std::endl;
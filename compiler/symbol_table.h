@@ -12,6 +12,7 @@ class SymbolTable {
   void addProcJumpBackMemoryAddress(Symbol new_symbol);
   std::shared_ptr<Symbol> findSymbol(std::string symbol_name);
   std::shared_ptr<Symbol> getProcedureJumpBackMemoryAddressSymbol();
+  std::vector<std::shared_ptr<Symbol>> getSymbols();
   void output_symbols();
 
  private:
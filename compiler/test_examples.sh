@@ -0,0 +1,51 @@
+#!/bin/bash
+# Regression check of optimization levels. Every program listed in profile_inputs.txt is run on its inputs
+# and its output is compared with values listed in test_outputs.txt (name followed by written values). Programs
+# in regression directory keep inputs and expected output in header comments ("# ? value", "# > value").
+# Every program is run at every optimization level, costs are printed and every wrong output is reported.
+# Usage: test_examples.sh [output directory, default tests]
+compiler_dir=$(cd "$(dirname "$0")" && pwd)
+examples_dir="$compiler_dir/../example_programs"
+out_dir=${1:-tests}
+levels="-O0 -O1 -O2 -Os"
+mkdir -p "$out_dir"
+failed=0
+
+# runs program and checks its output, prints cost or FAIL
+check_program() {
+  local name=$1 source_file=$2 expected=$3 level output cost result
+  result=$(printf "%-16s" "$name")
+  for level in $levels; do
+    output=$("$compiler_dir/kompilator" "$level" --run --inputs "$out_dir/$name.in" "$source_file" 2>&1)
+    cost=$(echo "$output" | sed -n 's/^Program finished (cost: \([0-9]*\);.*/\1/p')
+    if [ -z "$cost" ] || [ "$(echo "$output" | sed -n 's/^> //p' | tr '\n' ' ')" != "$expected" ]; then
+      echo "$output" > "$out_dir/$name$level.out"
+      cost=FAIL
+      failed=1
+    fi
+    result+=$(printf " %12s" "$cost")
+  done
+  echo "$result"
+}
+
+printf "%-16s" "program"
+printf " %12s" $levels
+echo
+while read -r name inputs; do
+  [ -z "$name" ] && continue
+  echo "$inputs" > "$out_dir/$name.in"
+  expected=$(sed -n "s/^$name //p" "$examples_dir/test_outputs.txt" | tr ' ' '\n' | sed '/^$/d' | tr '\n' ' ')
+  check_program "$name" "$examples_dir/$name.imp" "$expected"
+done < "$examples_dir/profile_inputs.txt"
+for source_file in "$examples_dir"/regression/*.imp; do
+  [ -e "$source_file" ] || continue
+  name=$(basename "$source_file" .imp)
+  sed -n 's/^# ? //p' "$source_file" > "$out_dir/$name.in"
+  expected=$(sed -n 's/^# > //p' "$source_file" | tr '\n' ' ')
+  check_program "$name" "$source_file" "$expected"
+done
+
+if [ "$failed" -ne 0 ]; then
+  echo "wrong output of programs marked FAIL, saved in $out_dir"
+  exit 1
+fi
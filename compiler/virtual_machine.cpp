@@ -0,0 +1,152 @@
+#include <cstdlib>
+#include <ctime>
+#include <stdexcept>
+#include "virtual_machine.h"
+
+VirtualMachine::VirtualMachine(std::vector<Instruction> program) : program_(program) {
+}
+
+std::vector<Instruction> VirtualMachine::parseProgram(std::vector<std::string> lines) {
+  std::vector<Instruction> program;
+  for(int i = 0; i < lines.size(); i++) {
+    Instruction instr;
+    if(!parseInstruction(lines.at(i), instr)) {
+      throw std::runtime_error("Invalid instruction at line " + std::to_string(i) + ": " + lines.at(i));
+    }
+    program.push_back(instr);
+  }
+  return program;
+}
+
+RunResult VirtualMachine::run(std::istream &in, std::ostream &out, bool prompt) {
+  RunResult result;
+  // registers are resolved once, so the loop below does not compare strings
+  std::vector<int> register_indexes;
+  for(auto & instr : program_) {
+    register_indexes.push_back(registerIndex(instr.reg));
+  }
+  memory_.clear();
+  std::srand(std::time(nullptr));
+  for(int i = 0; i < 8; i++) {
+    registers_[i] = std::rand();
+  }
+  long long int & acc = registers_[0];
+  long long int lr = 0;
+  if(program_.empty()) {
+    throw std::runtime_error("Empty program");
+  }
+  result.line_executions.assign(program_.size(), 0);
+  while(program_.at(lr).code != instruction_code::HALT) {
+    auto & instr = program_.at(lr);
+    long long int & reg = registers_[register_indexes.at(lr)];
+    result.executed_instructions++;
+    result.line_executions.at(lr)++;
+    switch(instr.code) {
+      case instruction_code::READ:
+        if(prompt) {
+          out << "? ";
+        }
+        if(!(in >> acc)) {
+          throw std::runtime_error("Missing input value for READ at line " + std::to_string(lr));
+        }
+        result.io_cost += 100;
+        lr++;
+        break;
+      case instruction_code::WRITE:
+        out << "> " << acc << "\n";
+        result.io_cost += 100;
+        lr++;
+        break;
+      case instruction_code::LOAD:
+        acc = memory_[reg];
+        result.cost += 50;
+        lr++;
+        break;
+      case instruction_code::STORE:
+        memory_[reg] = acc;
+        result.cost += 50;
+        lr++;
+        break;
+      case instruction_code::ADD:
+        acc += reg;
+        result.cost += 5;
+        lr++;
+        break;
+      case instruction_code::SUB:
+        acc -= acc >= reg ? reg : acc;
+        result.cost += 5;
+        lr++;
+        break;
+      case instruction_code::GET:
+        acc = reg;
+        result.cost += 1;
+        lr++;
+        break;
+      case instruction_code::PUT:
+        reg = acc;
+        result.cost += 1;
+        lr++;
+        break;
+      case instruction_code::RST:
+        reg = 0;
+        result.cost += 1;
+        lr++;
+        break;
+      case instruction_code::INC:
+        reg++;
+        result.cost += 1;
+        lr++;
+        break;
+      case instruction_code::DEC:
+        if(reg > 0)
+          reg--;
+        result.cost += 1;
+        lr++;
+        break;
+      case instruction_code::SHL:
+        reg <<= 1;
+        result.cost += 1;
+        lr++;
+        break;
+      case instruction_code::SHR:
+        reg >>= 1;
+        result.cost += 1;
+        lr++;
+        break;
+      case instruction_code::JUMP:
+        lr = instr.target;
+        result.cost += 1;
+        break;
+      case instruction_code::JPOS:
+        lr = acc > 0 ? instr.target : lr + 1;
+        result.cost += 1;
+        break;
+      case instruction_code::JZERO:
+        lr = acc == 0 ? instr.target : lr + 1;
+        result.cost += 1;
+        break;
+      case instruction_code::STRK:
+        reg = lr;
+        result.cost += 1;
+        lr++;
+        break;
+      case instruction_code::JUMPR:
+        lr = reg;
+        result.cost += 1;
+        break;
+      default:
+        break;
+    }
+    if(lr < 0 || lr >= program_.size()) {
+      throw std::runtime_error("Call of nonexistent instruction " + std::to_string(lr));
+    }
+  }
+  return result;
+}
+
+int VirtualMachine::registerIndex(std::string reg) {
+  if(reg.size() != 1) {
+    return 0;
+  }
+  return reg.at(0) - 'a';
+}
@@ -0,0 +1,41 @@
+#ifndef CUSTOMCOMPILER_COMPILER_VIRTUAL_MACHINE_H_
+#define CUSTOMCOMPILER_COMPILER_VIRTUAL_MACHINE_H_
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "instruction.h"
+
+typedef struct run_result {
+  // cost of executed instructions without input/output
+  long long int cost = 0;
+  long long int io_cost = 0;
+  long long int executed_instructions = 0;
+  // number of executions of every line of program, used for profiles
+  std::vector<long long int> line_executions;
+} RunResult;
+
+/**
+ * In-process implementation of the virtual machine executing generated code.
+ * Semantics and costs of instructions follow virtual_machine/mw.cc - registers start with random values,
+ * memory cells start with 0, SUB and DEC do not go below 0.
+ */
+class VirtualMachine {
+ public:
+  explicit VirtualMachine(std::vector<Instruction> program);
+  // parses generated code lines, throws std::runtime_error on malformed line
+  static std::vector<Instruction> parseProgram(std::vector<std::string> lines);
+
+  // reads values of READ instructions from in, writes values of WRITE instructions to out
+  RunResult run(std::istream &in, std::ostream &out, bool prompt);
+
+ private:
+  std::vector<Instruction> program_;
+  std::map<long long int, long long int> memory_;
+  long long int registers_[8];
+
+  static int registerIndex(std::string reg);
+};
+
+#endif  // CUSTOMCOMPILER_COMPILER_VIRTUAL_MACHINE_H_